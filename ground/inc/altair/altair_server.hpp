@@ -1,17 +1,28 @@
 #ifndef ALTAIR_SERVER_HPP
 #define ALTAIR_SERVER_HPP
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <memory>
-#include <functional>
-#include <unordered_map>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <vector>
 #include "connection.hpp"
-#include "id_generator.hpp"
 #include "tcp_server.hpp"
 #include "packet_parser.hpp"
 #include "server_data_manager.hpp"
+#include "frame_decoder.hpp"
+#include "in_flight_table.hpp"
+#include "telemetry_subscriptions.hpp"
+#include "uplink_scheduler.hpp"
 
 namespace altair {
 
+class CommandTokenizer;
+
 /**
  * @class AltairServer
  * @brief Main server class for the Altair satellite communication system
@@ -19,20 +30,32 @@ namespace altair {
  * The AltairServer provides an interface for communicating with the Altair satellite.
  * It handles incoming responses from the satellite and outgoing requests from clients.
  * The server operates both through a serial connection with the satellite and
- * a TCP server for external client connections.
+ * a TCP server for external client connections. Every packet to the satellite
+ * goes through an UplinkScheduler, paced to the line rate and ordered by
+ * priority: time sync and configuration first, then client requests.
+ *
+ * While the link is idle, a backfill job looks for gaps in the stored
+ * sensor history, using the satellite's sample interval, and fetches them
+ * from the satellite's logs one request at a time at the lowest priority.
  */
 class AltairServer {
 public:
     /**
      * @brief Constructs an AltairServer with the given connection
      * @param connection A unique pointer to a Connection object for satellite communication
-     */
-    explicit AltairServer(std::unique_ptr<Connection> connection);
+     * @param io_threads Number of threads serving TCP clients (and asynchronous serial input)
+     * @param history_directory Directory persisting the sensor history, empty to keep it in memory only
+     * @param fetch_window Sensor log requests one client query keeps in flight
+     * @param sample_interval Seconds between the satellite's sensor samples (its delay setting), 0 disables backfill
+     */
+    explicit AltairServer(std::unique_ptr<Connection> connection, size_t io_threads = 1,
+                          const std::string& history_directory = "", size_t fetch_window = DEFAULT_FETCH_WINDOW,
+                          uint32_t sample_interval = DEFAULT_SAMPLE_INTERVAL);
 
     /**
-     * @brief Virtual destructor with default implementation
+     * @brief Destructor, stops the TCP server and asynchronous serial reception
      */
-    ~AltairServer() = default;
+    ~AltairServer();
 
     /**
      * @brief Deleted copy constructor to prevent copying
@@ -47,42 +70,307 @@ public:
     /**
      * @brief Starts the main listening loop for satellite communications
      * 
-     * This method continuously reads data from the satellite connection,
-     * processes responses, and dispatches them to appropriate handlers.
+     * If the connection supports asynchronous reception, received data is
+     * already decoded on the TCP server's io thread and this method only
+     * blocks until that thread exits. Otherwise it continuously reads data
+     * from the satellite connection in chunks of up to READ_CHUNK_SIZE bytes,
+     * decodes them into packets and dispatches each packet to the appropriate
+     * handler, backing off while reads keep failing.
      */
     void listen();
 
+    /**
+     * @brief Maximum number of bytes requested from the connection per read
+     */
+    static constexpr size_t READ_CHUNK_SIZE = 256;
+
+    /**
+     * @brief Wait after the first failed read when polling, doubled on every further failure
+     */
+    static constexpr std::chrono::milliseconds RECEIVE_RETRY_MIN_DELAY{10};
+
+    /**
+     * @brief Longest wait between failed reads when polling
+     */
+    static constexpr std::chrono::milliseconds RECEIVE_RETRY_MAX_DELAY{1000};
+
+    /**
+     * @brief Default number of sensor log requests one client query keeps in flight
+     */
+    static constexpr size_t DEFAULT_FETCH_WINDOW = 4;
+
+    /**
+     * @brief Default seconds between the satellite's sensor samples, the firmware's default delay setting
+     */
+    static constexpr uint32_t DEFAULT_SAMPLE_INTERVAL = 6;
+
+    /**
+     * @brief Largest number of periods one get_sensor_stats command may ask for
+     */
+    static constexpr uint64_t MAX_STATS_PERIODS = 1000;
+
+    /**
+     * @brief Number of received packets whose type has no handler
+     * @return Count of unknown packets since construction
+     */
+    size_t unknown_response_count() const;
+
 private:
+    /**
+     * @brief Records the satellite sends at most per log request (MAX_LOGS in the firmware)
+     */
+    static constexpr uint32_t SATELLITE_MAX_LOGS = 10;
+
+    /**
+     * @brief Longest range of one log request; the satellite only reads the day files of its start and end
+     */
+    static constexpr uint32_t MAX_FETCH_SPAN = 86400;
+
+    /**
+     * @brief Bytes of the longest reply to a log request with records of the given size
+     */
+    static constexpr size_t log_reply_bytes(size_t record_size)
+    {
+        return SATELLITE_MAX_LOGS * (PACKET_HEADER_SIZE + record_size) + PACKET_HEADER_SIZE + 1;
+    }
+
+    /**
+     * @brief Records sent to a client at once when replying to a sensor log query
+     */
+    static constexpr size_t REPLY_PAGE_RECORDS = 4096;
+
+    /**
+     * @brief Bytes a client may still have queued when the next page of a reply is sent
+     *
+     * A text page takes well under 1 MiB, so a client reading its reply
+     * never gets near the session's 4 MiB queue limit.
+     */
+    static constexpr size_t REPLY_PAGE_QUEUED_BYTES = 256 * 1024;
+
+    /**
+     * @brief Age in seconds, relative to the latest beacon, after which the satellite's log is taken as settled
+     */
+    static constexpr uint32_t COVERAGE_SETTLE_SECONDS = 10;
+
+    /**
+     * @brief How often the backfill job checks whether the link is idle
+     */
+    static constexpr std::chrono::milliseconds BACKFILL_PERIOD{1000};
+
+    /**
+     * @brief Seconds before the latest beacon searched for gaps
+     */
+    static constexpr uint32_t BACKFILL_HORIZON = 7 * 86400;
+
+    /**
+     * @brief Longest range fetched by one backfill job
+     */
+    static constexpr uint32_t BACKFILL_MAX_SPAN = 3600;
+
+    /**
+     * @brief Gaps found per search, so gaps that failed before can be skipped
+     */
+    static constexpr size_t BACKFILL_GAP_LOOKAHEAD = 16;
+
+    /**
+     * @struct ClientRequest
+     * @brief Context of a request answered straight to its client, keeping the client's session open meanwhile
+     */
+    struct ClientRequest : RequestContext
+    {
+        std::shared_ptr<void> hold;         ///< ClientSession::holdOpen token
+    };
+
+    /**
+     * @struct LogQuery
+     * @brief A client's sensor log query, answered once every fetch for its missing intervals ended
+     *
+     * Guarded by m_log_mutex, like the fetches.
+     */
+    struct LogQuery
+    {
+        std::shared_ptr<altair::ClientSession> client;  ///< Client waiting for the records, nullptr for backfill
+        uint8_t tag = 0;                                ///< Binary protocol tag of the query
+        uint32_t start = 0;                             ///< First second of the query
+        uint32_t end = 0;                               ///< Last second of the query
+        UplinkScheduler::Priority priority = UplinkScheduler::INTERACTIVE; ///< Priority of its requests
+        size_t window = 1;                              ///< Requests it keeps in flight
+        std::deque<CoverageMap::Interval> backlog;      ///< Missing intervals not requested yet, in time order
+        uint32_t piece_span = 0;                        ///< Longest range of one of its requests
+        size_t pending = 0;                             ///< Fetches in flight the query waits for
+        size_t own_fetches = 0;                         ///< Fetches in flight the query requested itself
+        size_t replies = 0;                             ///< Fetch replies received so far
+        size_t received = 0;                            ///< Records received so far
+        int64_t complete_until = 0;                     ///< Last second the stored records answer completely
+        bool cancelled = false;                         ///< Its client disconnected, nothing more is fetched or sent for it
+        bool unanswered = false;                        ///< A request written to the link was not answered
+        std::shared_ptr<void> hold;                     ///< Keeps the client's session open until it is answered
+    };
+
+    /**
+     * @struct LogFetch
+     * @brief One sensor log request sent to the satellite, shared by every query overlapping it
+     */
+    struct LogFetch : RequestContext
+    {
+        std::vector<std::shared_ptr<LogQuery>> queries; ///< Queries waiting for the fetch
+        std::shared_ptr<LogQuery> owner;    ///< Query whose fetch window the fetch takes up
+        UplinkScheduler::Priority priority = UplinkScheduler::INTERACTIVE; ///< Most urgent priority of its queries
+        uint32_t start = 0;                 ///< First second requested
+        uint32_t end = 0;                   ///< Last second requested
+        uint32_t received = 0;              ///< Records received so far
+        uint32_t last_timestamp = 0;        ///< Latest timestamp received
+        uint32_t settled_until = 0;         ///< Records up to here were already logged when the fetch was sent
+    };
+
+    /**
+     * @struct EventWaiter
+     * @brief A client's event log query, served by an event fetch covering its range
+     *
+     * Records are streamed to a query whose range is the fetch's; a
+     * narrower query only gets them when the fetch ends.
+     */
+    struct EventWaiter
+    {
+        std::shared_ptr<altair::ClientSession> client;  ///< Client waiting for the records
+        uint8_t tag = 0;                                ///< Binary protocol tag of the query
+        uint32_t start = 0;                             ///< First second of the query
+        uint32_t end = 0;                               ///< Last second of the query
+        std::shared_ptr<void> hold;                     ///< Keeps the client's session open until it is answered
+    };
+
+    /**
+     * @struct EventFetch
+     * @brief One event log request sent to the satellite, shared by every query inside its range
+     *
+     * Events are not stored on the ground, so the records received so far
+     * are kept for queries joining while the fetch is in flight, and for
+     * the narrower queries served when it ends.
+     */
+    struct EventFetch : RequestContext
+    {
+        std::vector<EventWaiter> waiters;   ///< Queries waiting for the fetch
+        std::vector<EventData> records;     ///< Records received so far
+        uint32_t start = 0;                 ///< First second requested
+        uint32_t end = 0;                   ///< Last second requested
+    };
+
     /**
      * @typedef ResponseHandler
-     * @brief Function type for handling specific response types from the satellite
+     * @brief Member function handling one response type from the satellite
      */
-    using ResponseHandler = std::function<void(std::vector<uint8_t>&, uint8_t)>;
-    
+    using ResponseHandler = void (AltairServer::*)(const PacketView&, uint8_t);
+
     /**
-     * @brief Initializes the response handler map
-     * 
-     * Maps each ResponseType to its corresponding handler method.
-     * Called during construction.
+     * @typedef ResponseDispatchTable
+     * @brief Handler for every possible packet type byte
+     */
+    using ResponseDispatchTable = std::array<ResponseHandler, 256>;
+
+    /**
+     * @struct ResponseRoute
+     * @brief Binds one response type to its handler in the protocol description
+     */
+    struct ResponseRoute
+    {
+        ResponseType type;          ///< Packet type byte sent by the satellite
+        ResponseHandler handler;    ///< Member function that handles it
+    };
+
+    /**
+     * @brief Builds the dispatch table from the inbound protocol description
+     * @return Table indexed by packet type; unlisted types map to handle_unknown
+     *
+     * Evaluated at compile time. Listing a type twice, leaving a type the
+     * satellite sends without a route (see ALTAIR_RESPONSE_TYPES), or routing
+     * a type only the ground sends fails the build.
      */
-    void init_response_handlers();
+    static constexpr ResponseDispatchTable make_response_dispatch_table();
     
     /**
      * @brief Main handler for incoming response data from the satellite
-     * @param response Vector of bytes containing the response data
+     * @param response View of the packet inside the decoder's receive buffer
      * 
-     * Dispatches the response to the appropriate handler based on its type.
+     * Dispatches the response to the appropriate handler based on its type
+     * with a single lookup in the compile-time dispatch table.
      */
-    void handle_response(std::vector<uint8_t>& response);
+    void handle_response(const PacketView& response);
     
     /**
      * @brief Handles client requests received through the TCP server
      * @param message The message received from the client
      * @param client A shared pointer to the client session
+     * @param tag Binary protocol tag of a REQUEST_COMMAND frame, echoed in the REPLY_TEXT frames of its replies
      * 
-     * Parses the command and executes the appropriate action.
+     * Tokenizes the command line without allocating and looks the command
+     * up in the compile-time command table.
      */
-    void handle_request(const std::string& message, std::shared_ptr<altair::ClientSession> client);
+    void handle_request(const std::string& message, std::shared_ptr<altair::ClientSession> client, uint8_t tag = 0);
+    
+    /**
+     * @typedef CommandHandler
+     * @brief Member function serving one client command, given the tokenizer positioned after the command name
+     *        and the tag its replies echo
+     */
+    using CommandHandler = void (AltairServer::*)(CommandTokenizer&, const std::shared_ptr<altair::ClientSession>&, uint8_t);
+    
+    /**
+     * @struct CommandRoute
+     * @brief Binds one command name to its handler in the client protocol description
+     */
+    struct CommandRoute
+    {
+        std::string_view name;      ///< Command name as typed by the client
+        CommandHandler handler;     ///< Member function that serves it, nullptr for a free slot
+    };
+    
+    /**
+     * @brief Number of slots in the command table, kept well above the command count
+     */
+    static constexpr size_t COMMAND_TABLE_SIZE = 64;
+    
+    /**
+     * @typedef CommandTable
+     * @brief Hash table of the commands, indexed by command_hash
+     */
+    using CommandTable = std::array<CommandRoute, COMMAND_TABLE_SIZE>;
+    
+    /**
+     * @brief Hashes a command name for the command table
+     */
+    static constexpr uint32_t command_hash(std::string_view name);
+    
+    /**
+     * @brief Builds the command table from the client protocol description
+     * @return Open addressing hash table of every command
+     *
+     * Evaluated at compile time. Listing a command twice fails the build.
+     */
+    static constexpr CommandTable make_command_table();
+    
+    /**
+     * @name Client command handlers
+     * @brief One per command in the client protocol, see make_command_table
+     * @{
+     */
+    void command_get_sensor_data(CommandTokenizer& args, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag);
+    void command_get_recent_sensor_data(CommandTokenizer& args, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag);
+    void command_update_light(CommandTokenizer& args, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag);
+    void command_update_min_temp(CommandTokenizer& args, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag);
+    void command_update_max_temp(CommandTokenizer& args, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag);
+    void command_update_humidity(CommandTokenizer& args, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag);
+    void command_update_voltage(CommandTokenizer& args, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag);
+    void command_get_sensor_logs(CommandTokenizer& args, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag);
+    void command_get_events_logs(CommandTokenizer& args, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag);
+    void command_get_sensor_stats(CommandTokenizer& args, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag);
+    void command_get_log_progress(CommandTokenizer& args, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag);
+    void command_get_current_time(CommandTokenizer& args, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag);
+    void command_set_time(CommandTokenizer& args, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag);
+    void command_subscribe(CommandTokenizer& args, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag);
+    void command_unsubscribe(CommandTokenizer& args, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag);
+    void command_help(CommandTokenizer& args, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag);
+    void command_binary(CommandTokenizer& args, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag);
+    /** @} */
     
     /**
      * @brief Creates a message packet with the specified type and response ID
@@ -95,11 +383,57 @@ private:
     /**
      * @brief Sends a message packet to the Altair satellite
      * @param message_packet The packet to send
+     * @param generation Generation of the packet's request ID, as handed out by InFlightTable::acquire
+     * @param priority Priority class of the packet
+     * @param reply_bytes Size of the reply the packet asks for, charged to the line rate with it
      * 
-     * Serializes the packet and sends it through the connection.
+     * Serializes the packet and queues it on the uplink scheduler, with the
+     * generation of its request ID.
+     */
+    void send_packet_to_altair(MessagePacket& message_packet, uint32_t generation,
+                               UplinkScheduler::Priority priority,
+                               size_t reply_bytes = 0);
+
+    /**
+     * @brief Writes a packet to the satellite connection, on the uplink scheduler's thread
+     * @param packet The serialized packet
+     * @param generation Generation of the packet's request ID when it was queued
+     *
+     * Starts the request's reply timeout, or drops the packet if the
+     * request ended while it was queued.
+     */
+    void write_to_altair(const std::vector<uint8_t>& packet, uint32_t generation);
+
+    /**
+     * @brief Takes a consistent copy of the latest sensor data
+     * @return The latest beacon sample
      */
-    void send_packet_to_altair(MessagePacket& message_packet);
+    SensorData latest_data() const;
     
+    /**
+     * @brief Reserves a request ID in the in-flight table
+     * @param client Client waiting for the reply, or nullptr
+     * @param tag Binary protocol tag of the client's request
+     * @return The request ID and its generation, or empty if none is free (the client is told so)
+     */
+    std::optional<InFlightTable::Ticket> acquire_request_id(std::shared_ptr<altair::ClientSession> client, uint8_t tag = 0);
+    
+    /**
+     * @brief Reports a failed request, as a REPLY_ERROR frame to binary clients
+     * @param client The client to tell
+     * @param tag Binary protocol tag of the failed request
+     * @param message Human readable reason
+     */
+    static void reply_error(const std::shared_ptr<altair::ClientSession>& client, uint8_t tag, const std::string& message);
+    
+    /**
+     * @brief Handles one frame of a client in binary mode (see binary_protocol.hpp)
+     * @param frame Kind, tag and body of the frame
+     * @param size Size of the frame without the length field
+     * @param client The client session
+     */
+    void handle_binary_request(const uint8_t* frame, size_t size, std::shared_ptr<altair::ClientSession> client);
+
     /**
      * @brief Sends a value of any type to the satellite
      * @tparam T The type of value to send
@@ -120,70 +454,77 @@ private:
      * @param response The response data
      * @param responseId The response identifier
      */
-    void handle_time_request(std::vector<uint8_t>& response, uint8_t responseId);
+    void handle_time_request(const PacketView& response, uint8_t responseId);
     
     /**
      * @brief Handles SENSOR_LOG responses
      * @param response The response data
      * @param responseId The response identifier
      */
-    void handle_sensor_log(std::vector<uint8_t>& response, uint8_t responseId);
+    void handle_sensor_log(const PacketView& response, uint8_t responseId);
     
     /**
      * @brief Handles SENSOR_LOG_END responses
      * @param response The response data
      * @param responseId The response identifier
      */
-    void handle_sensor_log_end(std::vector<uint8_t>& response, uint8_t responseId);
+    void handle_sensor_log_end(const PacketView& response, uint8_t responseId);
     
     /**
      * @brief Handles ACK responses
      * @param response The response data
      * @param responseId The response identifier
      */
-    void handle_ack(std::vector<uint8_t>& response, uint8_t responseId);
+    void handle_ack(const PacketView& response, uint8_t responseId);
     
     /**
      * @brief Handles NACK responses
      * @param response The response data
      * @param responseId The response identifier
      */
-    void handle_nack(std::vector<uint8_t>& response, uint8_t responseId);
+    void handle_nack(const PacketView& response, uint8_t responseId);
     
     /**
      * @brief Handles EVENT responses
      * @param response The response data
      * @param responseId The response identifier
      */
-    void handle_event(std::vector<uint8_t>& response, uint8_t responseId);
+    void handle_event(const PacketView& response, uint8_t responseId);
     
     /**
      * @brief Handles EVENT_LOG responses
      * @param response The response data
      * @param responseId The response identifier
      */
-    void handle_event_log(std::vector<uint8_t>& response, uint8_t responseId);
+    void handle_event_log(const PacketView& response, uint8_t responseId);
     
     /**
      * @brief Handles EVENT_LOG_END responses
      * @param response The response data
      * @param responseId The response identifier
      */
-    void handle_event_log_end(std::vector<uint8_t>& response, uint8_t responseId);
+    void handle_event_log_end(const PacketView& response, uint8_t responseId);
     
     /**
      * @brief Handles RESPONSE_CURRENT_TIME responses
      * @param response The response data
      * @param responseId The response identifier
      */
-    void handle_response_current_time(std::vector<uint8_t>& response, uint8_t responseId);
+    void handle_response_current_time(const PacketView& response, uint8_t responseId);
     
+    /**
+     * @brief Fallback for packet types without a handler, counts and reports them
+     * @param response The response data
+     * @param responseId The response identifier
+     */
+    void handle_unknown(const PacketView& response, uint8_t responseId);
+
     /**
      * @brief Handles BEACON responses
      * @param response The response data
      * @param responseId The response identifier
      */
-    void handle_beacon(std::vector<uint8_t>& response, uint8_t responseId);
+    void handle_beacon(const PacketView& response, uint8_t responseId);
 
     //----------------------------------------------------------------------
     // Request handler methods
@@ -235,22 +576,158 @@ private:
      * @param start The start timestamp
      * @param end The end timestamp
      * @param client The client session to send the results to
+     * @param tag Binary protocol tag echoed in the result frames
+     *
+     * Only the intervals neither stored nor requested by another query are
+     * requested from the satellite.
+     */
+    void get_sensor_in_range(uint32_t start, uint32_t end, std::shared_ptr<altair::ClientSession> client, uint8_t tag = 0);
+
+    /**
+     * @brief Requests the missing intervals of a new sensor log query
+     * @param query The query, with its range, priority and window set
+     * @param missing Intervals of its range not stored yet, in time order
+     */
+    void start_log_query(const std::shared_ptr<LogQuery>& query, const std::vector<CoverageMap::Interval>& missing);
+
+    /**
+     * @brief Answers a query that waits for nothing more, or ends a backfill job
+     */
+    void finish_log_query(const std::shared_ptr<LogQuery>& query);
+
+    /**
+     * @brief Cancels the sensor log queries of a client whose session closed
+     * @param client The client
+     *
+     * Their backlog is dropped, and requests still queued on the uplink
+     * that no other query waits for are not sent at all. A fetch in flight
+     * ends normally, but without a follow-up unless another query waits
+     * for it.
+     */
+    void cancel_log_queries(const std::shared_ptr<altair::ClientSession>& client);
+
+    /**
+     * @brief Arms the timer running the backfill job
+     */
+    void schedule_backfill();
+
+    /**
+     * @brief Starts fetching the first gap of the stored history if the link is idle
+     */
+    void backfill();
+
+    /**
+     * @brief Creates fetches for the backlog of a query until its fetch window is full
+     * @param query The query, with m_log_mutex held
+     * @param requests Receives the new fetches, to be sent by send_log_fetches once the mutex is released
+     *
+     * The backlog is cut into pieces spread over the window, each paged
+     * through by its own chain of requests. Parts of the backlog that
+     * became covered meanwhile are skipped, and parts another query has in
+     * flight are shared instead of requested.
+     */
+    void plan_log_fetches(const std::shared_ptr<LogQuery>& query, std::vector<std::shared_ptr<LogFetch>>& requests);
+
+    /**
+     * @brief Sends planned fetches to the satellite
+     */
+    void send_log_fetches(const std::vector<std::shared_ptr<LogFetch>>& requests);
+
+    /**
+     * @brief Drops a query's wait for one fetch
+     * @param query The query, with m_log_mutex held
+     * @return True if the query waits for nothing more and is to be answered
+     */
+    bool release_log_query(const std::shared_ptr<LogQuery>& query);
+
+    /**
+     * @brief Accounts for an ended fetch and answers its queries once they wait for nothing more
+     * @param fetch The fetch, already released from the in-flight table
+     * @param answered True if the satellite sent its end of log, false on NACK or timeout
+     * @param sent False if the request never reached the link, so the satellite is not to blame
+     *
+     * A fetch answered with fewer than SATELLITE_MAX_LOGS records got every
+     * record the satellite holds, so its interval is marked covered up to
+     * what was settled when it was sent. A full answer may have been cut
+     * short: its interval is covered up to its last record and a follow-up
+     * fetch takes over the rest, for the same queries, unless all of them
+     * were cancelled.
+     */
+    void complete_log_fetch(const std::shared_ptr<LogFetch>& fetch, bool answered, bool sent = true);
+
+    /**
+     * @brief Ends an event fetch for every query waiting for it
+     * @param fetch The fetch, already released from the in-flight table
+     * @param failure Error reported to the queries, or nullptr if the satellite sent its end of log
+     *
+     * Queries narrower than the fetch get its records inside their range,
+     * or are fetched again on their own if the fetch came back full.
+     */
+    void complete_event_fetch(const std::shared_ptr<EventFetch>& fetch, const char* failure);
+
+    /**
+     * @brief Sends one event record to a waiting query
+     */
+    void send_event_record(const EventWaiter& waiter, const EventData& event_data);
+
+    /**
+     * @brief Sends the stored sensor records of a query to its client
+     * @param client The client session
+     * @param tag Binary protocol tag echoed in the result frames
+     * @param start First second of the query
+     * @param end Last second of the query
+     * @param complete_until Last second the stored records answer completely
+     *
+     * The records go out in pages of REPLY_PAGE_RECORDS, see send_sensor_log_page.
+     */
+    void reply_sensor_logs(const std::shared_ptr<altair::ClientSession>& client, uint8_t tag,
+                           uint32_t start, uint32_t end, int64_t complete_until);
+
+    /**
+     * @brief Sends one page of a sensor log reply, and the next ones once the client's queue has drained
+     * @param client The client session
+     * @param tag Binary protocol tag echoed in the result frames
+     * @param records Every record of the reply
+     * @param first Index of the first record of the page
+     * @param until Last second the records answer
+     * @param end Last second of the query
+     *
+     * The last page ends the reply.
      */
-    void get_sensor_in_range(uint32_t start, uint32_t end, std::shared_ptr<altair::ClientSession> client);
+    void send_sensor_log_page(const std::shared_ptr<altair::ClientSession>& client, uint8_t tag,
+                              const std::shared_ptr<const std::vector<SensorData>>& records, size_t first,
+                              uint32_t until, uint32_t end);
     
     /**
      * @brief Requests event data within a time range
      * @param start The start timestamp
      * @param end The end timestamp
      * @param client The client session to send the results to
+     * @param tag Binary protocol tag echoed in the result frames
+     *
+     * Joins an event fetch in flight whose range covers the query instead
+     * of sending another request, see fetch_events.
+     */
+    void get_event_in_range(uint32_t start, uint32_t end, std::shared_ptr<altair::ClientSession> client, uint8_t tag = 0);
+
+    /**
+     * @brief Serves an event query from a fetch in flight, or sends a fetch for its range
+     * @param waiter The query
+     * @param join_wider Whether a fetch whose range strictly contains the query's may serve it
+     *
+     * A fetch of the same range streams its records to the query. A wider
+     * one only returns the first SATELLITE_MAX_LOGS events of its own range,
+     * so the query gets its share once the fetch ended, or a fetch of its own
+     * if the wider one came back full.
      */
-    void get_event_in_range(uint32_t start, uint32_t end, std::shared_ptr<altair::ClientSession> client);
+    void fetch_events(EventWaiter waiter, bool join_wider);
     
     /**
      * @brief Requests the current time from the satellite
      * @param client The client session to send the result to
+     * @param tag Binary protocol tag echoed in the result frame
      */
-    void get_current_time(std::shared_ptr<altair::ClientSession> client);
+    void get_current_time(std::shared_ptr<altair::ClientSession> client, uint8_t tag = 0);
 
 private:
     /**
@@ -264,9 +741,9 @@ private:
     SensorData m_latest_data;
     
     /**
-     * ID generator for tracking requests
+     * Guards m_latest_data, which client handlers read from any io thread
      */
-    IDGenerator& m_id_generator;
+    mutable std::mutex m_latest_data_mutex;
     
     /**
      * TCP server for client connections
@@ -279,19 +756,89 @@ private:
     PacketParser m_packet_parser;
     
     /**
-     * Map of request IDs to client sessions for tracking responses
+     * Requests waiting for a satellite reply, indexed by request ID
      */
-    std::unordered_map<uint8_t, std::shared_ptr<altair::ClientSession>> m_request_clients;
+    InFlightTable m_in_flight;
     
+    /**
+     * Guards the log fetches in flight and the queries waiting for them
+     */
+    std::mutex m_log_mutex;
+
+    /**
+     * Sensor log requests one client query keeps in flight
+     */
+    const size_t m_fetch_window;
+
+    /**
+     * Seconds between the satellite's sensor samples, 0 when backfill is disabled
+     */
+    const uint32_t m_sample_interval;
+
+    /**
+     * Timer running the backfill job on the TCP server's io_context
+     */
+    boost::asio::steady_timer m_backfill_timer;
+
+    /**
+     * False once the server stops, so a pending backfill tick does nothing
+     */
+    std::atomic<bool> m_backfill_running;
+
+    /**
+     * True while a backfill job waits for the satellite, guarded by m_log_mutex
+     */
+    bool m_backfill_active;
+
+    /**
+     * Intervals the satellite did not answer for a backfill job, not tried again, guarded by m_log_mutex
+     */
+    CoverageMap m_backfill_failed;
+
+    /**
+     * Sensor log queries waiting for the satellite, in arrival order
+     */
+    std::vector<std::shared_ptr<LogQuery>> m_log_queries;
+
+    /**
+     * Sensor log fetches in flight, sorted by start; their ranges never overlap
+     */
+    std::vector<std::shared_ptr<LogFetch>> m_log_fetches;
+
+    /**
+     * Event log fetches in flight
+     */
+    std::vector<std::shared_ptr<EventFetch>> m_event_fetches;
+
     /**
      * Storage for historical sensor data
      */
     ServerDataManager m_sensor_data_manager;
     
     /**
-     * Map of response types to handler functions
+     * Clients receiving live beacons and events, with their filters
+     */
+    TelemetrySubscriptions m_subscriptions;
+    
+    /**
+     * Stream decoder splitting received bytes into packets and debug lines
+     */
+    FrameDecoder m_frame_decoder;
+
+    /**
+     * True when serial input is delivered asynchronously on the TCP server's io_context
+     */
+    bool m_async_receive;
+
+    /**
+     * Count of received packets with an unknown type
+     */
+    std::atomic<size_t> m_unknown_responses;
+
+    /**
+     * Single writer of the packets to the satellite, destroyed before the connection and the in-flight table
      */
-    std::unordered_map<ResponseType, ResponseHandler> m_response_handlers;
+    UplinkScheduler m_uplink;
 };
 
 } // namespace altair
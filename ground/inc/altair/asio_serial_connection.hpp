@@ -0,0 +1,142 @@
+#ifndef ASIO_SERIAL_CONNECTION_HPP
+#define ASIO_SERIAL_CONNECTION_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <boost/asio.hpp>
+#include "connection.hpp"
+
+namespace altair {
+
+/**
+ * @struct SerialSettings
+ * @brief Line settings and read behaviour for an AsioSerialConnection
+ */
+struct SerialSettings
+{
+    using port_base = boost::asio::serial_port_base;
+
+    unsigned int baud_rate = 115200;                                        ///< Line speed in bits per second
+    unsigned int character_size = 8;                                        ///< Data bits per character
+    port_base::parity::type parity = port_base::parity::none;               ///< Parity mode
+    port_base::stop_bits::type stop_bits = port_base::stop_bits::one;       ///< Number of stop bits
+    port_base::flow_control::type flow_control = port_base::flow_control::none; ///< Flow control mode
+    size_t read_chunk_size = 256;                                           ///< Maximum bytes delivered per completion
+};
+
+/**
+ * @class AsioSerialConnection
+ * @brief Serial port connection driven by a shared boost::asio io_context
+ *
+ * Unlike SerialConnection, this connection never blocks a thread waiting for
+ * input. Once start_async_receive() binds it to an io_context, every chunk
+ * read from the port is delivered to the receive handler as a completion on
+ * that io_context, so serial input is processed on the same event loop as
+ * TCP client commands and timers.
+ *
+ * The port is opened when the connection is bound to an io_context; send()
+ * fails until then. A port that cannot be opened, or fails while reading,
+ * is closed and opened again every REOPEN_DELAY until it comes back.
+ */
+class AsioSerialConnection : public Connection {
+public:
+    /**
+     * @brief Constructs an AsioSerialConnection for the specified port
+     * @param port Path to the serial port device (e.g., "/dev/ttyUSB0")
+     * @param settings Line settings and read chunk size
+     */
+    explicit AsioSerialConnection(const std::string& port, const SerialSettings& settings = SerialSettings());
+
+    /**
+     * @brief Destructor, closes the port if it is still open
+     */
+    ~AsioSerialConnection();
+
+    AsioSerialConnection(const AsioSerialConnection&) = delete;
+    AsioSerialConnection& operator=(const AsioSerialConnection&) = delete;
+
+    /**
+     * @brief Time between attempts to open a missing or failed port
+     */
+    static constexpr std::chrono::milliseconds REOPEN_DELAY{1000};
+
+    /**
+     * @brief Writes a message to the serial port
+     * @param message Vector of bytes to send
+     * @return Number of bytes sent, or -1 on error or if the port is not open
+     */
+    ssize_t send(const std::vector<uint8_t>& message) override;
+
+    /**
+     * @brief Reads available data synchronously
+     * @param message Reference to a vector where received data will be stored
+     * @param size Maximum number of bytes to receive
+     * @return Number of bytes received, or -1 on error or if the port is not open
+     */
+    ssize_t receive(std::vector<uint8_t>& message, size_t size) override;
+
+    /**
+     * @brief Opens the port on the given io_context and starts reading
+     * @param io_context Event loop that runs the read completions
+     * @param handler Function called with every received chunk
+     * @return Always true; if the port cannot be opened yet, it is retried on the io_context
+     */
+    bool start_async_receive(boost::asio::io_context& io_context, ReceiveHandler handler) override;
+
+    /**
+     * @brief Cancels the pending read and reopen, and closes the port
+     */
+    void stop_async_receive() override;
+
+    /**
+     * @brief Line capacity derived from the baud rate and the bits framing each character
+     */
+    size_t bytes_per_second() const override;
+
+    /**
+     * @brief Checks if the serial port is open
+     * @return true if the port is open, false otherwise
+     */
+    bool is_valid() const;
+
+private:
+    /**
+     * @brief Opens and configures the port, then issues the first read; m_mutex must be held
+     * @return true if the port is open
+     */
+    bool open_port();
+
+    /**
+     * @brief Tries open_port() again after REOPEN_DELAY; m_mutex must be held
+     */
+    void schedule_reopen();
+
+    /**
+     * @brief Issues the next asynchronous read; m_mutex must be held
+     */
+    void start_read();
+
+    /**
+     * @brief Completion handler for asynchronous reads
+     * @param error Any error that occurred during reading
+     * @param bytes_transferred Number of bytes read
+     */
+    void handle_read(const boost::system::error_code& error, size_t bytes_transferred);
+
+    std::string m_port_name;                            ///< Serial device path
+    SerialSettings m_settings;                          ///< Line settings applied on open
+    boost::asio::io_context* m_io_context;              ///< Event loop the port is bound to, nullptr when stopped
+    std::unique_ptr<boost::asio::serial_port> m_port;   ///< Port bound to the shared io_context
+    std::unique_ptr<boost::asio::steady_timer> m_reopen_timer; ///< Timer of the next open attempt
+    mutable std::mutex m_mutex;                         ///< Guards the port against sends from other threads
+    std::vector<uint8_t> m_read_buffer;                 ///< Reused buffer for asynchronous reads
+    ReceiveHandler m_handler;                           ///< Consumer of received chunks
+};
+
+} // namespace altair
+
+#endif // ASIO_SERIAL_CONNECTION_HPP
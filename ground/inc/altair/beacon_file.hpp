@@ -0,0 +1,67 @@
+#ifndef BEACON_FILE_HPP
+#define BEACON_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include "packet_parser.hpp"
+
+namespace altair {
+
+/**
+ * @class BeaconFile
+ * @brief Fixed-size file keeping only the latest beacon, overwritten in place
+ *
+ * File layout, all integers little-endian:
+ *
+ *     slot 0  [crc32 u32][sequence u32][record SENSOR_RECORD_SIZE bytes]
+ *     slot 1  same as slot 0
+ *
+ * Writes alternate between the two slots and the valid slot with the
+ * higher sequence holds the latest beacon, so a write torn by a crash
+ * leaves the previous beacon intact. The file never grows, however many
+ * beacons arrive. Writes are not synced: a crash may lose the newest
+ * beacons, which the satellite sends again anyway.
+ */
+class BeaconFile {
+public:
+    /**
+     * @brief Opens or creates the file and reads the beacon it holds
+     * @param path Path of the file
+     * @param latest Receives the latest beacon, left empty if the file holds none
+     * @return The file, or nullptr if it cannot be opened
+     */
+    static std::unique_ptr<BeaconFile> open(const std::string& path, std::optional<SensorData>& latest);
+
+    /**
+     * @brief Closes the file
+     */
+    ~BeaconFile();
+
+    BeaconFile(const BeaconFile&) = delete;
+    BeaconFile& operator=(const BeaconFile&) = delete;
+
+    /**
+     * @brief Replaces the stored beacon
+     * @return False if the write failed
+     */
+    bool write(const SensorData& data);
+
+    /**
+     * @brief Forgets the stored beacon
+     * @return False if the file cannot be emptied
+     */
+    bool clear();
+
+private:
+    BeaconFile(int fd, uint32_t sequence);
+
+    const int m_fd;
+    uint32_t m_sequence;    ///< Sequence of the latest write, 0 when the file is empty
+};
+
+} // namespace altair
+
+#endif // BEACON_FILE_HPP
@@ -0,0 +1,117 @@
+#ifndef BINARY_PROTOCOL_HPP
+#define BINARY_PROTOCOL_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace altair {
+
+/**
+ * @namespace altair::binary
+ * @brief Length-prefixed client protocol, negotiated with the "binary" text command
+ *
+ * After a client sends "binary\n" on the text CLI, both directions of the
+ * connection carry frames of the form
+ *
+ *     [length: u16 LE][kind: u8][tag: u8][body]
+ *
+ * where length counts kind, tag and body. The tag of a request is chosen by
+ * the client and echoed in every frame of its reply; unsolicited frames
+ * (live telemetry, text from the server) carry tag 0. Record bodies use the
+ * wire layout of packet_schema.h, so a client can copy them straight into
+ * packed structs. Text replies of the command handlers are delivered as
+ * REPLY_TEXT frames.
+ */
+namespace binary {
+
+/**
+ * @brief Size of the length field
+ */
+constexpr size_t LENGTH_SIZE = 2;
+
+/**
+ * @brief Size of the length, kind and tag fields
+ */
+constexpr size_t FRAME_HEADER_SIZE = 4;
+
+/**
+ * @brief Largest body a frame can carry
+ */
+constexpr size_t MAX_BODY_SIZE = 0xFFFF - (FRAME_HEADER_SIZE - LENGTH_SIZE);
+
+/**
+ * @enum FrameKind
+ * @brief Meaning of a frame
+ */
+enum FrameKind : uint8_t {
+    // Client requests
+    REQUEST_SENSOR_DATA   = 0x01,   ///< No body, answered by REPLY_SENSOR_RECORDS with the latest beacon
+    REQUEST_SENSOR_LOGS   = 0x02,   ///< TIME_RANGE body, answered by REPLY_SENSOR_RECORDS frames and REPLY_END
+    REQUEST_EVENT_LOGS    = 0x03,   ///< TIME_RANGE body, answered by REPLY_EVENT_RECORDS frames and REPLY_END
+    REQUEST_CURRENT_TIME  = 0x04,   ///< No body, answered by REPLY_TIME
+    REQUEST_SUBSCRIBE     = 0x05,   ///< Filter terms of the subscribe command as text, telemetry follows with tag 0
+    REQUEST_UNSUBSCRIBE   = 0x06,   ///< No body
+    REQUEST_COMMAND       = 0x07,   ///< A text command line, answered by REPLY_TEXT
+
+    // Server replies
+    REPLY_TEXT            = 0x80,   ///< Human readable text
+    REPLY_ERROR           = 0x81,   ///< The request failed, body is the reason
+    REPLY_SENSOR_RECORDS  = 0x82,   ///< Array of SENSOR_RECORD_SIZE byte records
+    REPLY_EVENT_RECORDS   = 0x83,   ///< Array of EVENT_RECORD_SIZE byte records
+    REPLY_TIME            = 0x84,   ///< TIME_VALUE body
+    REPLY_END             = 0x85,   ///< The multi-frame reply with this tag is complete
+    REPLY_OK              = 0x86,   ///< The request succeeded, no body
+};
+
+/**
+ * @brief Appends a frame header to a buffer
+ * @param out Buffer receiving the header
+ * @param kind Frame kind
+ * @param tag Request tag
+ * @param body_size Size of the body that will follow, at most MAX_BODY_SIZE
+ */
+inline void append_header(std::string& out, uint8_t kind, uint8_t tag, size_t body_size)
+{
+    size_t length = body_size + FRAME_HEADER_SIZE - LENGTH_SIZE;
+    out.push_back(static_cast<char>(length & 0xFF));
+    out.push_back(static_cast<char>((length >> 8) & 0xFF));
+    out.push_back(static_cast<char>(kind));
+    out.push_back(static_cast<char>(tag));
+}
+
+/**
+ * @brief Appends a complete frame to a buffer
+ * @param out Buffer receiving the frame
+ * @param kind Frame kind
+ * @param tag Request tag
+ * @param body Body bytes
+ * @param size Body size, at most MAX_BODY_SIZE
+ */
+inline void append_frame(std::string& out, uint8_t kind, uint8_t tag, const void* body, size_t size)
+{
+    append_header(out, kind, tag, size);
+    out.append(static_cast<const char*>(body), size);
+}
+
+/**
+ * @brief Appends text as one or more REPLY_TEXT frames
+ * @param out Buffer receiving the frames
+ * @param text The text; split across frames if longer than MAX_BODY_SIZE
+ * @param tag Request tag
+ */
+inline void append_text_frames(std::string& out, std::string_view text, uint8_t tag = 0)
+{
+    do {
+        size_t size = text.size() < MAX_BODY_SIZE ? text.size() : MAX_BODY_SIZE;
+        append_frame(out, REPLY_TEXT, tag, text.data(), size);
+        text.remove_prefix(size);
+    } while (!text.empty());
+}
+
+} // namespace binary
+
+} // namespace altair
+
+#endif // BINARY_PROTOCOL_HPP
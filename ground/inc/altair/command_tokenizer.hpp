@@ -0,0 +1,109 @@
+#ifndef COMMAND_TOKENIZER_HPP
+#define COMMAND_TOKENIZER_HPP
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+namespace altair {
+
+/**
+ * @class CommandTokenizer
+ * @brief Splits a client command line into whitespace separated tokens
+ *
+ * The tokenizer only holds a view of the line; tokens are views into it and
+ * numbers are parsed in place with std::from_chars, so tokenizing a command
+ * never allocates. The line must outlive the tokenizer and its tokens.
+ */
+class CommandTokenizer {
+public:
+    /**
+     * @brief Constructs a tokenizer over a command line
+     * @param line The command line
+     */
+    explicit constexpr CommandTokenizer(std::string_view line) : m_rest(line) {}
+
+    /**
+     * @brief Returns the next token
+     * @return The token, or an empty view if the line is exhausted
+     */
+    constexpr std::string_view next()
+    {
+        skip_spaces();
+
+        size_t end = 0;
+        while (end < m_rest.size() && !is_space(m_rest[end])) {
+            ++end;
+        }
+
+        std::string_view token = m_rest.substr(0, end);
+        m_rest.remove_prefix(end);
+        return token;
+    }
+
+    /**
+     * @brief Parses the next token as a number
+     * @tparam T Integral or floating point type
+     * @param value Receives the number; left untouched on failure
+     * @return False if there is no token, it is not a number or it is out of range for T
+     *
+     * The whole token must be the number; "12abc" is rejected.
+     */
+    template<typename T>
+    bool next_number(T& value)
+    {
+        static_assert(std::is_arithmetic<T>::value, "next_number supports arithmetic types only");
+
+        std::string_view token = next();
+        if (token.empty()) {
+            return false;
+        }
+
+        const char* first = token.data();
+        const char* last = token.data() + token.size();
+        if (*first == '+') {
+            ++first;
+        }
+
+        T parsed{};
+        auto result = std::from_chars(first, last, parsed);
+        if (first == last || result.ec != std::errc() || result.ptr != last) {
+            return false;
+        }
+
+        value = parsed;
+        return true;
+    }
+
+    /**
+     * @brief Checks whether any token is left
+     */
+    constexpr bool empty()
+    {
+        skip_spaces();
+        return m_rest.empty();
+    }
+
+private:
+    static constexpr bool is_space(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    constexpr void skip_spaces()
+    {
+        size_t start = 0;
+        while (start < m_rest.size() && is_space(m_rest[start])) {
+            ++start;
+        }
+        m_rest.remove_prefix(start);
+    }
+
+    std::string_view m_rest;    ///< Part of the line not consumed yet
+};
+
+} // namespace altair
+
+#endif // COMMAND_TOKENIZER_HPP
@@ -3,8 +3,11 @@
 
 #include <vector> 
 #include <cstdint>
+#include <functional>
 #include <sys/types.h> // for ssize_t
 
+namespace boost { namespace asio { class io_context; } }
+
 namespace altair {
 
 /**
@@ -17,10 +20,17 @@ namespace altair {
  * to work with different connection types interchangeably.
  *
  * Derived classes must implement the send() and receive() methods to handle
- * the specific communication protocol they represent.
+ * the specific communication protocol they represent. Connections that can
+ * be driven by an event loop also override start_async_receive().
  */
 class Connection {
 public:
+    /**
+     * @typedef ReceiveHandler
+     * @brief Function called with each chunk of data received asynchronously
+     */
+    using ReceiveHandler = std::function<void(const uint8_t*, size_t)>;
+
     /**
      * @brief Virtual destructor
      *
@@ -44,7 +54,33 @@ public:
      * @param size Maximum number of bytes to receive
      * @return ssize_t Number of bytes received, or negative value on error
      */
-    virtual ssize_t receive(std::vector<uint8_t>& message, uint8_t size) = 0;
+    virtual ssize_t receive(std::vector<uint8_t>& message, size_t size) = 0;
+
+    /**
+     * @brief Start delivering received data through an io_context
+     *
+     * The default implementation does not support asynchronous reception,
+     * in which case the caller falls back to blocking receive() calls.
+     *
+     * @param io_context Event loop that runs the completion handlers
+     * @param handler Function called with every received chunk
+     * @return true if asynchronous reception was started, false otherwise
+     */
+    virtual bool start_async_receive(boost::asio::io_context&, ReceiveHandler) { return false; }
+
+    /**
+     * @brief Stop asynchronous reception and release event loop resources
+     *
+     * Must be called before the io_context passed to start_async_receive()
+     * is destroyed.
+     */
+    virtual void stop_async_receive() {}
+
+    /**
+     * @brief Line capacity, used to pace the data sent
+     * @return Bytes per second the line carries, 0 if it is not rate limited
+     */
+    virtual size_t bytes_per_second() const { return 0; }
 
 protected:
     /**
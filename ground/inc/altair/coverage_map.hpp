@@ -0,0 +1,67 @@
+#ifndef COVERAGE_MAP_HPP
+#define COVERAGE_MAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace altair {
+
+/**
+ * @class CoverageMap
+ * @brief Set of time intervals, stored as disjoint, non-adjacent inclusive ranges
+ *
+ * Used for the stretches of satellite history known to be held completely
+ * on the ground. Adding an interval merges it with every range it overlaps
+ * or touches, so the map stays as small as the number of separate
+ * stretches.
+ */
+class CoverageMap {
+public:
+    /**
+     * @typedef Interval
+     * @brief Inclusive [first, second] time range
+     */
+    using Interval = std::pair<uint32_t, uint32_t>;
+
+    /**
+     * @brief Adds an interval
+     * @param start First second of the interval
+     * @param end Last second of the interval, ignored when before start
+     */
+    void add(uint32_t start, uint32_t end);
+
+    /**
+     * @brief Checks whether an interval is covered completely
+     */
+    bool covers(uint32_t start, uint32_t end) const;
+
+    /**
+     * @brief Returns the parts of an interval that are not covered, in time order
+     */
+    std::vector<Interval> missing(uint32_t start, uint32_t end) const;
+
+    /**
+     * @brief Returns every covered range, in time order
+     */
+    std::vector<Interval> intervals() const;
+
+    /**
+     * @brief Removes every interval
+     */
+    void clear();
+
+    /**
+     * @brief Number of disjoint ranges
+     */
+    size_t size() const { return m_ranges.size(); }
+
+private:
+    std::map<uint32_t, uint32_t> m_ranges; // Start to inclusive end
+};
+
+} // namespace altair
+
+#endif // COVERAGE_MAP_HPP
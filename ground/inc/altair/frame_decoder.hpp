@@ -0,0 +1,106 @@
+#ifndef FRAME_DECODER_HPP
+#define FRAME_DECODER_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include "packet_parser.hpp"
+
+namespace altair {
+
+/**
+ * @class FrameDecoder
+ * @brief Incremental decoder for the byte stream received from the satellite
+ *
+ * The UART link carries two kinds of traffic: binary packets
+ * (length, type, id, checksum, payload, END_MARK) and newline terminated
+ * debug text printed by the firmware. The decoder accepts the stream in
+ * arbitrary chunks, emits every complete packet or text line found in a
+ * chunk and keeps partial data until the next call, so packets split across
+ * reads are reassembled. Bytes that cannot start a valid packet are dropped
+ * one at a time until the stream lines up with a packet boundary again.
+ */
+class FrameDecoder {
+public:
+    /**
+     * @typedef FrameHandler
+     * @brief Called with each complete packet, including the length byte and END_MARK
+     */
+    using FrameHandler = std::function<void(const uint8_t*, size_t)>;
+
+    /**
+     * @typedef TextHandler
+     * @brief Called with each debug text line, including the trailing newline
+     */
+    using TextHandler = std::function<void(const char*, size_t)>;
+
+    /**
+     * @brief Largest packet the decoder accepts (header + 128 byte payload + end mark)
+     */
+    static constexpr size_t MAX_FRAME_SIZE = 133;
+
+    /**
+     * @brief Longest debug line kept before it is flushed without a newline
+     */
+    static constexpr size_t MAX_TEXT_LINE = 256;
+
+    /**
+     * @brief Constructs a decoder with the given output handlers
+     * @param on_frame Handler invoked for every complete packet
+     * @param on_text Handler invoked for every debug text line
+     */
+    FrameDecoder(FrameHandler on_frame, TextHandler on_text);
+
+    /**
+     * @brief Feeds a chunk of received bytes into the decoder
+     * @param data Pointer to the received bytes
+     * @param len Number of received bytes
+     *
+     * Handlers are invoked synchronously for every packet or line completed
+     * by this chunk. Pointers passed to the handlers are only valid for the
+     * duration of the call.
+     */
+    void feed(const uint8_t* data, size_t len);
+
+    /**
+     * @brief Discards any partially received packet or line
+     */
+    void reset();
+
+    /**
+     * @brief Number of bytes skipped while resynchronising
+     * @return Count of dropped bytes since construction or the last reset
+     */
+    size_t dropped_bytes() const;
+
+private:
+    /**
+     * @brief Decoder state at the start of the unconsumed data
+     */
+    enum class State {
+        IDLE,       ///< Waiting for a length byte or the first text character
+        FRAME,      ///< Collecting a packet of m_expected bytes
+        TEXT,       ///< Collecting a debug line up to '\n'
+    };
+
+    /**
+     * @brief Consumes as many complete units as possible from a buffer
+     * @param data Start of the unconsumed bytes
+     * @param len Number of unconsumed bytes
+     * @return Number of bytes consumed; the rest belongs to an incomplete unit
+     */
+    size_t decode(const uint8_t* data, size_t len);
+
+    FrameHandler m_on_frame;        ///< Packet output handler
+    TextHandler m_on_text;          ///< Debug line output handler
+    State m_state;                  ///< Current decoding state
+    size_t m_expected;              ///< Packet length announced by the length byte
+    size_t m_scanned;               ///< Text bytes already searched for '\n'
+    size_t m_dropped;               ///< Bytes dropped while resynchronising
+    std::vector<uint8_t> m_pending; ///< Incomplete unit carried over between chunks
+};
+
+} // namespace altair
+
+#endif // FRAME_DECODER_HPP
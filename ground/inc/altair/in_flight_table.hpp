@@ -0,0 +1,227 @@
+#ifndef IN_FLIGHT_TABLE_HPP
+#define IN_FLIGHT_TABLE_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <boost/asio.hpp>
+#include "id_generator.hpp"
+
+namespace altair {
+
+class ClientSession;
+
+/**
+ * @class RequestContext
+ * @brief Base of state a request owner attaches to an in-flight request
+ */
+class RequestContext {
+public:
+    virtual ~RequestContext() = default;
+};
+
+/**
+ * @class InFlightTable
+ * @brief Tracks requests sent to the satellite until their reply arrives or times out
+ *
+ * The table has one slot per 8-bit request ID. Each slot owns its own lock,
+ * a generation counter and a deadline, so the TCP io thread registering a
+ * request and the thread handling satellite replies only contend on the one
+ * slot they touch. A periodic timer on the shared io_context sweeps the slot
+ * deadlines and hands expired requests to the timeout handler. A request's
+ * deadline only starts once it is written to the link (see mark_sent), so a
+ * request queued behind others on the ground cannot expire before the
+ * satellite has even seen it. ID 0xFF is
+ * never allocated because the satellite uses it for unsolicited packets
+ * (beacons and events).
+ */
+class InFlightTable {
+public:
+    /**
+     * @typedef TimeoutHandler
+     * @brief Called on the io_context for every request whose deadline passed,
+     *        with the request ID, the client's tag, the client and the request's context
+     */
+    using TimeoutHandler = std::function<void(uint8_t, uint8_t, std::shared_ptr<ClientSession>,
+                                              std::shared_ptr<RequestContext>)>;
+
+    /**
+     * @brief Number of request IDs
+     */
+    static constexpr size_t SLOT_COUNT = 256;
+
+    /**
+     * @brief ID reserved for unsolicited satellite packets
+     */
+    static constexpr uint8_t RESERVED_ID = 0xFF;
+
+    /**
+     * @struct Ticket
+     * @brief An acquired request ID together with the generation it was handed out in
+     */
+    struct Ticket
+    {
+        uint8_t id;             ///< Request ID
+        uint32_t generation;    ///< Generation of the ID while this request owns it
+    };
+
+    /**
+     * @brief Constructs the table
+     * @param io_context Event loop that runs the expiry timer
+     * @param timeout Time a request may wait for its reply before it expires
+     * @param tick Interval between deadline sweeps
+     */
+    InFlightTable(boost::asio::io_context& io_context,
+                  std::chrono::milliseconds timeout = std::chrono::seconds(10),
+                  std::chrono::milliseconds tick = std::chrono::milliseconds(250));
+
+    InFlightTable(const InFlightTable&) = delete;
+    InFlightTable& operator=(const InFlightTable&) = delete;
+
+    /**
+     * @brief Sets the handler for expired requests
+     * @param handler Function called with the ID, tag and client of each expired request
+     */
+    void set_timeout_handler(TimeoutHandler handler);
+
+    /**
+     * @brief Starts the periodic deadline sweep
+     */
+    void start();
+
+    /**
+     * @brief Stops the deadline sweep
+     */
+    void stop();
+
+    /**
+     * @brief Allocates a free request ID and registers the requesting client
+     * @param client Client to reply to, or nullptr if nobody waits for the reply
+     * @param tag Client chosen request tag echoed in binary replies, 0 for text clients
+     * @param context State of the request handed back with its replies, or nullptr
+     * @return The allocated ID and its generation, or empty if all IDs are in flight
+     *
+     * IDs are taken from the IDGenerator sequence, skipping IDs that are
+     * still in flight and the reserved ID. The generation is read under the
+     * slot's lock, so it names this request even if a stale reply frees the
+     * ID right after. The request does not expire until mark_sent is called.
+     */
+    std::optional<Ticket> acquire(std::shared_ptr<ClientSession> client, uint8_t tag = 0,
+                                  std::shared_ptr<RequestContext> context = nullptr);
+
+    /**
+     * @brief Gets the current generation of an ID
+     * @param id Request ID
+     * @return Value that changes every time the ID is freed
+     */
+    uint32_t generation(uint8_t id) const;
+
+    /**
+     * @brief Starts the reply timeout of a request that is being written to the link
+     * @param id Request ID
+     * @param generation Generation of the ID when the request was queued
+     * @return False if the request ended while queued, its ID possibly serving another request by now;
+     *         the packet must then not be written
+     */
+    bool mark_sent(uint8_t id, uint32_t generation);
+
+    /**
+     * @brief Checks whether a request ID is in flight
+     * @param id Request ID
+     */
+    bool is_in_flight(uint8_t id) const;
+
+    /**
+     * @brief Looks up the client of an in-flight request and extends its deadline
+     * @param id Request ID
+     * @param tag If not null, receives the client's request tag
+     * @param context If not null, receives the request's context
+     * @return The waiting client, or nullptr if the ID is not in flight or has no client
+     *
+     * Used for multi-packet replies such as log dumps, where every packet
+     * proves the request is still alive. The deadline of a request not sent
+     * yet is left alone.
+     */
+    std::shared_ptr<ClientSession> find(uint8_t id, uint8_t* tag = nullptr,
+                                        std::shared_ptr<RequestContext>* context = nullptr);
+
+    /**
+     * @brief Looks up the context of a request without touching its deadline
+     * @param id Request ID
+     * @param generation Generation of the ID the caller holds
+     * @return The request's context, or nullptr if the ID is not in flight or now serves another request
+     *
+     * Used to inspect queued packets, which must not keep a request alive.
+     */
+    std::shared_ptr<RequestContext> peek(uint8_t id, uint32_t generation) const;
+
+    /**
+     * @brief Completes an in-flight request and frees its ID
+     * @param id Request ID
+     * @param tag If not null, receives the client's request tag
+     * @param context If not null, receives the request's context
+     * @return The waiting client, or nullptr if the ID was not in flight or has no client
+     */
+    std::shared_ptr<ClientSession> release(uint8_t id, uint8_t* tag = nullptr,
+                                           std::shared_ptr<RequestContext>* context = nullptr);
+
+    /**
+     * @brief Number of requests currently in flight
+     */
+    size_t in_flight_count() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @struct Slot
+     * @brief State of one request ID
+     */
+    struct Slot
+    {
+        std::atomic<bool> busy{false};              ///< Set while a request owns the ID
+        std::atomic<uint32_t> generation{0};        ///< Incremented every time the ID is freed
+        std::atomic<int64_t> deadline{0};           ///< Expiry time in Clock ticks, NOT_SENT while queued
+        mutable std::mutex mutex;                   ///< Guards client, tag and context
+        std::shared_ptr<ClientSession> client;      ///< Client waiting for the reply
+        uint8_t tag = 0;                            ///< Client's own request tag
+        std::shared_ptr<RequestContext> context;    ///< Owner's state of the request
+    };
+
+    /**
+     * @brief Schedules the next deadline sweep
+     */
+    void schedule_tick();
+
+    /**
+     * @brief Expires every in-flight request whose deadline has passed
+     */
+    void sweep();
+
+    /**
+     * @brief Deadline of a request that is not written to the link yet
+     */
+    static constexpr int64_t NOT_SENT = INT64_MAX;
+
+    /**
+     * @brief Current time plus the request timeout, in Clock ticks
+     */
+    int64_t next_deadline() const;
+
+    IDGenerator& m_id_generator;                    ///< Source of candidate IDs
+    std::chrono::milliseconds m_timeout;            ///< Reply timeout per request
+    std::chrono::milliseconds m_tick;               ///< Sweep interval
+    boost::asio::steady_timer m_timer;              ///< Drives the deadline sweep
+    std::atomic<bool> m_running;                    ///< Whether the sweep is scheduled
+    TimeoutHandler m_on_timeout;                    ///< Handler for expired requests
+    std::array<Slot, SLOT_COUNT> m_slots;           ///< One slot per request ID
+};
+
+} // namespace altair
+
+#endif // IN_FLIGHT_TABLE_HPP
@@ -0,0 +1,323 @@
+#ifndef LOGGER_HPP
+#define LOGGER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include "mpsc_ring.hpp"
+
+namespace altair {
+
+/**
+ * @enum LogLevel
+ * @brief Severity of a log record
+ */
+enum class LogLevel : uint8_t {
+    DEBUG = 0,      ///< Per-request and per-frame detail
+    INFO,           ///< Telemetry and connection events
+    WARN,           ///< Recoverable problems
+    ERROR,          ///< Failures
+};
+
+/**
+ * @class LogRateLimiter
+ * @brief Lets at most a burst of messages through per period
+ *
+ * Meant to be kept next to a message that can repeat quickly, such as a read
+ * error in a loop, usually as a function local static. The limiter counts the
+ * messages it held back and the next message let through reports the count.
+ * It is lock-free and safe to share between threads.
+ */
+class LogRateLimiter {
+public:
+    /**
+     * @brief Constructs a limiter
+     * @param burst Messages allowed per period
+     * @param period Length of a period
+     */
+    LogRateLimiter(uint32_t burst, std::chrono::steady_clock::duration period);
+
+    /**
+     * @brief Decides whether a message may be logged now
+     * @param suppressed Receives the number of messages held back since the last one let through
+     * @return True if the message may be logged
+     */
+    bool allow(uint32_t& suppressed);
+
+private:
+    const uint32_t m_burst;
+    const int64_t m_period;                     ///< Period in steady clock ticks
+    std::atomic<int64_t> m_window_start;        ///< Start of the current period in steady clock ticks
+    std::atomic<uint32_t> m_count;              ///< Messages seen in the current period
+    std::atomic<uint32_t> m_suppressed;         ///< Messages held back since the last one let through
+};
+
+/**
+ * @class Logger
+ * @brief Process wide asynchronous logger
+ *
+ * Logging threads never block and never take a lock: a call copies its record
+ * into a lock-free ring and returns. A background writer thread drains the ring,
+ * formats the records and writes them to stdout or a file in batches, with one
+ * write and flush per batch. Text records are composed from their parts
+ * straight into the ring cell; binary records hold a trivially copyable value
+ * and a function that formats it on the writer thread, so telemetry structs
+ * are only turned into text off the telemetry path. When the ring is full the
+ * record is dropped and counted, and the writer reports the count.
+ */
+class Logger {
+public:
+    /**
+     * @brief Formats a binary record on the writer thread
+     * @param out Text to append to
+     * @param payload The copied value
+     */
+    using RecordFormatter = void (*)(std::string& out, const void* payload);
+
+    /**
+     * @brief Bytes available for the text or value of one record; longer text is truncated
+     */
+    static constexpr size_t PAYLOAD_SIZE = 200;
+
+    /**
+     * @brief Number of records the ring holds before records are dropped
+     */
+    static constexpr size_t RING_CAPACITY = 4096;
+
+    /**
+     * @brief Returns the process wide logger, starting its writer thread on first use
+     */
+    static Logger& getInstance();
+
+    /**
+     * @brief Drains the ring, stops the writer thread and closes the log file
+     */
+    ~Logger();
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    /**
+     * @brief Sets the lowest level that is logged, records below it cost one atomic load
+     */
+    void set_level(LogLevel level);
+
+    /**
+     * @brief Checks whether records of a level are logged
+     */
+    bool enabled(LogLevel level) const
+    {
+        return level >= m_level.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Appends the log to a file instead of stdout
+     * @param path Path of the log file
+     * @return False if the file cannot be opened; the output is unchanged then
+     */
+    bool set_output_file(const std::string& path);
+
+    /**
+     * @brief Writes the log to stdout, the default
+     */
+    void set_output_stdout();
+
+    /**
+     * @brief Logs a text record made of the given parts
+     * @param level Severity
+     * @param parts Strings, characters and numbers, concatenated without separators
+     */
+    template<typename... Parts>
+    void log(LogLevel level, const Parts&... parts)
+    {
+        if (enabled(level)) {
+            push_text(level, 0, parts...);
+        }
+    }
+
+    /**
+     * @brief Logs a text record unless the limiter holds it back
+     * @param level Severity
+     * @param limiter Limiter of this message
+     * @param parts Strings, characters and numbers, concatenated without separators
+     */
+    template<typename... Parts>
+    void log(LogLevel level, LogRateLimiter& limiter, const Parts&... parts)
+    {
+        uint32_t suppressed = 0;
+        if (enabled(level) && limiter.allow(suppressed)) {
+            push_text(level, suppressed, parts...);
+        }
+    }
+
+    /**
+     * @brief Logs a value that is formatted on the writer thread
+     * @param level Severity
+     * @param formatter Called on the writer thread with a copy of the value
+     * @param value The value, copied byte for byte
+     */
+    template<typename T>
+    void log_record(LogLevel level, RecordFormatter formatter, const T& value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Binary log records are copied byte for byte");
+        static_assert(sizeof(T) <= PAYLOAD_SIZE, "Value does not fit into a log record");
+
+        if (!enabled(level)) {
+            return;
+        }
+        push([&](Record& record) {
+            record.level = level;
+            record.formatter = formatter;
+            record.size = static_cast<uint16_t>(sizeof(T));
+            std::memcpy(record.payload, &value, sizeof(T));
+        });
+    }
+
+    /**
+     * @brief Blocks until every record logged before the call has been written
+     */
+    void flush();
+
+    /**
+     * @brief Returns the number of records dropped because the ring was full
+     */
+    uint64_t dropped() const;
+
+private:
+    /**
+     * @struct Record
+     * @brief One ring cell
+     */
+    struct Record
+    {
+        int64_t time;                   ///< System clock time of the call, in nanoseconds since the epoch
+        LogLevel level;
+        uint16_t size;                  ///< Bytes used in payload
+        uint32_t suppressed;            ///< Messages a rate limiter held back before this one
+        RecordFormatter formatter;      ///< Null for text records
+        char payload[PAYLOAD_SIZE];
+    };
+
+    Logger();
+
+    template<typename Fill>
+    void push(Fill&& fill)
+    {
+        int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+
+        bool pushed = m_ring.try_push([&](Record& record) {
+            record.time = now;
+            record.suppressed = 0;
+            fill(record);
+        });
+
+        if (!pushed) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        m_pushed.fetch_add(1, std::memory_order_release);
+
+        // Only the first record after the writer went idle pays for a wake-up
+        if (m_writer_idle.exchange(false, std::memory_order_acq_rel)) {
+            m_wakeup.notify_one();
+        }
+    }
+
+    template<typename... Parts>
+    void push_text(LogLevel level, uint32_t suppressed, const Parts&... parts)
+    {
+        push([&](Record& record) {
+            record.level = level;
+            record.formatter = nullptr;
+            char* cursor = record.payload;
+            char* end = record.payload + PAYLOAD_SIZE;
+            (append_part(cursor, end, parts), ...);
+            record.size = static_cast<uint16_t>(cursor - record.payload);
+            record.suppressed = suppressed;
+        });
+    }
+
+    static void append_part(char*& cursor, char* end, std::string_view text)
+    {
+        size_t size = std::min(text.size(), static_cast<size_t>(end - cursor));
+        std::memcpy(cursor, text.data(), size);
+        cursor += size;
+    }
+
+    static void append_part(char*& cursor, char* end, const char* text)
+    {
+        append_part(cursor, end, std::string_view(text));
+    }
+
+    static void append_part(char*& cursor, char* end, const std::string& text)
+    {
+        append_part(cursor, end, std::string_view(text));
+    }
+
+    static void append_part(char*& cursor, char* end, char c)
+    {
+        if (cursor != end) {
+            *cursor++ = c;
+        }
+    }
+
+    template<typename T, typename = std::enable_if_t<std::is_arithmetic<T>::value>>
+    static void append_part(char*& cursor, char* end, T value)
+    {
+        if constexpr (std::is_floating_point<T>::value) {
+            auto result = std::to_chars(cursor, end, static_cast<double>(value), std::chars_format::fixed, 2);
+            cursor = result.ec == std::errc() ? result.ptr : cursor;
+        } else {
+            // Promote 8-bit values so they print as numbers rather than characters
+            auto result = std::to_chars(cursor, end, +value);
+            cursor = result.ec == std::errc() ? result.ptr : cursor;
+        }
+    }
+
+    /**
+     * @brief Body of the writer thread
+     */
+    void run();
+
+    /**
+     * @brief Appends one formatted record to the batch
+     */
+    static void format(const Record& record, std::string& out);
+
+    /**
+     * @brief Writes a batch to the current output
+     */
+    void write(const std::string& batch);
+
+    MpscRing<Record, RING_CAPACITY> m_ring;
+    std::atomic<LogLevel> m_level;
+    std::atomic<uint64_t> m_pushed;         ///< Records accepted by the ring
+    std::atomic<uint64_t> m_dropped;        ///< Records refused by a full ring
+    std::atomic<bool> m_writer_idle;        ///< The writer is about to wait or waiting for records
+    std::atomic<bool> m_stop;
+
+    std::mutex m_wakeup_mutex;
+    std::condition_variable m_wakeup;       ///< Wakes the writer
+    std::condition_variable m_written_cv;   ///< Signals flush() callers
+    uint64_t m_written;                     ///< Records written, guarded by m_wakeup_mutex
+
+    std::mutex m_output_mutex;
+    FILE* m_output;                         ///< stdout or the log file, guarded by m_output_mutex
+
+    std::thread m_writer;
+};
+
+} // namespace altair
+
+#endif // LOGGER_HPP
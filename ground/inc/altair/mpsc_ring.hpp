@@ -0,0 +1,117 @@
+#ifndef MPSC_RING_HPP
+#define MPSC_RING_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+namespace altair {
+
+/**
+ * @class MpscRing
+ * @brief Bounded lock-free queue with many producers and a single consumer
+ *
+ * Every cell carries a sequence number telling whose turn it is: a producer
+ * claims the cell at the enqueue position with one compare-and-swap, fills it
+ * in place and publishes it by advancing the sequence; the consumer reads
+ * cells in order and hands them back the same way. Producers never wait for
+ * each other or for the consumer, a full ring makes try_push fail instead.
+ *
+ * @tparam T Element type, copied into and out of the ring
+ * @tparam Capacity Number of cells, a power of two
+ */
+template<typename T, size_t Capacity>
+class MpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    static_assert(std::is_trivially_copyable<T>::value, "Ring elements are copied byte for byte");
+
+public:
+    MpscRing()
+    {
+        for (size_t i = 0; i < Capacity; ++i) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    /**
+     * @brief Claims a cell, lets the caller fill it and publishes it
+     * @param fill Called with a reference to the claimed element
+     * @return False if the ring is full; fill is not called then
+     *
+     * Safe to call from any number of threads at once.
+     */
+    template<typename Fill>
+    bool try_push(Fill&& fill)
+    {
+        size_t position = m_enqueue.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &m_cells[position & (Capacity - 1)];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            auto difference = static_cast<std::ptrdiff_t>(sequence - position);
+            if (difference == 0) {
+                if (m_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                // The consumer has not freed this cell yet
+                return false;
+            } else {
+                position = m_enqueue.load(std::memory_order_relaxed);
+            }
+        }
+
+        fill(cell->value);
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Hands the oldest published element to the caller and frees its cell
+     * @param consume Called with a const reference to the element
+     * @return False if no element is ready
+     *
+     * Must only be called from the consumer thread.
+     */
+    template<typename Consume>
+    bool try_pop(Consume&& consume)
+    {
+        Cell& cell = m_cells[m_dequeue & (Capacity - 1)];
+        if (cell.sequence.load(std::memory_order_acquire) != m_dequeue + 1) {
+            return false;
+        }
+
+        consume(static_cast<const T&>(cell.value));
+        cell.sequence.store(m_dequeue + Capacity, std::memory_order_release);
+        ++m_dequeue;
+        return true;
+    }
+
+    /**
+     * @brief Checks, from the consumer thread, whether the next element is ready
+     */
+    bool ready() const
+    {
+        const Cell& cell = m_cells[m_dequeue & (Capacity - 1)];
+        return cell.sequence.load(std::memory_order_acquire) == m_dequeue + 1;
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence{0};
+        T value;
+    };
+
+    std::array<Cell, Capacity> m_cells;
+    alignas(64) std::atomic<size_t> m_enqueue{0};   ///< Next position a producer claims
+    alignas(64) size_t m_dequeue = 0;               ///< Next position the consumer reads
+};
+
+} // namespace altair
+
+#endif // MPSC_RING_HPP
@@ -0,0 +1,198 @@
+#ifndef PACKET_CODEC_HPP
+#define PACKET_CODEC_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include "packet_schema.h"
+#include "packet_parser.hpp"
+
+namespace altair {
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "packet codec copies fields in host order, which must match the little-endian wire format");
+
+namespace schema {
+
+/**
+ * @struct Field
+ * @brief One fixed-offset field of a payload record
+ * @tparam T Wire type of the field
+ * @tparam Offset Byte offset of the field from the start of the record
+ */
+template<typename T, size_t Offset>
+struct Field
+{
+    static_assert(std::is_trivially_copyable<T>::value, "schema fields must be trivially copyable");
+
+    using type = T;
+    static constexpr size_t offset = Offset;
+
+    /**
+     * @brief Reads the field from a record buffer
+     * @param record Pointer to the first byte of the record
+     */
+    static T get(const uint8_t* record)
+    {
+        T value;
+        std::memcpy(&value, record + Offset, sizeof(T));
+        return value;
+    }
+
+    /**
+     * @brief Writes the field into a record buffer
+     * @param record Pointer to the first byte of the record
+     * @param value Value to store
+     */
+    static void put(uint8_t* record, T value)
+    {
+        std::memcpy(record + Offset, &value, sizeof(T));
+    }
+};
+
+#define ALTAIR_SCHEMA_FIELD(record, name, type, offset) \
+    using name = Field<type, offset>; \
+    static_assert(offset + sizeof(type) <= record##_SIZE, #record "." #name " lies outside the record");
+
+/**
+ * @brief Sensor sample record (see SENSOR_RECORD_SCHEMA)
+ */
+struct SensorRecord
+{
+    static constexpr size_t size = SENSOR_RECORD_SIZE;
+    SENSOR_RECORD_SCHEMA(ALTAIR_SCHEMA_FIELD)
+};
+
+/**
+ * @brief Event record (see EVENT_RECORD_SCHEMA)
+ */
+struct EventRecord
+{
+    static constexpr size_t size = EVENT_RECORD_SIZE;
+    EVENT_RECORD_SCHEMA(ALTAIR_SCHEMA_FIELD)
+};
+
+/**
+ * @brief Log request time range (see TIME_RANGE_SCHEMA)
+ */
+struct TimeRange
+{
+    static constexpr size_t size = TIME_RANGE_SIZE;
+    TIME_RANGE_SCHEMA(ALTAIR_SCHEMA_FIELD)
+};
+
+/**
+ * @brief Single timestamp (see TIME_VALUE_SCHEMA)
+ */
+struct TimeValue
+{
+    static constexpr size_t size = TIME_VALUE_SIZE;
+    TIME_VALUE_SCHEMA(ALTAIR_SCHEMA_FIELD)
+};
+
+#undef ALTAIR_SCHEMA_FIELD
+
+/**
+ * @brief Single value payload of a configuration update
+ * @tparam T Wire type of the value
+ */
+template<typename T>
+struct Value
+{
+    static constexpr size_t size = sizeof(T);
+    using value = Field<T, 0>;
+};
+
+} // namespace schema
+
+/**
+ * @class PacketCodec
+ * @brief Serializes and deserializes payload records at the schema's fixed offsets
+ *
+ * Every function copies a fixed set of fields to or from a caller provided
+ * buffer without branches or allocation. Buffers must hold at least the
+ * record size; callers check packet bounds before decoding.
+ */
+class PacketCodec
+{
+public:
+    /**
+     * @brief Encodes a sensor sample (SENSOR_RECORD_SIZE bytes)
+     */
+    static void encode(const SensorData& data, uint8_t* out)
+    {
+        using R = schema::SensorRecord;
+        R::temp::put(out, data.temp);
+        R::humid::put(out, data.humid);
+        R::light::put(out, data.light);
+        R::mode::put(out, static_cast<uint8_t>(data.mode));
+        R::voltage::put(out, data.voltage);
+        R::timestamp::put(out, data.timestamp);
+    }
+
+    /**
+     * @brief Decodes a sensor sample (SENSOR_RECORD_SIZE bytes)
+     */
+    static void decode(const uint8_t* in, SensorData& data)
+    {
+        using R = schema::SensorRecord;
+        data.temp = R::temp::get(in);
+        data.humid = R::humid::get(in);
+        data.light = R::light::get(in);
+        data.mode = static_cast<AltairModes>(R::mode::get(in));
+        data.voltage = R::voltage::get(in);
+        data.timestamp = R::timestamp::get(in);
+    }
+
+    /**
+     * @brief Encodes an event (EVENT_RECORD_SIZE bytes)
+     */
+    static void encode(const EventData& data, uint8_t* out)
+    {
+        using R = schema::EventRecord;
+        R::event::put(out, static_cast<uint8_t>(data.event));
+        R::timestamp::put(out, data.timestamp);
+    }
+
+    /**
+     * @brief Decodes an event (EVENT_RECORD_SIZE bytes)
+     */
+    static void decode(const uint8_t* in, EventData& data)
+    {
+        using R = schema::EventRecord;
+        data.event = static_cast<AltairEvent>(R::event::get(in));
+        data.timestamp = R::timestamp::get(in);
+    }
+
+    /**
+     * @brief Encodes a log request time range (TIME_RANGE_SIZE bytes)
+     */
+    static void encode_time_range(uint32_t start, uint32_t end, uint8_t* out)
+    {
+        using R = schema::TimeRange;
+        R::start::put(out, start);
+        R::end::put(out, end);
+    }
+
+    /**
+     * @brief Decodes a timestamp payload (TIME_VALUE_SIZE bytes)
+     */
+    static uint32_t decode_time_value(const uint8_t* in)
+    {
+        return schema::TimeValue::timestamp::get(in);
+    }
+
+    /**
+     * @brief Encodes a single configuration value (sizeof(T) bytes)
+     */
+    template<typename T>
+    static void encode_value(const T& value, uint8_t* out)
+    {
+        schema::Value<T>::value::put(out, value);
+    }
+};
+
+} // namespace altair
+
+#endif // PACKET_CODEC_HPP
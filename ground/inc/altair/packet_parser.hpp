@@ -4,6 +4,7 @@
 #include <vector>
 #include <cstdint>
 #include <string>
+#include "packet_view.hpp"
 
 namespace altair
 {
@@ -54,34 +55,56 @@ enum AltairEvent
     ERROR_TO_SAFE,        ///< Transition from error mode to safe mode
 };
 
+/**
+ * @brief Every packet type: name, type byte and the side that sends it
+ *
+ * SATELLITE types are received by the ground server, which must route each
+ * of them to a handler; AltairServer checks this at compile time against
+ * this list. GROUND types are only sent to the satellite.
+ */
+#define ALTAIR_RESPONSE_TYPES(TYPE) \
+    TYPE(BEACON,                0x01, SATELLITE)  /* Regular beacon signal */ \
+    TYPE(TIME_SEND,             0x02, GROUND)     /* Time update being sent to satellite */ \
+    TYPE(UPDATE_MIN_TEMP,       0x03, GROUND)     /* Update minimum temperature threshold */ \
+    TYPE(UPDATE_HUMIDITY,       0x04, GROUND)     /* Update humidity threshold */ \
+    TYPE(UPDATE_VOLTAGE,        0x05, GROUND)     /* Update voltage threshold */ \
+    TYPE(UPDATE_LIGHT,          0x06, GROUND)     /* Update light threshold */ \
+    TYPE(EVENT,                 0x07, SATELLITE)  /* Event notification */ \
+    TYPE(ACK,                   0x08, SATELLITE)  /* Acknowledgment of a command */ \
+    TYPE(NACK,                  0x09, SATELLITE)  /* Negative acknowledgment of a command */ \
+    TYPE(UPDATE_MAX_TEMP,       0x0A, GROUND)     /* Update maximum temperature threshold */ \
+    TYPE(TIME_REQUEST,          0x10, SATELLITE)  /* Request for time update from satellite */ \
+    TYPE(SENSOR_LOG,            0x11, SATELLITE)  /* Sensor log data */ \
+    TYPE(TOTAL_LOGS,            0x12, SATELLITE)  /* Total number of logs available */ \
+    TYPE(REQUEST_SENSOR_LOGS,   0x13, GROUND)     /* Request for sensor logs */ \
+    TYPE(EVENT_LOG,             0x14, SATELLITE)  /* Event log data */ \
+    TYPE(EVENT_LOG_END,         0x15, SATELLITE)  /* End of event log transmission */ \
+    TYPE(REQUEST_EVENT_LOG,     0x16, GROUND)     /* Request for event logs */ \
+    TYPE(REQUEST_CURRENT_TIME,  0x17, GROUND)     /* Request for current satellite time */ \
+    TYPE(RESPONSE_CURRENT_TIME, 0x18, SATELLITE)  /* Response with current satellite time */
+
 /**
  * @enum ResponseType
- * @brief Types of communication packets between server and satellite
+ * @brief Types of communication packets between server and satellite (see ALTAIR_RESPONSE_TYPES)
  */
 enum ResponseType
 {
-    BEACON = 0x01,                ///< Regular beacon signal
-    TIME_SEND = 0x02,             ///< Time update being sent to satellite
-    UPDATE_MIN_TEMP = 0x03,       ///< Update minimum temperature threshold
-    UPDATE_HUMIDITY = 0x04,       ///< Update humidity threshold
-    UPDATE_VOLTAGE = 0x05,        ///< Update voltage threshold
-    UPDATE_LIGHT = 0x06,          ///< Update light threshold
-    EVENT = 0x07,                 ///< Event notification
-    ACK = 0x08,                   ///< Acknowledgment of a command
-    NACK = 0x09,                  ///< Negative acknowledgment of a command
-    UPDATE_MAX_TEMP = 0x0A,       ///< Update maximum temperature threshold
-    TIME_REQUEST = 0x10,          ///< Request for time update from satellite
-    SENSOR_LOG = 0x11,            ///< Sensor log data
-    TOTAL_LOGS = 0x12,            ///< Total number of logs available
-    REQUEST_SENSOR_LOGS = 0x13,   ///< Request for sensor logs
-    EVENT_LOG = 0x14,             ///< Event log data
-    EVENT_LOG_END = 0x15,         ///< End of event log transmission
-    REQUEST_EVENT_LOG = 0x16,     ///< Request for event logs
-    REQUEST_CURRENT_TIME = 0x17,  ///< Request for current satellite time
-    RESPONSE_CURRENT_TIME = 0x18, ///< Response with current satellite time
+#define ALTAIR_RESPONSE_TYPE_ENUMERATOR(name, value, sender) name = value,
+    ALTAIR_RESPONSE_TYPES(ALTAIR_RESPONSE_TYPE_ENUMERATOR)
+#undef ALTAIR_RESPONSE_TYPE_ENUMERATOR
     UNKNOWN = 0xFF                ///< Default for unknown types
 };
 
+/**
+ * @enum PacketSender
+ * @brief Side of the link that sends a packet type
+ */
+enum class PacketSender : uint8_t
+{
+    SATELLITE,  ///< Received by the ground server
+    GROUND,     ///< Sent to the satellite
+};
+
 /**
  * @struct MessagePacket
  * @brief Structure for communication packets
@@ -133,24 +156,24 @@ public:
     
     /**
      * @brief Extract the response type from a raw packet
-     * @param response Vector containing the raw packet data
+     * @param response View of the raw packet data
      * @return The ResponseType value from the packet
      */
-    ResponseType parse_response_type(const std::vector<uint8_t>& response) const;
+    ResponseType parse_response_type(const PacketView& response) const;
     
     /**
      * @brief Parse sensor data from a raw packet
-     * @param response Vector containing the raw packet data
+     * @param response View of the raw packet data
      * @param data Reference to a SensorData object to populate with parsed data
      */
-    void parse_sensor_data(const std::vector<uint8_t>& response, SensorData& data) const;
+    void parse_sensor_data(const PacketView& response, SensorData& data) const;
     
     /**
      * @brief Parse event data from a raw packet
-     * @param response Vector containing the raw packet data
+     * @param response View of the raw packet data
      * @param event_data Reference to an EventData object to populate with parsed data
      */
-    void parse_event_data(const std::vector<uint8_t>& response, EventData& event_data) const;
+    void parse_event_data(const PacketView& response, EventData& event_data) const;
     
     //---------------------------------------------------------------------
     // String conversion methods
@@ -177,6 +200,15 @@ public:
      */
     std::string format_timestamp(time_t timestamp) const;
     
+    /**
+     * @brief Format a Unix timestamp into a caller provided buffer
+     * @param timestamp The Unix timestamp to format
+     * @param out Destination, TimestampFormatter::BUFFER_SIZE bytes always suffice
+     * @param size Size of the destination
+     * @return Number of characters written, excluding the terminating NUL
+     */
+    size_t format_timestamp(time_t timestamp, char* out, size_t size) const;
+    
     //---------------------------------------------------------------------
     // Message creation
     //---------------------------------------------------------------------
@@ -195,10 +227,10 @@ public:
     
     /**
      * @brief Check if a response packet is valid
-     * @param response Vector containing the raw packet data
+     * @param response View of the raw packet data
      * @return true if the packet is valid, false otherwise
      */
-    bool is_valid_response(const std::vector<uint8_t>& response) const;
+    bool is_valid_response(const PacketView& response) const;
     
     /**
      * @brief Print beacon data to standard output
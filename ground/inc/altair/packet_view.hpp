@@ -0,0 +1,132 @@
+#ifndef PACKET_VIEW_HPP
+#define PACKET_VIEW_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+namespace altair {
+
+/**
+ * @class PacketView
+ * @brief Non-owning view of one received packet
+ *
+ * A PacketView points into the buffer the packet was decoded from and is
+ * only valid while that buffer is. It exposes the header fields of the
+ * packet layout (length, type, id, checksum, payload, end mark) and reads
+ * little-endian payload values without copying the packet.
+ */
+class PacketView {
+public:
+    /**
+     * @brief Offset of the first payload byte (length + type + id + checksum)
+     */
+    static constexpr size_t PAYLOAD_OFFSET = 4;
+
+    /**
+     * @brief Constructs an empty view
+     */
+    constexpr PacketView() : m_data(nullptr), m_size(0) {}
+
+    /**
+     * @brief Constructs a view over a complete packet
+     * @param data Pointer to the length byte of the packet
+     * @param size Number of bytes in the packet, including the end mark
+     */
+    constexpr PacketView(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+    /**
+     * @brief Pointer to the first byte of the packet
+     */
+    constexpr const uint8_t* data() const { return m_data; }
+
+    /**
+     * @brief Number of bytes in the packet
+     */
+    constexpr size_t size() const { return m_size; }
+
+    /**
+     * @brief Raw byte access
+     * @param index Offset from the start of the packet
+     */
+    constexpr uint8_t operator[](size_t index) const { return m_data[index]; }
+
+    /**
+     * @brief Length field of the header
+     */
+    constexpr uint8_t length() const { return m_size > 0 ? m_data[0] : 0; }
+
+    /**
+     * @brief Packet type field of the header (see ResponseType)
+     */
+    constexpr uint8_t type() const { return m_size > 1 ? m_data[1] : 0xFF; }
+
+    /**
+     * @brief Request/response ID field of the header
+     */
+    constexpr uint8_t id() const { return m_size > 2 ? m_data[2] : 0; }
+
+    /**
+     * @brief Checksum field of the header
+     */
+    constexpr uint8_t checksum() const { return m_size > 3 ? m_data[3] : 0; }
+
+    /**
+     * @brief Pointer to the first payload byte
+     */
+    constexpr const uint8_t* payload() const { return m_data + PAYLOAD_OFFSET; }
+
+    /**
+     * @brief Number of payload bytes between the header and the end mark
+     */
+    constexpr size_t payload_size() const { return m_size > PAYLOAD_OFFSET ? m_size - PAYLOAD_OFFSET - 1 : 0; }
+
+    /**
+     * @brief Checks that a payload field lies inside the packet
+     * @param offset Offset of the field within the payload
+     * @param size Size of the field in bytes
+     */
+    constexpr bool has_payload(size_t offset, size_t size) const { return offset + size <= payload_size(); }
+
+    /**
+     * @brief Reads a little-endian value from the payload
+     * @tparam T Arithmetic type to read
+     * @param offset Offset of the value within the payload
+     * @param fallback Value returned if the field lies outside the packet
+     * @return The decoded value, or fallback
+     */
+    template<typename T>
+    T read_le(size_t offset, T fallback = T()) const
+    {
+        static_assert(std::is_arithmetic<T>::value, "read_le supports arithmetic types only");
+
+        if (!has_payload(offset, sizeof(T))) {
+            return fallback;
+        }
+
+        const uint8_t* src = payload() + offset;
+        if constexpr (std::is_integral<T>::value) {
+            std::make_unsigned_t<T> value = 0;
+            for (size_t i = 0; i < sizeof(T); ++i) {
+                value |= static_cast<std::make_unsigned_t<T>>(src[i]) << (8 * i);
+            }
+            return static_cast<T>(value);
+        } else {
+            static_assert(sizeof(T) == sizeof(uint32_t), "only 32-bit floating point is on the wire");
+            uint32_t bits = static_cast<uint32_t>(src[0]) | static_cast<uint32_t>(src[1]) << 8 |
+                            static_cast<uint32_t>(src[2]) << 16 | static_cast<uint32_t>(src[3]) << 24;
+            T value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+    }
+
+private:
+    const uint8_t* m_data;  ///< First byte of the packet (the length field)
+    size_t m_size;          ///< Packet size in bytes
+};
+
+} // namespace altair
+
+#endif // PACKET_VIEW_HPP
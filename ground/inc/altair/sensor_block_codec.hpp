@@ -0,0 +1,97 @@
+#ifndef SENSOR_BLOCK_CODEC_HPP
+#define SENSOR_BLOCK_CODEC_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "packet_parser.hpp"
+
+namespace altair {
+
+/**
+ * @class SensorBlockCodec
+ * @brief Compresses a sorted run of SensorData into a columnar block
+ *
+ * Each field is stored as its own column, encoded for what telemetry
+ * looks like: near regular timestamps and slowly changing readings.
+ *
+ *     header     [count u16][first timestamp u32][first delta u32]
+ *     timestamps delta-of-delta, zigzag, bit-packed frames
+ *     mode       runs of [mode u8][length u16], preceded by the run count u16
+ *     temp       per FRAME_SIZE records: [first u8][frame of zigzag deltas]
+ *     humid      same as temp
+ *     light      same as temp
+ *     voltage    per FRAME_SIZE records: [first bits u32][frame of XORs with the previous value]
+ *
+ * Sealed SensorSegment files store their records in such blocks too, so
+ * this layout is part of the segment file format.
+ *
+ * The timestamps are always decoded whole to locate a range; the other
+ * columns restart at every FRAME_SIZE records, so only the chunks holding
+ * the range are decoded.
+ *
+ * A frame holds up to FRAME_SIZE values packed with one bit width, after
+ * dropping the trailing zero bits all of them share. Frames that are
+ * mostly zero, as when a reading holds steady, store a bitmap and only the
+ * non-zero values; a frame of identical values takes two bytes.
+ * A full frame of values up to 32 bits wide is packed vertically, into four
+ * interleaved 32-bit lanes that all hold their values at the same bit
+ * offsets. It is unpacked by a kernel instantiated for its width, whose
+ * shifts and masks are constants applied to the four lanes at once; GCC
+ * turns it into SSE2 code at -O2, no wider instruction set needed. Wider
+ * values, the short frame at the end of a block and the non-zero values of
+ * sparse frames are packed one after another and unpacked by a scalar
+ * loop. Scattering a sparse frame and the prefix pass that restores each
+ * column from its differences stay scalar too.
+ */
+class SensorBlockCodec {
+public:
+    /**
+     * @brief Number of values sharing one bit width
+     */
+    static constexpr size_t FRAME_SIZE = 128;
+
+    /**
+     * @brief Largest number of records in one block
+     */
+    static constexpr size_t MAX_RECORDS = 0xFFFF;
+
+    /**
+     * @brief Encodes records into a block
+     * @param records Records sorted by timestamp, without duplicate timestamps
+     * @param count Number of records, at most MAX_RECORDS
+     * @param out Receives the block, replacing its content
+     */
+    static void encode(const SensorData* records, size_t count, std::vector<uint8_t>& out);
+
+    /**
+     * @brief Decodes the records of a block within a time range
+     * @param block Block produced by encode()
+     * @param start_time Start of the range
+     * @param end_time End of the range (inclusive)
+     * @param result Records in range are appended to it, in timestamp order
+     */
+    static void decode_range(const std::vector<uint8_t>& block, uint32_t start_time, uint32_t end_time,
+                             std::vector<SensorData>& result);
+
+    /**
+     * @brief Decodes the records of a block within a time range, reading it in place
+     * @param block First byte of a block produced by encode(), for example inside a mapped file
+     * @param start_time Start of the range
+     * @param end_time End of the range (inclusive)
+     * @param result Records in range are appended to it, in timestamp order
+     */
+    static void decode_range(const uint8_t* block, uint32_t start_time, uint32_t end_time,
+                             std::vector<SensorData>& result);
+
+    /**
+     * @brief Decodes every record of a block
+     * @param block Block produced by encode()
+     * @param result Records are appended to it, in timestamp order
+     */
+    static void decode(const std::vector<uint8_t>& block, std::vector<SensorData>& result);
+};
+
+} // namespace altair
+
+#endif // SENSOR_BLOCK_CODEC_HPP
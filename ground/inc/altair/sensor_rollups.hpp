@@ -0,0 +1,127 @@
+#ifndef SENSOR_ROLLUPS_HPP
+#define SENSOR_ROLLUPS_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include "packet_parser.hpp"
+
+namespace altair {
+
+/**
+ * @struct FieldStats
+ * @brief Minimum, maximum and sum of one field; the record count is kept by SensorStats
+ */
+template<typename T, typename Sum>
+struct FieldStats
+{
+    T min{};    ///< Smallest value, valid when the count is not 0
+    T max{};    ///< Largest value, valid when the count is not 0
+    Sum sum{};  ///< Sum of all values
+
+    void add(T value, bool first)
+    {
+        min = first || value < min ? value : min;
+        max = first || value > max ? value : max;
+        sum += value;
+    }
+
+    void merge(const FieldStats& other, bool first)
+    {
+        min = first || other.min < min ? other.min : min;
+        max = first || other.max > max ? other.max : max;
+        sum += other.sum;
+    }
+};
+
+/**
+ * @struct SensorStats
+ * @brief Aggregate of the sensor records of one period
+ */
+struct SensorStats
+{
+    /**
+     * @brief Slots of the mode histogram: index is the AltairModes value, 0 counts unknown modes
+     */
+    static constexpr size_t MODE_SLOTS = OK_MODE + 1;
+
+    uint32_t start_time = 0;                        ///< First second of the period
+    uint32_t end_time = 0;                          ///< Last second of the period
+    uint32_t count = 0;                             ///< Number of records
+    FieldStats<uint8_t, uint64_t> temp;
+    FieldStats<uint8_t, uint64_t> humid;
+    FieldStats<uint8_t, uint64_t> light;
+    FieldStats<float, double> voltage;
+    std::array<uint32_t, MODE_SLOTS> modes{};       ///< Records per mode
+
+    /**
+     * @brief Adds one record
+     */
+    void add(const SensorData& data);
+
+    /**
+     * @brief Adds the records of another aggregate
+     */
+    void merge(const SensorStats& other);
+};
+
+/**
+ * @class SensorRollups
+ * @brief Incremental per-minute, per-hour and per-day aggregates of the sensor history
+ *
+ * Every record added updates one bucket per level; buckets are aligned to
+ * multiples of their width since the epoch, so days are UTC days. A
+ * period is answered from the coarsest buckets lying completely inside
+ * it; only the pieces at its edges shorter than a minute are aggregated
+ * from the records themselves, so the cost follows the number of buckets,
+ * not the number of records.
+ */
+class SensorRollups {
+public:
+    /**
+     * @brief Bucket width of every level in seconds, coarsest first
+     */
+    static constexpr std::array<uint32_t, 3> LEVEL_WIDTHS = { 86400, 3600, 60 };
+
+    /**
+     * @brief Aggregates the records of a period directly, for the edges no bucket covers
+     */
+    using RecordSource = std::function<void(uint32_t start_time, uint32_t end_time, SensorStats& stats)>;
+
+    /**
+     * @brief Adds a record to its bucket on every level
+     */
+    void add(const SensorData& data);
+
+    /**
+     * @brief Drops every bucket
+     */
+    void clear();
+
+    /**
+     * @brief Aggregates the records of a period
+     * @param start_time First second of the period
+     * @param end_time Last second of the period
+     * @param records Called for the parts of the period shorter than the finest bucket
+     * @param stats Receives the aggregate; its start and end time are left to the caller
+     */
+    void aggregate(uint32_t start_time, uint32_t end_time, const RecordSource& records, SensorStats& stats) const;
+
+private:
+    /**
+     * @brief Aggregates [start, end) from the levels from a given one down, and records below them
+     */
+    void aggregate_level(size_t level, uint64_t start, uint64_t end, const RecordSource& records,
+                         SensorStats& stats) const;
+
+    // Ordered map, so a late record opening a bucket in the past costs a lookup, not a shift of the newer buckets
+    using Buckets = std::map<uint32_t, SensorStats>;
+
+    std::array<Buckets, LEVEL_WIDTHS.size()> m_levels; // Buckets of every level by start time
+};
+
+} // namespace altair
+
+#endif // SENSOR_ROLLUPS_HPP
@@ -0,0 +1,125 @@
+#ifndef SENSOR_SEGMENT_HPP
+#define SENSOR_SEGMENT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "packet_parser.hpp"
+
+namespace altair {
+
+/**
+ * @class SensorSegment
+ * @brief Sealed, read-only file of sensor records, read through mmap
+ *
+ * File layout, all integers little-endian:
+ *
+ *     header  [magic "ALTSEG01"][version u32][block records u32][record count u64][min u32][max u32]
+ *     blocks  SensorBlockCodec blocks of BLOCK_RECORDS records each (fewer in the last), sorted by timestamp
+ *     index   [first timestamp u32][last timestamp u32][offset u64] of every block
+ *     footer  [index offset u64][index count u32][magic "SIDX"]
+ *
+ * A lookup searches the small footer index for the one block that may
+ * hold the timestamp and decodes just that block, straight from the mapped
+ * pages; nothing is read into memory up front, so opening a segment costs
+ * one open, fstat and mmap.
+ *
+ * Version 1 files, sealed before the records were compressed, hold plain
+ * SENSOR_RECORD_SIZE byte records instead of blocks and an index of the
+ * timestamp of every INDEX_STRIDE-th record. They are still read; only
+ * version 2 files are written.
+ */
+class SensorSegment {
+public:
+    /**
+     * @brief Number of records in one compressed block
+     */
+    static constexpr size_t BLOCK_RECORDS = 1024;
+
+    /**
+     * @brief Number of records between two entries of the footer index of a version 1 file
+     */
+    static constexpr size_t INDEX_STRIDE = 256;
+
+    /**
+     * @brief Writes a sealed segment file
+     * @param path Destination; the file is written next to it, renamed into place and its directory synced
+     * @param records Records sorted by timestamp, without duplicate timestamps
+     * @return False if the file cannot be written or made durable
+     */
+    static bool write(const std::string& path, const std::vector<SensorData>& records);
+
+    /**
+     * @brief Maps a sealed segment file
+     * @param path Path of the file
+     * @return The segment, or nullptr if the file is missing, truncated or not a segment
+     */
+    static std::unique_ptr<SensorSegment> open(const std::string& path);
+
+    /**
+     * @brief Unmaps the file
+     */
+    ~SensorSegment();
+
+    SensorSegment(const SensorSegment&) = delete;
+    SensorSegment& operator=(const SensorSegment&) = delete;
+
+    /**
+     * @brief Looks up the record with a timestamp
+     * @param timestamp Timestamp to look for
+     * @param data Receives the record
+     * @return False if the segment has no record with that timestamp
+     */
+    bool find(uint32_t timestamp, SensorData& data) const;
+
+    /**
+     * @brief Appends the records within a time range to a vector, in timestamp order
+     */
+    void append_range(uint32_t start_time, uint32_t end_time, std::vector<SensorData>& result) const;
+
+    uint32_t min_timestamp() const { return m_min_timestamp; }
+    uint32_t max_timestamp() const { return m_max_timestamp; }
+    size_t size() const { return m_count; }
+    const std::string& path() const { return m_path; }
+
+private:
+    SensorSegment(std::string path, const uint8_t* map, size_t map_size);
+
+    /**
+     * @brief Checks the header, index and footer of a mapped file and locates its parts
+     */
+    bool validate();
+
+    /**
+     * @brief Returns the first block whose last record is not older than a timestamp
+     */
+    size_t block_for(uint32_t timestamp) const;
+
+    uint32_t block_first(size_t block) const;
+    uint32_t block_last(size_t block) const;
+    uint64_t block_offset(size_t block) const;
+
+    /**
+     * @brief Returns the index of the first record of a version 1 file not older than a timestamp
+     */
+    size_t lower_bound(uint32_t timestamp) const;
+
+    uint32_t timestamp_at(size_t index) const;
+
+    std::string m_path;
+    const uint8_t* m_map;           ///< Whole file, read-only
+    size_t m_map_size;
+    uint32_t m_version;
+    const uint8_t* m_records;       ///< First record inside the mapping, version 1 only
+    size_t m_count;
+    const uint8_t* m_index;         ///< First footer index entry inside the mapping
+    size_t m_index_count;
+    uint32_t m_min_timestamp;
+    uint32_t m_max_timestamp;
+};
+
+} // namespace altair
+
+#endif // SENSOR_SEGMENT_HPP
@@ -101,7 +101,12 @@ public:
      * @param size Maximum number of bytes to receive
      * @return Number of bytes received, or negative value on error
      */
-    ssize_t receive(std::vector<uint8_t>& message, uint8_t size) override;
+    ssize_t receive(std::vector<uint8_t>& message, size_t size) override;
+
+    /**
+     * @brief Line capacity at 115200 baud with 8N1 framing
+     */
+    size_t bytes_per_second() const override;
     
     /**
      * @brief Checks if the serial connection is valid
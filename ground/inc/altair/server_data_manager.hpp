@@ -1,7 +1,14 @@
 #ifndef SERVER_DATA_MANAGER_HPP
 #define SERVER_DATA_MANAGER_HPP
 
+#include "beacon_file.hpp"
+#include "coverage_map.hpp"
 #include "packet_parser.hpp"
+#include "sensor_rollups.hpp"
+#include "sensor_segment.hpp"
+#include "write_ahead_log.hpp"
+#include <memory>
+#include <string>
 #include <vector>
 #include <mutex>
 #include <optional>
@@ -12,23 +19,124 @@ namespace altair {
  * @class ServerDataManager
  * @brief Manages a collection of SensorData objects sorted by timestamp
  * 
- * This class provides efficient storage and retrieval of SensorData objects
- * with binary search insertion to maintain sorted order by timestamp.
+ * Records are kept in fixed-size blocks, each covering a time range that
+ * does not overlap the others. Records arriving in timestamp order are
+ * appended to the last block in constant time. A record older than the newest
+ * one goes to the small, unsorted late buffer of the block covering its
+ * timestamp; the buffer is merged into the block once full, and a block
+ * grown past its capacity is split in two. Queries use the per-block
+ * timestamp bounds to skip blocks outside the requested range.
+ *
+ * Only the last block is kept as plain records. Once closed, a block is
+ * compressed into a columnar SensorBlockCodec block, a few bits per
+ * field instead of a padded 16-byte struct; range queries decode it
+ * straight into the result, and it is only expanded again when its late
+ * buffer is merged.
+ *
+ * Given a directory, the history also survives restarts and crashes:
+ * every record is appended to a WriteAheadLog with group commit, and once
+ * SEGMENT_CAPACITY records are held in memory they are sealed into a
+ * sorted SensorSegment file of SensorBlockCodec blocks, dropped from memory
+ * and the log starts over. Sealed segments are mapped at startup and
+ * queried by decoding the blocks straight from the mapped pages; only the
+ * log is replayed. The latest beacon is kept in a
+ * BeaconFile of its own, overwritten in place.
+ *
+ * Every stored record also updates SensorRollups, per-minute, per-hour and
+ * per-day aggregates answering statistics queries without touching the
+ * records. They are not persisted: the segments found at startup are only
+ * added on the first statistics query, so startup does not decode the
+ * sealed history.
+ *
+ * A CoverageMap records the intervals known to be held completely, so
+ * log queries inside them need not go to the satellite. Coverage is logged
+ * like the records and re-logged whenever the log starts over.
  */
 class ServerDataManager {
 public:
     /**
-     * @brief Default constructor
+     * @brief Number of records after which a block is closed (in order) or split (late records)
+     */
+    static constexpr size_t BLOCK_CAPACITY = 4096;
+
+    /**
+     * @brief Number of late records a block buffers before merging them
+     */
+    static constexpr size_t LATE_BUFFER_CAPACITY = 64;
+
+    /**
+     * @brief Number of records kept in memory before they are sealed into a segment file
+     */
+    static constexpr size_t SEGMENT_CAPACITY = 65536;
+
+    /**
+     * @brief Default constructor, the history is kept in memory only
      */
     ServerDataManager();
 
     /**
-     * @brief Insert SensorData into the collection using binary search
-     * @param data The SensorData to insert
+     * @brief Constructs a manager persisting its history in a directory
+     * @param directory Directory of the segment files, created if missing; empty keeps the history in memory only
+     * @param log_options When records appended to the log are synced to disk
+     *
+     * Existing sealed segments are mapped and the log is replayed.
+     * If the directory cannot be used the history is kept in memory only.
+     */
+    explicit ServerDataManager(const std::string& directory,
+                               const WriteAheadLogOptions& log_options = WriteAheadLogOptions());
+
+    /**
+     * @brief Insert SensorData into the collection
+     * @param data The SensorData to insert; a record with the same timestamp is kept as is
      * @return True if insertion was successful, false otherwise
      */
     bool insertSensorData(const SensorData& data);
 
+    /**
+     * @brief Remember the latest beacon, persisted in the beacon file so it survives a restart
+     * @param data The beacon's sensor readings
+     */
+    void setLatestBeacon(const SensorData& data);
+
+    /**
+     * @brief Get the latest beacon
+     * @return Optional SensorData - empty if no beacon was received or recovered
+     */
+    std::optional<SensorData> getLatestBeacon() const;
+
+    /**
+     * @brief Record that every satellite record of an interval is stored
+     * @param start_time First second of the interval
+     * @param end_time Last second of the interval (inclusive)
+     */
+    void markCovered(uint32_t start_time, uint32_t end_time);
+
+    /**
+     * @brief Get the parts of a time range not known to be stored completely
+     * @param start_time Start of the time range
+     * @param end_time End of the time range (inclusive)
+     * @return Uncovered intervals in time order, empty when the range is covered
+     */
+    std::vector<CoverageMap::Interval> getMissingIntervals(uint32_t start_time, uint32_t end_time) const;
+
+    /**
+     * @brief Find the stretches of a time range where stored records are missing
+     * @param start_time Start of the time range
+     * @param end_time End of the time range (inclusive)
+     * @param sample_interval Seconds between two records the satellite logs, doubled in safe mode
+     * @param max_gaps Largest number of gaps returned
+     * @return The first gaps in time order, each between two records or an edge of an uncovered interval
+     *
+     * Only intervals not known to be complete are searched. A gap is a
+     * stretch longer than the sample interval, plus a second for the
+     * rounding of timestamps, after which the next record should have
+     * been logged. The stretches searched without finding a gap are marked
+     * covered, so repeated searches only look at the gaps; the range must
+     * therefore end where the satellite's log is settled.
+     */
+    std::vector<CoverageMap::Interval> findGaps(uint32_t start_time, uint32_t end_time, uint32_t sample_interval,
+                                                size_t max_gaps);
+
     /**
      * @brief Get SensorData by timestamp
      * @param timestamp The timestamp to look for
@@ -44,6 +152,17 @@ public:
      */
     std::optional<std::vector<SensorData>> getSensorDataInRange(uint32_t start_time, uint32_t end_time) const;
 
+    /**
+     * @brief Get aggregates of the SensorData in a time range
+     * @param start_time Start of the time range
+     * @param end_time End of the time range (inclusive)
+     * @param resolution Width of one aggregate in seconds, aggregates are aligned to multiples of it
+     * @return One aggregate per period, clipped to the range, empty periods included;
+     *         empty if the range is reversed or the resolution is 0
+     */
+    std::optional<std::vector<SensorStats>> getSensorStats(uint32_t start_time, uint32_t end_time,
+                                                           uint32_t resolution) const;
+
     /**
      * @brief Get the most recent SensorData
      * @return Optional SensorData - has value if collection is not empty
@@ -63,12 +182,112 @@ public:
     size_t size() const;
 
     /**
-     * @brief Clear all stored data
+     * @brief Clear all stored data and coverage, including the segment files
      */
     void clear();
 
 private:
-    std::vector<SensorData> m_sensor_data; // Collection of sensor data sorted by timestamp
+    /**
+     * @struct Block
+     * @brief Records of one time range
+     */
+    struct Block
+    {
+        uint32_t min_timestamp = 0;         ///< Oldest timestamp in records and late
+        uint32_t max_timestamp = 0;         ///< Newest timestamp in records and late
+        std::vector<SensorData> records;    ///< Sorted by timestamp, empty while the block is packed
+        std::vector<uint8_t> packed;        ///< Records compressed by SensorBlockCodec, empty for the last block
+        std::vector<SensorData> late;       ///< Late arrivals not merged yet, unsorted
+    };
+
+    /**
+     * @brief Adds a record to the in-memory blocks
+     * @return False if a record with the same timestamp is already stored
+     */
+    bool insertLocked(const SensorData& data);
+
+    /**
+     * @brief Appends the records within a time range, from the segments and the blocks, in timestamp order
+     */
+    void collectRangeLocked(uint32_t start_time, uint32_t end_time, std::vector<SensorData>& result) const;
+
+    /**
+     * @brief Writes the in-memory records to a new sealed segment and empties the blocks
+     */
+    void sealLocked();
+
+    /**
+     * @brief Adds the records of the segments found at startup to the rollups, once
+     */
+    void loadRollupsLocked() const;
+
+    /**
+     * @brief Appends a record to the log, giving up on persistence if that fails
+     * @return False if the record was not logged
+     */
+    bool logRecord(uint8_t type, const SensorData& data);
+
+    /**
+     * @brief Appends a covered interval to the log, giving up on persistence if that fails
+     */
+    void logCoverage(uint32_t start_time, uint32_t end_time);
+
+    /**
+     * @brief Newest timestamp stored in memory or in a segment
+     */
+    std::optional<uint32_t> newestTimestamp() const;
+
+    /**
+     * @brief Returns the index of the block a timestamp belongs to
+     *
+     * That is the last block starting at or before the timestamp, or the
+     * first block for timestamps older than every block.
+     */
+    size_t findBlock(uint32_t timestamp) const;
+
+    /**
+     * @brief Looks a timestamp up in one block
+     * @param found Receives the record, if not null
+     * @return False if the block has no record with that timestamp
+     */
+    static bool findInBlock(const Block& block, uint32_t timestamp, SensorData* found = nullptr);
+
+    /**
+     * @brief Sorts the late buffer of a block into its records, splitting the block if it grew too large
+     *
+     * Resulting blocks other than the last one are packed again.
+     */
+    void mergeLateRecords(size_t index);
+
+    /**
+     * @brief Compresses a closed block, merging its late buffer first
+     */
+    void closeBlock(size_t index);
+
+    /**
+     * @brief Replaces the records of a block with their compressed form
+     */
+    static void packBlock(Block& block);
+
+    /**
+     * @brief Appends the records of a block within a time range to a vector, in timestamp order
+     */
+    static void appendRange(const Block& block, uint32_t start_time, uint32_t end_time,
+                            std::vector<SensorData>& result);
+
+    std::vector<std::unique_ptr<Block>> m_blocks; // Blocks in timestamp order, their ranges do not overlap
+    size_t m_size; // Number of records in all blocks
+    std::string m_directory; // Segment directory, empty when the history is in memory only
+    std::vector<std::unique_ptr<SensorSegment>> m_segments; // Sealed segments in sealing order
+    std::unique_ptr<WriteAheadLog> m_log; // Records not sealed yet and coverage, null when not persisting
+    std::unique_ptr<BeaconFile> m_beacon_file; // Latest beacon, null when not persisting
+    std::optional<SensorData> m_latest_beacon; // Latest beacon, recovered from the beacon file at startup
+    CoverageMap m_coverage; // Intervals whose satellite records are all stored, recovered from the log at startup
+    mutable SensorRollups m_rollups; // Aggregates of every record, in memory and sealed
+    mutable size_t m_unrolled_segments; // Leading segments whose records are not in m_rollups yet
+    size_t m_sealed_size; // Number of records in all sealed segments
+    uint32_t m_sealed_max; // Newest timestamp in the sealed segments, valid when m_sealed_size is not 0
+    uint64_t m_next_segment; // Sequence number of the next sealed segment
     mutable std::mutex m_mutex; // Mutex for thread safety
 };
 
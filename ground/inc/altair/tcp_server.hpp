@@ -3,11 +3,13 @@
 
 #include <string>
 #include <memory>
+#include <array>
 #include <unordered_map>
 #include <functional>
 #include <atomic>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #include <vector>
 #include <boost/asio.hpp>
 
@@ -16,9 +18,19 @@ namespace altair {
 // Forward declarations
 class ClientSession;
 
+/**
+ * @typedef SharedBuffer
+ * @brief Immutable message queued by reference in every session it is sent to
+ */
+using SharedBuffer = std::shared_ptr<const std::string>;
+
 /**
  * @class TcpServer
  * @brief Main server class responsible for accepting client connections
+ *
+ * The io_context is run by a configurable pool of threads. Each client session
+ * serializes its own handlers on a strand, so different clients are served in
+ * parallel while a single client's reads and writes never overlap.
  */
 class TcpServer {
 public:
@@ -26,8 +38,9 @@ public:
      * @brief Constructor for TcpServer
      * @param port The port number to listen on
      * @param maxConnections Maximum number of concurrent connections allowed
+     * @param ioThreadCount Number of threads running the io_context (at least 1)
      */
-    explicit TcpServer(unsigned short port = 4444, size_t maxConnections = 100);
+    explicit TcpServer(unsigned short port = 4444, size_t maxConnections = 100, size_t ioThreadCount = 1);
     
     /**
      * @brief Destructor, ensures clean shutdown
@@ -47,21 +60,68 @@ public:
     
     /**
      * @brief Registers a callback for handling received messages
-     * @param handler Function to be called when a message is received
+     * @param handler Function to be called for every command line a client sends
+     *
+     * Client input is framed by newlines. The handler gets one call per
+     * complete line, without the line terminator, in the order received.
      */
     void setMessageHandler(std::function<void(const std::string&, std::shared_ptr<ClientSession>)> handler);
     
+    /**
+     * @brief Registers a callback for frames of clients in binary mode
+     * @param handler Function called with the kind, tag and body of every frame
+     *                (the length field stripped), see binary_protocol.hpp
+     */
+    void setFrameHandler(std::function<void(const uint8_t*, size_t, std::shared_ptr<ClientSession>)> handler);
+    
+    /**
+     * @brief Registers a callback for clients whose session closes
+     * @param handler Function called once per session, on the thread that stopped it
+     *
+     * Lets work done on behalf of the client be cancelled. Nothing sent to
+     * the session from now on reaches the client.
+     */
+    void setCloseHandler(std::function<void(std::shared_ptr<ClientSession>)> handler);
+    
     /**
      * @brief Broadcasts a message to all connected clients
      * @param message The message to broadcast
+     *
+     * The message is copied once into a SharedBuffer, see the overload below.
      */
     void broadcastMessage(const std::string& message);
     
+    /**
+     * @brief Broadcasts an already serialized message to all connected clients
+     * @param message The shared message; every session queues the same bytes
+     *
+     * The client registry is only locked long enough to snapshot the sessions,
+     * no I/O is issued while a shard lock is held.
+     */
+    void broadcastMessage(SharedBuffer message);
+    
     /**
      * @brief Gets the current number of connected clients
      * @return The number of active connections
      */
     size_t getClientCount() const;
+
+    /**
+     * @brief Gets the io_context that drives the server
+     * @return Reference to the io_context, shared with other asynchronous components
+     */
+    boost::asio::io_context& getIoContext();
+
+    /**
+     * @brief Gets the number of threads running the io_context
+     * @return Size of the io thread pool
+     */
+    size_t getIoThreadCount() const;
+
+    /**
+     * @brief Blocks until every io thread has finished running the io_context
+     */
+    void wait();
     
 private:
     // ASIO service and acceptor
@@ -73,16 +133,36 @@ private:
     size_t maxConnections_;
     std::atomic<bool> running_;
     
-    // Client management
-    std::unordered_map<size_t, std::shared_ptr<ClientSession>> clients_;
-    mutable std::mutex clientsMutex_;
-    size_t nextClientId_;
+    // Client management, sharded by client ID so sessions on different io threads rarely contend
+    enum { CLIENT_SHARD_COUNT = 16 };
+    struct ClientShard {
+        std::unordered_map<size_t, std::shared_ptr<ClientSession>> clients;
+        mutable std::mutex mutex;
+    };
+    std::array<ClientShard, CLIENT_SHARD_COUNT> clientShards_;
+    std::atomic<size_t> clientCount_;
+    std::atomic<size_t> nextClientId_;
     
     // Message handling
     std::function<void(const std::string&, std::shared_ptr<ClientSession>)> messageHandler_;
+    std::function<void(const uint8_t*, size_t, std::shared_ptr<ClientSession>)> frameHandler_;
+    std::function<void(std::shared_ptr<ClientSession>)> closeHandler_;
     
-    // Worker thread for running the io_context
-    std::unique_ptr<std::thread> ioThread_;
+    // Worker threads for running the io_context
+    size_t ioThreadCount_;
+    std::vector<std::thread> ioThreads_;
+
+    // Signalled when the last io thread leaves io_context::run
+    std::mutex ioStateMutex_;
+    std::condition_variable ioStoppedCv_;
+    size_t runningIoThreads_;
+    
+    /**
+     * @brief Gets the registry shard holding a client
+     * @param clientId The client ID
+     * @return The shard for that ID
+     */
+    ClientShard& shardFor(size_t clientId);
     
     /**
      * @brief Starts accepting new connections
@@ -123,7 +203,7 @@ class ClientSession : public std::enable_shared_from_this<ClientSession> {
 public:
     /**
      * @brief Constructor for ClientSession
-     * @param io_context ASIO io_context to use for this session
+     * @param io_context ASIO io_context to use for this session; the socket runs on its own strand of it
      * @param server Pointer to the parent server
      */
     ClientSession(boost::asio::io_context& io_context, TcpServer* server);
@@ -153,8 +233,73 @@ public:
     /**
      * @brief Sends a message to the client
      * @param message The message to send
+     * @param tag Request tag of the REPLY_TEXT frames in binary mode, 0 for unsolicited text
+     *
+     * Safe to call from any thread. The message is queued on the session's
+     * strand and goes out with the next flush of the outbound queue.
      */
-    void sendMessage(const std::string& message);
+    void sendMessage(std::string message, uint8_t tag = 0);
+    
+    /**
+     * @brief Sends a shared message to the client without copying it
+     * @param message The message to send; it must not be modified afterwards
+     *
+     * Safe to call from any thread, like sendMessage.
+     */
+    void sendMessage(SharedBuffer message);
+    
+    /**
+     * @brief Sends one binary frame to the client
+     * @param kind Frame kind (binary::FrameKind)
+     * @param tag Request tag
+     * @param body Body bytes
+     * @param size Body size, at most binary::MAX_BODY_SIZE
+     *
+     * Safe to call from any thread. Only meaningful in binary mode.
+     */
+    void sendFrame(uint8_t kind, uint8_t tag, const void* body, size_t size);
+    
+    /**
+     * @brief Sends shared bytes as they are, whatever the session's framing
+     * @param data Complete text or pre-built frames matching isBinary()
+     */
+    void sendRaw(SharedBuffer data);
+    
+    /**
+     * @brief Calls a handler once the outbound queue has drained
+     * @param maxQueued Most bytes still queued when the handler runs
+     * @param handler Function to call, on the session's strand
+     *
+     * Safe to call from any thread. Lets a long reply be sent in pages
+     * without filling the queue past MAX_QUEUED_BYTES. The handler is
+     * dropped without being called if the session closes first.
+     */
+    void whenDrained(size_t maxQueued, std::function<void()> handler);
+    
+    /**
+     * @brief Keeps the session open for a reply still to come
+     * @return Token holding the session open while it lives
+     *
+     * Safe to call from any thread. A client that shuts down its sending
+     * side still gets the replies to its commands: the session closes once
+     * the input ended, the outbound queue drained and no token is alive.
+     * Drop the token only after queueing the reply it stands for.
+     */
+    std::shared_ptr<void> holdOpen();
+    
+    /**
+     * @brief Switches the session to the binary protocol
+     *
+     * Must be called from the message handler. Input after the current line
+     * is parsed as length-prefixed frames, and text sent from now on is
+     * wrapped in REPLY_TEXT frames.
+     */
+    void setBinaryFraming();
+    
+    /**
+     * @brief Checks whether the session uses the binary protocol
+     */
+    bool isBinary() const;
     
     /**
      * @brief Gets the client's ID
@@ -169,7 +314,7 @@ public:
     std::string getRemoteAddress() const;
     
 private:
-    // ASIO socket
+    // ASIO socket, bound to a per-session strand
     boost::asio::ip::tcp::socket socket_;
     
     // Parent server
@@ -183,8 +328,40 @@ private:
     enum { MAX_BUFFER_SIZE = 8192 };
     char dataBuffer_[MAX_BUFFER_SIZE];
     
+    // Command framing: bytes of an unfinished line or frame carried between
+    // reads, and the line handed to the message handler (reused to avoid allocations)
+    enum { MAX_LINE_LENGTH = 4096 };
+    std::string partialInput_;
+    std::string command_;
+    bool discardingLine_;
+    
     // State management
     std::atomic<bool> active_;
+    std::atomic<bool> binary_;
+    
+    // Set once the client half-closed; the session then stays open until its replies went out
+    std::atomic<bool> inputClosed_;
+    std::atomic<size_t> holds_;
+    
+    // Outbound queue, only touched on the session's strand. Small messages are
+    // appended to the last pending chunk; a flush moves every pending chunk to
+    // the active list and sends them with one gathered write.
+    enum { WRITE_CHUNK_SIZE = 16384 };
+    enum { MAX_QUEUED_BYTES = 4 * 1024 * 1024 };
+    struct OutboundChunk {
+        std::string owned;      // Bytes of direct messages, appended to in place
+        SharedBuffer shared;    // Broadcast bytes, referenced instead of copied
+        
+        const std::string& data() const { return shared ? *shared : owned; }
+    };
+    std::vector<OutboundChunk> pendingWrites_;
+    std::vector<OutboundChunk> activeWrites_;
+    std::vector<boost::asio::const_buffer> writeBuffers_;
+    size_t queuedBytes_;
+    bool writeInProgress_;
+    
+    // whenDrained handlers waiting for the queue to shrink to their byte count, only touched on the strand
+    std::vector<std::pair<size_t, std::function<void()>>> drainHandlers_;
     
     /**
      * @brief Starts asynchronous read operation
@@ -198,6 +375,73 @@ private:
      */
     void handleRead(const boost::system::error_code& error, size_t bytesTransferred);
     
+    /**
+     * @brief Closes a half-closed session once nothing is left to send, on the strand
+     */
+    void closeIfIdle();
+    
+    /**
+     * @brief Splits received bytes into lines (or frames) and dispatches every complete one
+     * @param data Received bytes
+     * @param size Number of received bytes
+     */
+    void consumeInput(const char* data, size_t size);
+    
+    /**
+     * @brief Tells the client its line exceeds MAX_LINE_LENGTH and drops what was kept of it
+     */
+    void rejectLongLine();
+    
+    /**
+     * @brief Dispatches every complete binary frame in received bytes
+     * @param data First received byte not consumed yet
+     * @param end One past the last received byte
+     */
+    void consumeFrames(const char* data, const char* end);
+    
+    /**
+     * @brief Passes one binary frame to the server's frame handler
+     * @param frame Frame bytes, starting with the length field
+     * @param size Size of the frame
+     */
+    void dispatchFrame(const char* frame, size_t size);
+    
+    /**
+     * @brief Passes one command line to the server's message handler
+     * @param line Line content, the newline excluded
+     * @param size Length of the line
+     */
+    void dispatchLine(const char* line, size_t size);
+    
+    /**
+     * @brief Appends a message to the outbound queue, must run on the strand
+     * @param message The message to queue
+     */
+    void queueWrite(std::string&& message);
+    
+    /**
+     * @brief Appends a shared message to the outbound queue, must run on the strand
+     * @param message The message to queue by reference
+     */
+    void queueWrite(SharedBuffer&& message);
+    
+    /**
+     * @brief Accounts for newly queued bytes, disconnecting the client if the queue is full
+     * @param size Number of bytes about to be queued
+     * @return True if the bytes may be queued
+     */
+    bool reserveQueue(size_t size);
+    
+    /**
+     * @brief Calls the drain handlers whose byte count the queue is down to, must run on the strand
+     */
+    void runDrainHandlers();
+    
+    /**
+     * @brief Sends everything queued with a single gathered write
+     */
+    void startWrite();
+    
     /**
      * @brief Callback for when data is written to the socket
      * @param error Any error that occurred during writing
@@ -0,0 +1,213 @@
+#ifndef TELEMETRY_SUBSCRIPTIONS_HPP
+#define TELEMETRY_SUBSCRIPTIONS_HPP
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "packet_parser.hpp"
+#include "tcp_server.hpp"
+
+namespace altair {
+
+/**
+ * @class TelemetrySubscriptions
+ * @brief Pushes live beacons and events to the clients whose filter matches them
+ *
+ * Every subscription is a packet type set, an optional "mode changed" flag and
+ * up to MAX_THRESHOLDS threshold predicates on the beacon's sensor fields.
+ * Predicates are interned in a shared table of at most MAX_PREDICATES entries,
+ * and a subscription only stores the bitmask of the predicates it requires.
+ * Publishing a beacon evaluates each predicate in the table once, then a
+ * subscription matches with a single mask comparison. The message is
+ * formatted once per frame and protocol (text or binary), only if at least
+ * one client of that protocol matches, and is queued by reference in every
+ * matching session.
+ */
+class TelemetrySubscriptions {
+public:
+    /**
+     * @brief Packet type bits of a filter
+     */
+    enum PacketTypeMask : uint8_t {
+        BEACON_TELEMETRY = 1 << 0,
+        EVENT_TELEMETRY  = 1 << 1,
+        ALL_TELEMETRY    = BEACON_TELEMETRY | EVENT_TELEMETRY
+    };
+
+    /**
+     * @brief Beacon field a threshold predicate applies to
+     */
+    enum class SensorField : uint8_t { TEMP, HUMID, LIGHT, VOLTAGE };
+
+    /**
+     * @brief Comparison of a threshold predicate (field <op> value)
+     */
+    enum class Comparison : uint8_t { LESS, LESS_EQUAL, GREATER, GREATER_EQUAL };
+
+    /**
+     * @struct Threshold
+     * @brief One threshold predicate, e.g. temp>30
+     */
+    struct Threshold
+    {
+        SensorField field;
+        Comparison op;
+        float value;
+
+        bool operator==(const Threshold& other) const
+        {
+            return field == other.field && op == other.op && value == other.value;
+        }
+    };
+
+    /**
+     * @struct Filter
+     * @brief Telemetry a client wants pushed to it
+     *
+     * Thresholds and the mode change flag only restrict beacons; events are
+     * selected by the packet type set alone.
+     */
+    struct Filter
+    {
+        uint8_t packet_types = 0;           ///< PacketTypeMask bits, 0 means all
+        bool mode_change = false;           ///< Only beacons whose mode differs from the previous beacon
+        std::vector<Threshold> thresholds;  ///< All must hold for a beacon to match
+    };
+
+    /**
+     * @brief Size of the shared predicate table
+     */
+    static constexpr size_t MAX_PREDICATES = 64;
+
+    /**
+     * @brief Maximum number of thresholds in one filter
+     */
+    static constexpr size_t MAX_THRESHOLDS = 8;
+
+    TelemetrySubscriptions();
+
+    TelemetrySubscriptions(const TelemetrySubscriptions&) = delete;
+    TelemetrySubscriptions& operator=(const TelemetrySubscriptions&) = delete;
+
+    /**
+     * @brief Adds one term of the subscribe command to a filter
+     * @param term "beacon", "event", "mode_change" or "<field><op><value>",
+     *             where field is temp, humid, light or voltage and op is <, <=, > or >=
+     * @param filter Filter to extend
+     * @return False if the term is not understood or the filter has too many thresholds
+     */
+    static bool parse_term(std::string_view term, Filter& filter);
+
+    /**
+     * @brief Registers or replaces the subscription of a client
+     * @param client The subscribing client
+     * @param filter What the client wants to receive
+     * @return False if the shared predicate table has no room for the filter's thresholds
+     */
+    bool subscribe(const std::shared_ptr<ClientSession>& client, const Filter& filter);
+
+    /**
+     * @brief Removes the subscription of a client
+     * @param client_id ID of the client
+     * @return True if the client was subscribed
+     */
+    bool unsubscribe(size_t client_id);
+
+    /**
+     * @brief Pushes a beacon to every matching subscriber
+     * @param data The decoded beacon
+     * @param parser Formats the message, once, if anyone matches
+     * @return Number of clients the beacon was sent to
+     */
+    size_t publish_beacon(const SensorData& data, const PacketParser& parser);
+
+    /**
+     * @brief Pushes an event to every matching subscriber
+     * @param data The decoded event
+     * @param parser Formats the message, once, if anyone matches
+     * @return Number of clients the event was sent to
+     */
+    size_t publish_event(const EventData& data, const PacketParser& parser);
+
+    /**
+     * @brief Number of subscribed clients
+     */
+    size_t subscriber_count() const;
+
+private:
+    /**
+     * @struct Predicate
+     * @brief Interned threshold, shared by every subscription that uses it
+     */
+    struct Predicate
+    {
+        Threshold threshold;
+        size_t refs = 0;        ///< Subscriptions using this entry, 0 when free
+    };
+
+    /**
+     * @struct Subscription
+     * @brief Compiled filter of one client
+     */
+    struct Subscription
+    {
+        std::weak_ptr<ClientSession> client;
+        uint8_t packet_types;
+        bool mode_change;
+        uint64_t predicates;    ///< Bits of m_predicates that must all hold
+    };
+
+    /**
+     * @brief Collects the live sessions of matching subscriptions, must hold m_mutex
+     * @param packet_type PacketTypeMask bit of the frame
+     * @param predicate_mask Predicates that hold for the frame
+     * @param mode_changed Whether the frame changed the satellite mode
+     * @param targets Receives the matching sessions
+     */
+    void collect_targets(uint8_t packet_type, uint64_t predicate_mask, bool mode_changed,
+                         std::vector<std::shared_ptr<ClientSession>>& targets);
+
+    /**
+     * @brief Interns the thresholds of a filter, must hold m_mutex
+     * @param thresholds Thresholds to intern
+     * @param mask Receives the bits of their predicate table entries
+     * @return False, with nothing interned, if the table is full
+     */
+    bool intern(const std::vector<Threshold>& thresholds, uint64_t& mask);
+
+    /**
+     * @brief Drops one reference to each predicate in a mask, must hold m_mutex
+     */
+    void release(uint64_t mask);
+
+    /**
+     * @brief Evaluates one predicate against a beacon
+     */
+    static bool evaluate(const Threshold& threshold, const SensorData& data);
+
+    /**
+     * @brief Sends one shared message to every target and clears the list
+     * @param targets Matching sessions
+     * @param format_text Builds the message for text clients, called at most once
+     * @param format_frame Builds the frame for binary clients, called at most once
+     * @return Number of targets
+     */
+    template<typename TextFormat, typename FrameFormat>
+    static size_t deliver(std::vector<std::shared_ptr<ClientSession>>& targets,
+                          TextFormat&& format_text, FrameFormat&& format_frame);
+
+    mutable std::mutex m_mutex;                                     ///< Guards all members below
+    std::array<Predicate, MAX_PREDICATES> m_predicates;             ///< Shared predicate table
+    uint64_t m_active_predicates;                                   ///< Bits of entries in use
+    std::unordered_map<size_t, Subscription> m_subscriptions;       ///< Subscriptions by client ID
+    int m_last_mode;                                                ///< Mode of the previous beacon, -1 before the first
+};
+
+} // namespace altair
+
+#endif // TELEMETRY_SUBSCRIPTIONS_HPP
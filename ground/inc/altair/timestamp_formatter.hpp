@@ -0,0 +1,62 @@
+#ifndef TIMESTAMP_FORMATTER_HPP
+#define TIMESTAMP_FORMATTER_HPP
+
+#include <cstddef>
+#include <ctime>
+
+namespace altair {
+
+/**
+ * @class TimestampFormatter
+ * @brief Formats Unix timestamps as local time ("%Y-%m-%d %H:%M:%S %Z") without
+ *        calling localtime/strftime for every timestamp
+ *
+ * Each thread caches one span of time during which the local UTC offset and
+ * date do not change: normally a whole local day, and on days with a DST
+ * transition the 15 minute window around the timestamp (every real time zone
+ * changes offset on a 15 minute boundary). Timestamps inside the cached span
+ * only need the time of day formatted; anything else refreshes the cache with
+ * one localtime_r call. The cache is per thread, so formatting never takes a
+ * lock. A change of the TZ environment variable at run time is not noticed.
+ */
+class TimestampFormatter {
+public:
+    /**
+     * @brief Buffer size that always fits a formatted timestamp and its terminator
+     */
+    static constexpr size_t BUFFER_SIZE = 48;
+
+    /**
+     * @brief Formats a timestamp into a caller provided buffer
+     * @param timestamp Unix timestamp
+     * @param out Destination buffer
+     * @param size Size of the destination, at least BUFFER_SIZE to never truncate
+     * @return Number of characters written, excluding the terminating NUL
+     */
+    static size_t format(time_t timestamp, char* out, size_t size);
+
+private:
+    /**
+     * @struct Span
+     * @brief Cached interval of constant local date and UTC offset
+     */
+    struct Span
+    {
+        time_t start = 0;           ///< First timestamp of the span
+        time_t end = 0;             ///< One past the last timestamp, start == end when empty
+        long start_second = 0;      ///< Local second of the day at start
+        char date[16] = {};         ///< "YYYY-MM-DD "
+        size_t date_length = 0;
+        char zone[16] = {};         ///< " " followed by the zone abbreviation
+        size_t zone_length = 0;
+    };
+
+    /**
+     * @brief Recomputes the cached span around a timestamp
+     */
+    static void refresh(Span& span, time_t timestamp);
+};
+
+} // namespace altair
+
+#endif // TIMESTAMP_FORMATTER_HPP
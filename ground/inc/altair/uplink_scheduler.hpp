@@ -0,0 +1,137 @@
+#ifndef UPLINK_SCHEDULER_HPP
+#define UPLINK_SCHEDULER_HPP
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace altair {
+
+/**
+ * @class UplinkScheduler
+ * @brief Single writer of the packets sent to the satellite, by priority and paced to the line rate
+ *
+ * Packets wait in one queue per priority class; the writer thread always
+ * sends the oldest packet of the most urgent class. A token bucket filled
+ * at the line rate paces the packets: each one is charged its cost, which
+ * for a request includes the reply it asks for, so requests are not sent
+ * faster than the link can answer them. The queue then builds up on the
+ * ground, where a more urgent packet can still overtake it, instead of in
+ * the satellite's receive queue. A packet may overdraw the bucket; the
+ * next one waits until the debt is paid, so an urgent packet waits at most
+ * for the cost of the packet sent before it.
+ */
+class UplinkScheduler {
+public:
+    /**
+     * @enum Priority
+     * @brief Priority classes, most urgent first
+     */
+    enum Priority : uint8_t
+    {
+        CONTROL = 0,        ///< Time sync and configuration updates
+        INTERACTIVE = 1,    ///< Requests a client waits for
+        BACKGROUND = 2,     ///< Requests nobody waits for, such as backfill
+    };
+
+    /**
+     * @brief Number of priority classes
+     */
+    static constexpr size_t PRIORITY_COUNT = 3;
+
+    /**
+     * @brief Default bucket size in bytes, the most sent back to back after an idle period
+     */
+    static constexpr size_t DEFAULT_BURST_BYTES = 256;
+
+    /**
+     * @brief Writes one packet to the line, called on the writer thread only, with the ticket it was submitted with
+     */
+    using Writer = std::function<void(const std::vector<uint8_t>& packet, uint32_t ticket)>;
+
+    /**
+     * @brief Selects queued packets to drop, by packet and ticket
+     */
+    using Matcher = std::function<bool(const std::vector<uint8_t>& packet, uint32_t ticket)>;
+
+    /**
+     * @brief Starts the writer thread
+     * @param writer Function writing a packet to the line
+     * @param bytes_per_second Line rate filling the bucket, 0 to send without pacing
+     * @param burst_bytes Bucket size
+     */
+    UplinkScheduler(Writer writer, size_t bytes_per_second, size_t burst_bytes = DEFAULT_BURST_BYTES);
+
+    /**
+     * @brief Stops the writer thread, dropping the packets not sent yet
+     */
+    ~UplinkScheduler();
+
+    UplinkScheduler(const UplinkScheduler&) = delete;
+    UplinkScheduler& operator=(const UplinkScheduler&) = delete;
+
+    /**
+     * @brief Queues a packet
+     * @param priority Priority class of the packet
+     * @param packet The complete packet
+     * @param cost Bytes charged to the bucket, at least the packet size
+     * @param ticket Value handed to the writer with the packet, such as the state of the request it was sent for
+     */
+    void submit(Priority priority, std::vector<uint8_t> packet, size_t cost = 0, uint32_t ticket = 0);
+
+    /**
+     * @brief Drops packets that are still queued
+     * @param match Called with every queued packet, true drops it
+     * @return Number of packets dropped
+     *
+     * A packet the writer thread already took is not seen. Dropped packets
+     * are never charged to the bucket.
+     */
+    size_t cancel(const Matcher& match);
+
+    /**
+     * @brief Number of packets waiting in a priority class and all more urgent ones
+     */
+    size_t queued(Priority priority = BACKGROUND) const;
+
+private:
+    /**
+     * @struct Entry
+     * @brief A queued packet, its cost and ticket
+     */
+    struct Entry
+    {
+        std::vector<uint8_t> packet;
+        size_t cost;
+        uint32_t ticket;
+    };
+
+    /**
+     * @brief Body of the writer thread
+     */
+    void run();
+
+    const Writer m_writer;
+    const double m_rate;                                    ///< Bytes per second, 0 when not paced
+    const double m_burst;                                   ///< Bucket size in bytes
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wakeup;                       ///< Wakes the writer thread
+    std::array<std::deque<Entry>, PRIORITY_COUNT> m_queues; ///< Waiting packets per priority class
+    double m_tokens;                                        ///< Bytes that may be sent now, negative while in debt
+    std::chrono::steady_clock::time_point m_refilled;       ///< Time the bucket was last filled
+    bool m_stop;
+
+    std::thread m_thread;
+};
+
+} // namespace altair
+
+#endif // UPLINK_SCHEDULER_HPP
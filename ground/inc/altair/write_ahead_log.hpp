@@ -0,0 +1,133 @@
+#ifndef WRITE_AHEAD_LOG_HPP
+#define WRITE_AHEAD_LOG_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace altair {
+
+/**
+ * @struct WriteAheadLogOptions
+ * @brief When the log makes appended records durable
+ */
+struct WriteAheadLogOptions
+{
+    std::chrono::milliseconds sync_interval{10};    ///< Longest time an appended record waits for fdatasync
+    size_t sync_bytes = 64 * 1024;                  ///< Appended bytes that trigger fdatasync before the interval ends
+    size_t preallocate_bytes = 4 * 1024 * 1024;     ///< Size by which the file is grown ahead of the records
+};
+
+/**
+ * @class WriteAheadLog
+ * @brief Append-only, checksummed record log with group commit
+ *
+ * File layout:
+ *
+ *     header  [magic "ALTWAL01"][version u32][reserved u32]
+ *     record  [crc32 u32][type u8][reserved u8][length u16][payload]
+ *
+ * The file is grown with posix_fallocate ahead of the records, so an
+ * append is a pwrite into allocated space and fdatasync never has to
+ * update the file size. Appends only copy the record into the page cache;
+ * a commit thread calls fdatasync once per sync_interval, or earlier once
+ * sync_bytes have been appended, so one sync covers every record appended
+ * meanwhile. Once a sync has failed, the records appended before it may
+ * be lost, so every later append fails and the caller learns the log
+ * is no longer durable. Replay stops at the
+ * first record whose checksum does not match: the preallocated zeros or a
+ * record torn by a crash.
+ */
+class WriteAheadLog {
+public:
+    /**
+     * @brief Largest payload of one record
+     */
+    static constexpr size_t MAX_PAYLOAD_SIZE = 0xFFFF;
+
+    /**
+     * @brief Called for every intact record during replay
+     */
+    using ReplayHandler = std::function<void(uint8_t type, const uint8_t* payload, size_t size)>;
+
+    /**
+     * @brief Opens or creates a log and replays its records
+     * @param path Path of the log file
+     * @param options Group commit and preallocation settings
+     * @param replay Called with every intact record, in append order
+     * @return The log, or nullptr if the file cannot be opened
+     */
+    static std::unique_ptr<WriteAheadLog> open(const std::string& path, const WriteAheadLogOptions& options,
+                                               const ReplayHandler& replay);
+
+    /**
+     * @brief Syncs the remaining records and closes the file
+     */
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    /**
+     * @brief Appends a record; it becomes durable with the next group commit
+     * @param type Record type chosen by the caller, not 0
+     * @param payload Record payload
+     * @param size Payload size, at most MAX_PAYLOAD_SIZE
+     * @return Sequence number of the record, 0 if the write failed or an earlier sync failed
+     */
+    uint64_t append(uint8_t type, const void* payload, size_t size);
+
+    /**
+     * @brief CRC-32 (IEEE) of a buffer, as used to check the records
+     */
+    static uint32_t checksum(const void* data, size_t size);
+
+    /**
+     * @brief Drops every record, once their content is stored elsewhere
+     * @return False if the file cannot be reset
+     */
+    bool reset();
+
+private:
+    WriteAheadLog(int fd, const WriteAheadLogOptions& options);
+
+    /**
+     * @brief Grows the allocated part of the file to hold at least the given size
+     */
+    bool reserve(uint64_t size);
+
+    /**
+     * @brief Writes a new header and allocates the first stretch of the file
+     */
+    bool start_over();
+
+    /**
+     * @brief Body of the commit thread
+     */
+    void run_commits();
+
+    const int m_fd;
+    const WriteAheadLogOptions m_options;
+
+    std::mutex m_mutex;
+    std::condition_variable m_commit_wakeup;    ///< Wakes the commit thread
+    uint64_t m_end;                             ///< Offset after the last record, guarded by m_mutex
+    uint64_t m_allocated;                       ///< Allocated file size, guarded by m_mutex
+    uint64_t m_appended;                        ///< Sequence number of the last appended record
+    uint64_t m_durable;                         ///< Sequence number of the last record on disk
+    size_t m_unsynced_bytes;                    ///< Bytes appended since the last sync
+    bool m_sync_failed;                         ///< A sync failed, records may have been lost
+    bool m_stop;
+
+    std::thread m_commit_thread;
+};
+
+} // namespace altair
+
+#endif // WRITE_AHEAD_LOG_HPP
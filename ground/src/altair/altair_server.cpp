@@ -1,208 +1,318 @@
 #include "altair_server.hpp"
+#include "packet_codec.hpp"
+#include "command_tokenizer.hpp"
+#include "binary_protocol.hpp"
+#include "logger.hpp"
+#include <algorithm>
 #include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <limits>
 #include <string>
-#include <iostream>
 #include <sstream>
+#include <stdexcept>
+#include <thread>
 
 namespace altair {
 
-AltairServer::AltairServer(std::unique_ptr<Connection> connection):
+namespace {
+
+// Telemetry is logged as binary records and only turned into text on the logger's writer thread
+void format_beacon_record(std::string& out, const void* payload)
+{
+    SensorData data;
+    std::memcpy(&data, payload, sizeof(data));
+    out += "Beacon data:\n";
+    out += PacketParser().sensor_data_to_string(data);
+}
+
+void format_event_record(std::string& out, const void* payload)
+{
+    EventData data;
+    std::memcpy(&data, payload, sizeof(data));
+    out += PacketParser().event_data_to_string(data);
+}
+
+} // namespace
+
+AltairServer::AltairServer(std::unique_ptr<Connection> connection, size_t io_threads,
+                           const std::string& history_directory, size_t fetch_window, uint32_t sample_interval):
 m_connection(std::move(connection)),
 m_latest_data(),
-m_id_generator(IDGenerator::getInstance()),
-m_tcp_server(4444, 10),
-m_sensor_data_manager()
+m_tcp_server(4444, 10, io_threads),
+m_in_flight(m_tcp_server.getIoContext()),
+m_fetch_window(std::max<size_t>(fetch_window, 1)),
+m_sample_interval(sample_interval),
+m_backfill_timer(m_tcp_server.getIoContext()),
+m_backfill_running(false),
+m_backfill_active(false),
+m_backfill_failed(),
+m_sensor_data_manager(history_directory),
+m_subscriptions(),
+m_frame_decoder(
+    [this](const uint8_t* frame, size_t len) {
+        this->handle_response(PacketView(frame, len));
+    },
+    [](const char* line, size_t len) {
+        if (len > 1) {
+            Logger::getInstance().log(LogLevel::INFO, "Satellite Debug: ", std::string_view(line, len));
+        }
+    }),
+m_async_receive(false),
+m_unknown_responses(0),
+m_uplink([this](const std::vector<uint8_t>& packet, uint32_t generation) { this->write_to_altair(packet, generation); },
+         m_connection->bytes_per_second())
 {
+    // Serve the last beacon recovered from the history directory until a new one arrives
+    if (auto beacon = m_sensor_data_manager.getLatestBeacon()) {
+        m_latest_data = *beacon;
+    }
+
+    m_in_flight.set_timeout_handler([this](uint8_t, uint8_t tag, std::shared_ptr<altair::ClientSession> client,
+                                           std::shared_ptr<RequestContext> context) {
+        if (auto fetch = std::dynamic_pointer_cast<LogFetch>(context)) {
+            complete_log_fetch(fetch, false);
+        } else if (auto event_fetch = std::dynamic_pointer_cast<EventFetch>(context)) {
+            complete_event_fetch(event_fetch, "Request timed out waiting for the satellite. Please try again.\n");
+        } else if (client) {
+            reply_error(client, tag, "Request timed out waiting for the satellite. Please try again.\n");
+        }
+    });
+    m_in_flight.start();
 
-    init_response_handlers();
-    
     m_tcp_server.setMessageHandler([this](const std::string& message, std::shared_ptr<altair::ClientSession> client) {
         this->handle_request(message, client);
     });
+    m_tcp_server.setFrameHandler([this](const uint8_t* frame, size_t size, std::shared_ptr<altair::ClientSession> client) {
+        this->handle_binary_request(frame, size, client);
+    });
+    m_tcp_server.setCloseHandler([this](std::shared_ptr<altair::ClientSession> client) {
+        this->cancel_log_queries(client);
+    });
+
+    // Serial input shares the TCP server's event loop when the connection supports it
+    m_async_receive = m_connection->start_async_receive(m_tcp_server.getIoContext(),
+        [this](const uint8_t* data, size_t len) {
+            m_frame_decoder.feed(data, len);
+        });
     
     m_tcp_server.start();
+
+    if (m_sample_interval != 0) {
+        m_backfill_running = true;
+        schedule_backfill();
+    }
 }
 
-void AltairServer::handle_response(std::vector<uint8_t>& response)
+AltairServer::~AltairServer()
 {
-    if(response.size() < PACKET_HEADER_SIZE) {
-        std::cout << "Invalid response size!" << std::endl;
-        return;
+    // The connection and the in-flight table hold handlers on the TCP server's io_context, release them first
+    m_in_flight.stop();
+    m_backfill_running = false;
+    m_backfill_timer.cancel();
+    m_tcp_server.stop();
+    m_connection->stop_async_receive();
+}
+
+constexpr AltairServer::ResponseDispatchTable AltairServer::make_response_dispatch_table()
+{
+    // Inbound protocol: every packet type the satellite sends and the handler that consumes it
+    constexpr ResponseRoute routes[] = {
+        { BEACON,                &AltairServer::handle_beacon },
+        { EVENT,                 &AltairServer::handle_event },
+        { ACK,                   &AltairServer::handle_ack },
+        { NACK,                  &AltairServer::handle_nack },
+        { TIME_REQUEST,          &AltairServer::handle_time_request },
+        { SENSOR_LOG,            &AltairServer::handle_sensor_log },
+        { TOTAL_LOGS,            &AltairServer::handle_sensor_log_end },
+        { EVENT_LOG,             &AltairServer::handle_event_log },
+        { EVENT_LOG_END,         &AltairServer::handle_event_log_end },
+        { RESPONSE_CURRENT_TIME, &AltairServer::handle_response_current_time },
+    };
+
+    ResponseDispatchTable table{};
+    for (auto& entry : table) {
+        entry = &AltairServer::handle_unknown;
     }
 
-    if(response.size() == 9) {
-        std::vector<uint8_t> new_response;
-        new_response.push_back(10);
-        for(size_t i = 0; i < response.size(); ++i) {
-            new_response.push_back(response[i]);
+    for (const auto& route : routes) {
+        if (table[route.type] != &AltairServer::handle_unknown) {
+            // Evaluated at compile time, so a duplicate route fails the build
+            throw std::logic_error("duplicate response route");
         }
-        response = new_response;
+        table[route.type] = route.handler;
     }
-    
-    ResponseType responseType = static_cast<ResponseType>(response[1]);
-    uint8_t responseId = response[2]; 
-    
-    
-    
-    auto handler_it = m_response_handlers.find(responseType);
-    if (handler_it != m_response_handlers.end()) {
-  
-        handler_it->second(response, responseId);
-    } else {
-        std::cout << "Unknown response type: " << static_cast<int>(responseType) << std::endl;
+
+    // Every packet type the satellite sends needs a route, so a new type cannot go unhandled unnoticed
+    constexpr struct { ResponseType type; PacketSender sender; } types[] = {
+#define ALTAIR_RESPONSE_TYPE_SENDER(name, value, sender) { name, PacketSender::sender },
+        ALTAIR_RESPONSE_TYPES(ALTAIR_RESPONSE_TYPE_SENDER)
+#undef ALTAIR_RESPONSE_TYPE_SENDER
+    };
+    for (const auto& type : types) {
+        bool routed = table[type.type] != &AltairServer::handle_unknown;
+        if (routed != (type.sender == PacketSender::SATELLITE)) {
+            throw std::logic_error("packet type sent by the satellite without a response route, or routed but never received");
+        }
     }
+    return table;
 }
 
-void AltairServer::init_response_handlers() 
+void AltairServer::handle_response(const PacketView& response)
 {
-    // Map each response type to its handler function
-    m_response_handlers[TIME_REQUEST] = [this](std::vector<uint8_t>& response, uint8_t responseId) {
-        this->handle_time_request(response, responseId);
-    };
-    
-    m_response_handlers[SENSOR_LOG] = [this](std::vector<uint8_t>& response, uint8_t responseId) {
-        this->handle_sensor_log(response, responseId);
-    };
-    
-    m_response_handlers[TOTAL_LOGS] = [this](std::vector<uint8_t>& response, uint8_t responseId) {
-        this->handle_sensor_log_end(response, responseId);
-    };
-    
-    m_response_handlers[ACK] = [this](std::vector<uint8_t>& response, uint8_t responseId) {
-        this->handle_ack(response, responseId);
-    };
-    
-    m_response_handlers[NACK] = [this](std::vector<uint8_t>& response, uint8_t responseId) {
-        this->handle_nack(response, responseId);
-    };
-    
-    m_response_handlers[EVENT] = [this](std::vector<uint8_t>& response, uint8_t responseId) {
-        this->handle_event(response, responseId);
-    };
-    
-    m_response_handlers[EVENT_LOG] = [this](std::vector<uint8_t>& response, uint8_t responseId) {
-        this->handle_event_log(response, responseId);
-    };
-    
-    m_response_handlers[EVENT_LOG_END] = [this](std::vector<uint8_t>& response, uint8_t responseId) {
-        this->handle_event_log_end(response, responseId);
-    };
-    
-    m_response_handlers[RESPONSE_CURRENT_TIME] = [this](std::vector<uint8_t>& response, uint8_t responseId) {
-        this->handle_response_current_time(response, responseId);
-    };
-    
-    m_response_handlers[BEACON] = [this](std::vector<uint8_t>& response, uint8_t responseId) {
-        this->handle_beacon(response, responseId);
-    };
+    static constexpr ResponseDispatchTable dispatch = make_response_dispatch_table();
+
+    if(response.size() < PACKET_HEADER_SIZE) {
+        static LogRateLimiter limiter(5, std::chrono::seconds(1));
+        Logger::getInstance().log(LogLevel::WARN, limiter, "Invalid response size!");
+        return;
+    }
+
+    (this->*dispatch[response.type()])(response, response.id());
 }
 
-void AltairServer::handle_time_request(std::vector<uint8_t>&, uint8_t) 
+void AltairServer::handle_unknown(const PacketView& response, uint8_t)
+{
+    m_unknown_responses.fetch_add(1, std::memory_order_relaxed);
+    static LogRateLimiter limiter(5, std::chrono::seconds(1));
+    Logger::getInstance().log(LogLevel::WARN, limiter, "Unknown response type: ", response.type());
+}
+
+size_t AltairServer::unknown_response_count() const
+{
+    return m_unknown_responses.load(std::memory_order_relaxed);
+}
+
+void AltairServer::handle_time_request(const PacketView&, uint8_t) 
 {
     send_current_time();
 }
 
-void AltairServer::handle_sensor_log(std::vector<uint8_t>& response, uint8_t responseId) 
+void AltairServer::handle_sensor_log(const PacketView& response, uint8_t responseId) 
 {
     //std::cout << "Log id = " << m_total_logs << std::endl;
-    SensorData sensor_data;
+    SensorData sensor_data{};
     m_packet_parser.parse_sensor_data(response, sensor_data);
     m_sensor_data_manager.insertSensorData(sensor_data);
     
-    // Check if this log is in response to a client request
-    auto it = m_request_clients.find(responseId);
-    if (it != m_request_clients.end()) {
-        // Format sensor data as string and send to client
-        std::string data_str = m_packet_parser.sensor_data_to_string(sensor_data);
-        it->second->sendMessage("\nSensor log data:\n" + data_str);
+    // The client is answered from the store once every fetch of its query ended
+    std::shared_ptr<RequestContext> context;
+    m_in_flight.find(responseId, nullptr, &context);
+    if (auto fetch = std::dynamic_pointer_cast<LogFetch>(context)) {
+        std::lock_guard<std::mutex> lock(m_log_mutex);
+        ++fetch->received;
+        fetch->last_timestamp = std::max(fetch->last_timestamp, sensor_data.timestamp);
     }
 }
 
-void AltairServer::handle_sensor_log_end(std::vector<uint8_t>&, uint8_t responseId) 
+void AltairServer::handle_sensor_log_end(const PacketView&, uint8_t responseId) 
 {    
-    // Check if this is for a tracked request
-    auto it = m_request_clients.find(responseId);
-    if (it != m_request_clients.end()) {
-
-        it->second->sendMessage("Completed retrieval of sensor logs.\n");
-        
-        
-        // Remove the request from tracking since it's complete
-        m_request_clients.erase(it);
+    // The request is complete, stop tracking it
+    std::shared_ptr<RequestContext> context;
+    m_in_flight.release(responseId, nullptr, &context);
+    if (auto fetch = std::dynamic_pointer_cast<LogFetch>(context)) {
+        complete_log_fetch(fetch, true);
     }
 }
 
-void AltairServer::handle_ack(std::vector<uint8_t>&, uint8_t responseId) 
+void AltairServer::handle_ack(const PacketView&, uint8_t responseId) 
 {
-    auto it = m_request_clients.find(responseId);
-    if (it != m_request_clients.end()) {
-        it->second->sendMessage("Sucess operation");
-        m_request_clients.erase(it);
+    // The context is kept until the reply is queued, it holds the client's session open
+    std::shared_ptr<RequestContext> context;
+    uint8_t tag = 0;
+    auto client = m_in_flight.release(responseId, &tag, &context);
+    if (client) {
+        client->sendMessage("Sucess operation", tag);
     }
-    
 }
 
-void AltairServer::handle_nack(std::vector<uint8_t>&, uint8_t responseId) 
+void AltairServer::handle_nack(const PacketView&, uint8_t responseId) 
 {
-
-    auto it = m_request_clients.find(responseId);
-    if (it != m_request_clients.end()) {
-        it->second->sendMessage("Request failed. Please try again.");
-        m_request_clients.erase(it);
+    std::shared_ptr<RequestContext> context;
+    uint8_t tag = 0;
+    auto client = m_in_flight.release(responseId, &tag, &context);
+    if (auto fetch = std::dynamic_pointer_cast<LogFetch>(context)) {
+        complete_log_fetch(fetch, false);
+    } else if (auto event_fetch = std::dynamic_pointer_cast<EventFetch>(context)) {
+        complete_event_fetch(event_fetch, "Request failed. Please try again.");
+    } else if (client) {
+        client->sendMessage("Request failed. Please try again.", tag);
     }
 }
 
-void AltairServer::handle_event(std::vector<uint8_t>& response, uint8_t) 
+void AltairServer::handle_event(const PacketView& response, uint8_t) 
 {
-    std::cout << "Event" << std::endl;
-    EventData event_data;
+    EventData event_data{};
     m_packet_parser.parse_event_data(response, event_data);
-    m_packet_parser.print_event(event_data);
+    Logger::getInstance().log_record(LogLevel::INFO, format_event_record, event_data);
+    m_subscriptions.publish_event(event_data, m_packet_parser);
 }
 
-void AltairServer::handle_event_log(std::vector<uint8_t>& response, uint8_t responseId) 
+void AltairServer::handle_event_log(const PacketView& response, uint8_t responseId) 
 {
-    EventData event_data;
+    EventData event_data{};
     m_packet_parser.parse_event_data(response, event_data);
-    m_packet_parser.print_event(event_data); 
-
-
-    auto it = m_request_clients.find(responseId);
-    if (it != m_request_clients.end()) {
-        std::string data_str = m_packet_parser.event_data_to_string(event_data);
-        it->second->sendMessage("\nEvent log data:\n" + data_str);
+    Logger::getInstance().log_record(LogLevel::DEBUG, format_event_record, event_data);
+
+    // Every query sharing the fetch gets the records inside its own range
+    std::shared_ptr<RequestContext> context;
+    m_in_flight.find(responseId, nullptr, &context);
+    if (auto fetch = std::dynamic_pointer_cast<EventFetch>(context)) {
+        std::lock_guard<std::mutex> lock(m_log_mutex);
+        fetch->records.push_back(event_data);
+        for (const EventWaiter& waiter : fetch->waiters) {
+            if (waiter.start == fetch->start && waiter.end == fetch->end) {
+                send_event_record(waiter, event_data);
+            }
+        }
     }
 }
 
-void AltairServer::handle_event_log_end(std::vector<uint8_t>&, uint8_t responseId) 
+void AltairServer::handle_event_log_end(const PacketView&, uint8_t responseId) 
 {
-    auto it = m_request_clients.find(responseId);
-    if (it != m_request_clients.end()) {
-        it->second->sendMessage("\nCompleted retrieval of events logs.\n");
-        m_request_clients.erase(it);
+    std::shared_ptr<RequestContext> context;
+    m_in_flight.release(responseId, nullptr, &context);
+    if (auto fetch = std::dynamic_pointer_cast<EventFetch>(context)) {
+        complete_event_fetch(fetch, nullptr);
     }
 }
 
-void AltairServer::handle_response_current_time(std::vector<uint8_t>& response, uint8_t responseId) 
+void AltairServer::handle_response_current_time(const PacketView& response, uint8_t responseId) 
 {
-    auto it = m_request_clients.find(responseId);
-    if (it != m_request_clients.end()) {
-        uint32_t current_time = 0;
-        uint8_t* uint32_buffer = (uint8_t*)&current_time;
-        for (int i = 0; i < 4; ++i) {
-            *uint32_buffer++ = response[i + 4];
+    std::shared_ptr<RequestContext> context;
+    uint8_t tag = 0;
+    auto client = m_in_flight.release(responseId, &tag, &context);
+    if (client && client->isBinary()) {
+        if (response.has_payload(0, TIME_VALUE_SIZE)) {
+            client->sendFrame(binary::REPLY_TIME, tag, response.payload(), TIME_VALUE_SIZE);
+        } else {
+            reply_error(client, tag, "Malformed time reply from the satellite");
         }
+    } else if (client && response.has_payload(0, TIME_VALUE_SIZE)) {
+        uint32_t current_time = PacketCodec::decode_time_value(response.payload());
         std::string local_time = m_packet_parser.format_timestamp(current_time);
 
-        it->second->sendMessage("Current time: " + local_time + "\n");
-        m_request_clients.erase(it);
+        client->sendMessage("Current time: " + local_time + "\n");
     }
 }
 
-void AltairServer::handle_beacon(std::vector<uint8_t>& response, uint8_t) 
+void AltairServer::handle_beacon(const PacketView& response, uint8_t) 
 {
-    m_packet_parser.parse_sensor_data(response, m_latest_data);
-    m_packet_parser.print_beacon_data(m_latest_data);
+    SensorData data = latest_data();
+    m_packet_parser.parse_sensor_data(response, data);
+    {
+        std::lock_guard<std::mutex> lock(m_latest_data_mutex);
+        m_latest_data = data;
+    }
+    m_sensor_data_manager.setLatestBeacon(data);
+    Logger::getInstance().log_record(LogLevel::INFO, format_beacon_record, data);
+    m_subscriptions.publish_beacon(data, m_packet_parser);
+}
+
+SensorData AltairServer::latest_data() const
+{
+    std::lock_guard<std::mutex> lock(m_latest_data_mutex);
+    return m_latest_data;
 }
 
 
@@ -210,305 +320,997 @@ void AltairServer::handle_beacon(std::vector<uint8_t>& response, uint8_t)
 
 void AltairServer::listen()
 {
-    std::vector<uint8_t> response = std::vector<uint8_t>(0);
-    std::vector<uint8_t> char_buffer = std::vector<uint8_t>(0);
+    if (m_async_receive) {
+        // Serial input is delivered on the io thread, nothing to poll here
+        m_tcp_server.wait();
+        return;
+    }
+
+    std::vector<uint8_t> chunk;
+    chunk.reserve(READ_CHUNK_SIZE);
+    std::chrono::milliseconds retry_delay{0};
  
     while (true) {
 
-        ssize_t bytes_received = m_connection->receive(char_buffer, 1);
+        ssize_t bytes_received = m_connection->receive(chunk, READ_CHUNK_SIZE);
 
         if (bytes_received <= 0) {
-             std::cout << "Error" << std::endl;
+            // A connection that keeps failing is retried less and less often instead of spinning on it
+            static LogRateLimiter limiter(5, std::chrono::seconds(1));
+            Logger::getInstance().log(LogLevel::ERROR, limiter, "Error receiving from the satellite");
+            retry_delay = std::min(std::max(retry_delay * 2, RECEIVE_RETRY_MIN_DELAY), RECEIVE_RETRY_MAX_DELAY);
+            std::this_thread::sleep_for(retry_delay);
             continue; // Skip to the next iteration
         }
 
-        if(char_buffer[0] == 0 && response.empty()){
-            continue;
-        }
+        retry_delay = std::chrono::milliseconds{0};
+        m_frame_decoder.feed(chunk.data(), static_cast<size_t>(bytes_received));
+    }
+}
 
-        response.push_back(char_buffer[0]);
-        
-        if(::isalpha(response[0]) || response[0] == '\n'){
-            if(char_buffer[0] == '\n')
-            {
-                std::string debug_message(response.begin(), response.end());
-                if(debug_message.length() > 1){
-                    std::cout << "Satellite Debug: " << debug_message;
-                }
+constexpr uint32_t AltairServer::command_hash(std::string_view name)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (char c : name) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    return hash;
+}
 
-                response.clear();
-            }
-        }
-        else{
-            if(char_buffer[0] == END_MARK)
-            {
-                if((response.size() >= response[0])){
-                    handle_response(response);
-                    response.clear();
-                }
+constexpr AltairServer::CommandTable AltairServer::make_command_table()
+{
+    // Client protocol: every command name and the handler that serves it
+    constexpr CommandRoute routes[] = {
+        { "get_sensor_data",        &AltairServer::command_get_sensor_data },
+        { "get_recent_sensor_data", &AltairServer::command_get_recent_sensor_data },
+        { "update_light",           &AltairServer::command_update_light },
+        { "update_min_temp",        &AltairServer::command_update_min_temp },
+        { "update_max_temp",        &AltairServer::command_update_max_temp },
+        { "update_humidity",        &AltairServer::command_update_humidity },
+        { "update_voltage",         &AltairServer::command_update_voltage },
+        { "get_sensor_logs",        &AltairServer::command_get_sensor_logs },
+        { "get_events_logs",        &AltairServer::command_get_events_logs },
+        { "get_sensor_stats",       &AltairServer::command_get_sensor_stats },
+        { "get_log_progress",       &AltairServer::command_get_log_progress },
+        { "get_current_time",       &AltairServer::command_get_current_time },
+        { "set_time",               &AltairServer::command_set_time },
+        { "subscribe",              &AltairServer::command_subscribe },
+        { "unsubscribe",            &AltairServer::command_unsubscribe },
+        { "help",                   &AltairServer::command_help },
+        { "binary",                 &AltairServer::command_binary },
+    };
+
+    CommandTable table{};
+    for (const auto& route : routes) {
+        // Open addressing with linear probing, evaluated at compile time
+        size_t slot = command_hash(route.name) % COMMAND_TABLE_SIZE;
+        while (table[slot].handler != nullptr) {
+            if (table[slot].name == route.name) {
+                throw std::logic_error("duplicate command route");
             }
+            slot = (slot + 1) % COMMAND_TABLE_SIZE;
         }
+        table[slot] = route;
     }
+    return table;
 }
 
-void AltairServer::handle_request(const std::string& message, std::shared_ptr<altair::ClientSession> client)
+void AltairServer::handle_request(const std::string& message, std::shared_ptr<altair::ClientSession> client, uint8_t tag)
 {
-    std::cout << "Altair server received message: " << message << std::endl;
+    static constexpr CommandTable commands = make_command_table();
+
+    Logger::getInstance().log(LogLevel::DEBUG, "Altair server received message: ", message);
     
-    // Parse the command from the message
-    std::istringstream iss(message);
-    std::string command;
-    iss >> command;
+    CommandTokenizer args(message);
+    std::string_view command = args.next();
     
-    if (command == "get_sensor_data") {
-        // Return the latest sensor data
-        std::stringstream response;
-        response << "Temperature: " << static_cast<int>(m_latest_data.temp) << "°C, "
-                 << "Humidity: " << static_cast<int>(m_latest_data.humid) << "%, "
-                 << "Light: " << static_cast<int>(m_latest_data.light) << "%, "
-                 << "Voltage: " << m_latest_data.voltage << "V, "
-                 << "Mode: ";
-        
-        switch (m_latest_data.mode) {
-            case ERROR_MODE: response << "Error"; break;
-            case SAFE_MODE: response << "Safe"; break;
-            case OK_MODE: response << "OK"; break;
-            default: response << "Unknown"; break;
+    // The table is mostly empty, so a lookup usually ends at the first slot
+    for (size_t slot = command_hash(command) % COMMAND_TABLE_SIZE;
+         commands[slot].handler != nullptr;
+         slot = (slot + 1) % COMMAND_TABLE_SIZE) {
+        if (commands[slot].name == command) {
+            (this->*commands[slot].handler)(args, client, tag);
+            return;
         }
-        
-        client->sendMessage(response.str());
     }
-    else if (command == "get_recent_sensor_data") {
+    
+    // Unknown command
+    client->sendMessage("Unknown command: " + std::string(command) + ". Type 'help' for available commands.", tag);
+}
 
-        if (m_latest_data.timestamp > 0) {
-            uint32_t end_time = m_latest_data.timestamp;
-            uint32_t start_time = (end_time > 50) ? (end_time - 50) : 0;
-            
-            get_sensor_in_range(start_time, end_time, client);
-            client->sendMessage("Retrieving sensor data from the last minute...");
-        } else {
-            client->sendMessage("Error: No sensor data available yet. Wait for a beacon.");
-        }
+void AltairServer::command_get_sensor_data(CommandTokenizer&, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag)
+{
+    // Return the latest sensor data
+    SensorData latest = latest_data();
+    std::stringstream response;
+    response << "Temperature: " << static_cast<int>(latest.temp) << "°C, "
+             << "Humidity: " << static_cast<int>(latest.humid) << "%, "
+             << "Light: " << static_cast<int>(latest.light) << "%, "
+             << "Voltage: " << latest.voltage << "V, "
+             << "Mode: ";
+    
+    switch (latest.mode) {
+        case ERROR_MODE: response << "Error"; break;
+        case SAFE_MODE: response << "Safe"; break;
+        case OK_MODE: response << "OK"; break;
+        default: response << "Unknown"; break;
     }
-    else if (command == "update_light") {
-        // Parse the light value
-        int light_value;
-        iss >> light_value;
+    
+    client->sendMessage(response.str(), tag);
+}
+
+void AltairServer::command_get_recent_sensor_data(CommandTokenizer&, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag)
+{
+    uint32_t latest_timestamp = latest_data().timestamp;
+    if (latest_timestamp > 0) {
+        uint32_t end_time = latest_timestamp;
+        uint32_t start_time = (end_time > 50) ? (end_time - 50) : 0;
         
-        if (light_value >= 0 && light_value <= 100) {
-            update_light(static_cast<uint8_t>(light_value));
-            client->sendMessage("Light updated to " + std::to_string(light_value) + "%");
-        } else {
-            client->sendMessage("Error: Light value must be between 0 and 100");
-        }
+        client->sendMessage("Retrieving sensor data from the last minute...", tag);
+        get_sensor_in_range(start_time, end_time, client, tag);
+    } else {
+        client->sendMessage("Error: No sensor data available yet. Wait for a beacon.", tag);
     }
-    else if (command == "update_min_temp") {
-        // Parse the min temp value
-        int min_temp;
-        iss >> min_temp;
-        
-        if (iss.fail()) {
-            client->sendMessage("Error: Invalid temperature value");
-        } else {
-            update_min_temp(static_cast<uint8_t>(min_temp));
-            client->sendMessage("Minimum temperature updated to " + std::to_string(min_temp) + "°C");
+}
+
+void AltairServer::command_update_light(CommandTokenizer& args, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag)
+{
+    // Parse the light value
+    int light_value = -1;
+    args.next_number(light_value);
+    
+    if (light_value >= 0 && light_value <= 100) {
+        update_light(static_cast<uint8_t>(light_value));
+        client->sendMessage("Light updated to " + std::to_string(light_value) + "%", tag);
+    } else {
+        client->sendMessage("Error: Light value must be between 0 and 100", tag);
+    }
+}
+
+void AltairServer::command_update_min_temp(CommandTokenizer& args, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag)
+{
+    // Parse the min temp value
+    int min_temp;
+    
+    if (!args.next_number(min_temp)) {
+        client->sendMessage("Error: Invalid temperature value", tag);
+    } else {
+        update_min_temp(static_cast<uint8_t>(min_temp));
+        client->sendMessage("Minimum temperature updated to " + std::to_string(min_temp) + "°C", tag);
+    }
+}
+
+void AltairServer::command_update_max_temp(CommandTokenizer& args, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag)
+{
+    // Parse the max temp value
+    int max_temp;
+    
+    if (!args.next_number(max_temp)) {
+        client->sendMessage("Error: Invalid temperature value", tag);
+    } else {
+        update_max_temp(static_cast<uint8_t>(max_temp));
+        client->sendMessage("Maximum temperature updated to " + std::to_string(max_temp) + "°C", tag);
+    }
+}
+
+void AltairServer::command_update_humidity(CommandTokenizer& args, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag)
+{
+    // Parse the humidity value
+    int humidity;
+    
+    if (!args.next_number(humidity)) {
+        client->sendMessage("Error: Invalid humidity value", tag);
+    } else if (humidity >= 0 && humidity <= 100) {
+        update_humidity(static_cast<uint8_t>(humidity));
+        client->sendMessage("Humidity updated to " + std::to_string(humidity) + "%", tag);
+    } else {
+        client->sendMessage("Error: Humidity value must be between 0 and 100", tag);
+    }
+}
+
+void AltairServer::command_update_voltage(CommandTokenizer& args, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag)
+{
+    // Parse the voltage value
+    float voltage;
+    
+    if (!args.next_number(voltage)) {
+        client->sendMessage("Error: Invalid voltage value", tag);
+    } else if (voltage > 3.3f || voltage < 0.1f) {
+        client->sendMessage("Error: Voltage value must be between 0.1 and 3.3", tag);
+    } else {
+        update_voltage(voltage);
+        client->sendMessage("Voltage updated to " + std::to_string(voltage) + "V", tag);
+    }
+}
+
+void AltairServer::command_get_sensor_logs(CommandTokenizer& args, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag)
+{
+    // Parse start and end timestamps
+    uint32_t start, end;
+    
+    if (!args.next_number(start) || !args.next_number(end)) {
+        client->sendMessage("Error: Invalid timestamp values. Format: get_logs <start_timestamp> <end_timestamp>", tag);
+    } else {
+        client->sendMessage("Requested logs between " + std::to_string(start) + " and " + std::to_string(end) + ". Processing...", tag);
+        get_sensor_in_range(start, end, client, tag);
+    }
+}
+
+void AltairServer::command_get_events_logs(CommandTokenizer& args, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag)
+{
+    // Parse start and end timestamps
+    uint32_t start, end;
+    
+    if (!args.next_number(start) || !args.next_number(end)) {
+        client->sendMessage("Error: Invalid timestamp values. Format: get_events_logs <start_timestamp> <end_timestamp>", tag);
+    } else {
+        get_event_in_range(start, end, client, tag);
+        client->sendMessage("Requested logs between " + std::to_string(start) + " and " + std::to_string(end) + ". Processing...", tag);
+    }
+}
+
+void AltairServer::command_get_sensor_stats(CommandTokenizer& args, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag)
+{
+    // Parse the time range and the period width in seconds
+    uint32_t start, end, resolution;
+    
+    if (!args.next_number(start) || !args.next_number(end) || !args.next_number(resolution) ||
+        resolution == 0 || start > end) {
+        client->sendMessage("Error: Invalid values. Format: get_sensor_stats <start_timestamp> <end_timestamp> <resolution_seconds>", tag);
+        return;
+    }
+    if (end / resolution - start / resolution + 1 > MAX_STATS_PERIODS) {
+        client->sendMessage("Error: Too many periods, at most " + std::to_string(MAX_STATS_PERIODS) +
+                            ". Use a coarser resolution or a shorter range.", tag);
+        return;
+    }
+
+    // Answered from the stored history, without asking the satellite
+    auto periods = m_sensor_data_manager.getSensorStats(start, end, resolution);
+    std::ostringstream response;
+    response << std::fixed;
+    size_t reported = 0;
+    for (const auto& stats : *periods) {
+        if (stats.count == 0) {
+            continue;
         }
+        double count = stats.count;
+        response << m_packet_parser.format_timestamp(stats.start_time) << " - "
+                 << m_packet_parser.format_timestamp(stats.end_time) << ": " << stats.count << " samples\n"
+                 << std::setprecision(1)
+                 << "  Temperature min/avg/max: " << static_cast<int>(stats.temp.min) << "/" << stats.temp.sum / count
+                 << "/" << static_cast<int>(stats.temp.max) << "°C\n"
+                 << "  Humidity min/avg/max: " << static_cast<int>(stats.humid.min) << "/" << stats.humid.sum / count
+                 << "/" << static_cast<int>(stats.humid.max) << "%\n"
+                 << "  Light min/avg/max: " << static_cast<int>(stats.light.min) << "/" << stats.light.sum / count
+                 << "/" << static_cast<int>(stats.light.max) << "%\n"
+                 << std::setprecision(2)
+                 << "  Voltage min/avg/max: " << stats.voltage.min << "/" << stats.voltage.sum / count
+                 << "/" << stats.voltage.max << "V\n"
+                 << "  Modes: OK " << stats.modes[OK_MODE] << ", Safe " << stats.modes[SAFE_MODE]
+                 << ", Error " << stats.modes[ERROR_MODE];
+        if (stats.modes[0] != 0) {
+            response << ", Unknown " << stats.modes[0];
+        }
+        response << "\n";
+        ++reported;
     }
-    else if (command == "update_max_temp") {
-        // Parse the max temp value
-        int max_temp;
-        iss >> max_temp;
-        
-        if (iss.fail()) {
-            client->sendMessage("Error: Invalid temperature value");
-        } else {
-            update_max_temp(static_cast<uint8_t>(max_temp));
-            client->sendMessage("Maximum temperature updated to " + std::to_string(max_temp) + "°C");
+
+    if (reported == 0) {
+        client->sendMessage("No sensor data stored between " + std::to_string(start) + " and " + std::to_string(end) + ".\n", tag);
+    } else {
+        client->sendMessage(response.str(), tag);
+    }
+}
+
+void AltairServer::command_get_log_progress(CommandTokenizer&, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag)
+{
+    std::ostringstream response;
+    {
+        std::lock_guard<std::mutex> lock(m_log_mutex);
+        for (const auto& query : m_log_queries) {
+            if (query->client != client) {
+                continue;
+            }
+            uint64_t unrequested = 0;
+            for (const auto& [from, to] : query->backlog) {
+                unrequested += uint64_t(to) - from + 1;
+            }
+            response << "Sensor logs " << query->start << " - " << query->end << ": "
+                     << query->received << " records in " << query->replies << " replies, "
+                     << query->own_fetches << " requests in flight, "
+                     << query->pending - query->own_fetches << " shared with other queries, "
+                     << unrequested << " seconds not requested yet\n";
         }
     }
-    else if (command == "update_humidity") {
-        // Parse the humidity value
-        int humidity;
-        iss >> humidity;
-        
-        if (iss.fail()) {
-            client->sendMessage("Error: Invalid humidity value");
-        } else if (humidity >= 0 && humidity <= 100) {
-            update_humidity(static_cast<uint8_t>(humidity));
-            client->sendMessage("Humidity updated to " + std::to_string(humidity) + "%");
-        } else {
-            client->sendMessage("Error: Humidity value must be between 0 and 100");
+
+    std::string progress = response.str();
+    client->sendMessage(progress.empty() ? "No log retrieval in progress.\n" : progress, tag);
+}
+
+void AltairServer::command_get_current_time(CommandTokenizer&, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag)
+{
+    get_current_time(client, tag);
+}
+
+void AltairServer::command_set_time(CommandTokenizer& args, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag)
+{
+    // Parse the new time value
+    uint32_t new_time;
+    
+    if (!args.next_number(new_time)) {
+        client->sendMessage("Error: Invalid time value. Format: set_time <unix_timestamp>", tag);
+        return;
+    }
+    
+    // Simple validation - don't allow setting time before the latest data timestamp
+    uint32_t latest_timestamp = latest_data().timestamp;
+    if (latest_timestamp > 0 && new_time < latest_timestamp) {
+        client->sendMessage("Error: Cannot set time before the latest sensor data timestamp (" 
+                          + std::to_string(latest_timestamp) + ")", tag);
+    } else {
+        // Store the new time to be sent when satellite requests time
+        send_custom_time(new_time);
+        //set new_time string
+        std::string new_time_str = m_packet_parser.format_timestamp(new_time);
+
+        client->sendMessage("\nSet custom time to:" + new_time_str + "\n", tag);
+    }
+}
+
+void AltairServer::command_subscribe(CommandTokenizer& args, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag)
+{
+    // Parse the filter terms, no terms means every beacon and event
+    TelemetrySubscriptions::Filter filter;
+    for (std::string_view term = args.next(); !term.empty(); term = args.next()) {
+        if (!TelemetrySubscriptions::parse_term(term, filter)) {
+            client->sendMessage("Error: Invalid filter '" + std::string(term) + "'. Format: subscribe [beacon] [event] [mode_change] [<field><op><value>...]", tag);
+            return;
         }
     }
-    else if (command == "update_voltage") {
-        // Parse the voltage value
-        float voltage;
-        iss >> voltage;
+    
+    if (m_subscriptions.subscribe(client, filter)) {
+        client->sendMessage("Subscribed to live telemetry.\n", tag);
+    } else {
+        client->sendMessage("Error: Too many distinct filters in use. Please try again later.", tag);
+    }
+}
+
+void AltairServer::command_unsubscribe(CommandTokenizer&, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag)
+{
+    if (m_subscriptions.unsubscribe(client->getClientId())) {
+        client->sendMessage("Unsubscribed from live telemetry.\n", tag);
+    } else {
+        client->sendMessage("Error: Not subscribed.", tag);
+    }
+}
+
+void AltairServer::command_help(CommandTokenizer&, const std::shared_ptr<altair::ClientSession>& client, uint8_t tag)
+{
+    // Send the available commands in a more organized and attractive format
+    static const std::string help_message =
+        "🛰️ === ALTAIR SATELLITE COMMAND CENTER === 🛰️\n\n"
+        "📊 SENSOR DATA COMMANDS:\n"
+        "  • get_sensor_data         - Get the latest sensor readings\n"
+        "  • get_recent_sensor_data  - Get sensor data from the last minute\n\n"
         
-        if (iss.fail()) {
-            client->sendMessage("Error: Invalid voltage value");
-        } else {
-            if(voltage > 3.3f || voltage < 0.1f){
-                client->sendMessage("Error: Voltage value must be between 0.1 and 3.3");
-                return;
+        "⏰ TIME MANAGEMENT:\n"
+        "  • get_current_time        - Get the current time from the satellite\n"
+        "  • set_time <timestamp>    - Set custom time for the satellite\n\n"
+        
+        "🔧 SATELLITE CONFIGURATION:\n"
+        "  • update_light <value>    - Set light level (0-100)\n"
+        "  • update_min_temp <value> - Set minimum temperature\n"
+        "  • update_max_temp <value> - Set maximum temperature\n"
+        "  • update_humidity <value> - Set humidity level (0-100)\n"
+        "  • update_voltage <value>  - Set voltage level (0.1-3.3V)\n\n"
+        
+        "📝 LOG RETRIEVAL:\n"
+        "  • get_sensor_logs <start> <end> - Request sensor logs between timestamps\n"
+        "  • get_events_logs <start> <end> - Request events logs between timestamps (MAX 10)\n"
+        "  • get_sensor_stats <start> <end> <resolution>\n"
+        "                              - Min/avg/max and modes of the stored history per\n"
+        "                                <resolution> seconds (e.g. 3600 for hourly)\n"
+        "  • get_log_progress        - Show the progress of your sensor log requests\n\n"
+        
+        "📡 LIVE TELEMETRY:\n"
+        "  • subscribe [filters]     - Push beacons and events as they arrive\n"
+        "                              filters: beacon, event, mode_change,\n"
+        "                              <temp|humid|light|voltage><op><value> (op: < <= > >=)\n"
+        "  • unsubscribe             - Stop live telemetry\n\n"
+        
+        "🔌 PROTOCOL:\n"
+        "  • binary                  - Switch this connection to the binary frame protocol\n\n"
+        
+        "ℹ️ HELP:\n"
+        "  • help                    - Show this help message\n\n";
+    
+    client->sendMessage(help_message, tag);
+}
+
+void AltairServer::command_binary(CommandTokenizer&, const std::shared_ptr<altair::ClientSession>& client, uint8_t)
+{
+    // Confirmed in text, everything after this line is framed (see binary_protocol.hpp)
+    client->sendMessage("Switched to binary protocol.\n");
+    client->setBinaryFraming();
+}
+
+void AltairServer::handle_binary_request(const uint8_t* frame, size_t size, std::shared_ptr<altair::ClientSession> client)
+{
+    uint8_t kind = frame[0];
+    uint8_t tag = frame[1];
+    const uint8_t* body = frame + 2;
+    size_t body_size = size - 2;
+
+    switch (kind) {
+        case binary::REQUEST_SENSOR_DATA: {
+            uint8_t record[SENSOR_RECORD_SIZE];
+            PacketCodec::encode(latest_data(), record);
+            client->sendFrame(binary::REPLY_SENSOR_RECORDS, tag, record, sizeof(record));
+            break;
+        }
+        case binary::REQUEST_SENSOR_LOGS:
+        case binary::REQUEST_EVENT_LOGS: {
+            if (body_size != TIME_RANGE_SIZE) {
+                reply_error(client, tag, "Error: Log requests carry a start and end timestamp");
+                break;
             }
-            else{
-                update_voltage(voltage);
-                client->sendMessage("Voltage updated to " + std::to_string(voltage) + "V");
+            uint32_t start = schema::TimeRange::start::get(body);
+            uint32_t end = schema::TimeRange::end::get(body);
+            if (kind == binary::REQUEST_SENSOR_LOGS) {
+                get_sensor_in_range(start, end, client, tag);
+            } else {
+                get_event_in_range(start, end, client, tag);
             }
+            break;
         }
+        case binary::REQUEST_CURRENT_TIME:
+            get_current_time(client, tag);
+            break;
+        case binary::REQUEST_SUBSCRIBE: {
+            TelemetrySubscriptions::Filter filter;
+            CommandTokenizer terms(std::string_view(reinterpret_cast<const char*>(body), body_size));
+            for (std::string_view term = terms.next(); !term.empty(); term = terms.next()) {
+                if (!TelemetrySubscriptions::parse_term(term, filter)) {
+                    reply_error(client, tag, "Error: Invalid filter '" + std::string(term) + "'");
+                    return;
+                }
+            }
+            if (m_subscriptions.subscribe(client, filter)) {
+                client->sendFrame(binary::REPLY_OK, tag, nullptr, 0);
+            } else {
+                reply_error(client, tag, "Error: Too many distinct filters in use. Please try again later.");
+            }
+            break;
+        }
+        case binary::REQUEST_UNSUBSCRIBE:
+            m_subscriptions.unsubscribe(client->getClientId());
+            client->sendFrame(binary::REPLY_OK, tag, nullptr, 0);
+            break;
+        case binary::REQUEST_COMMAND:
+            // Any text command; its replies arrive as REPLY_TEXT frames with the request's tag
+            handle_request(std::string(reinterpret_cast<const char*>(body), body_size), client, tag);
+            break;
+        default:
+            reply_error(client, tag, "Error: Unknown request kind " + std::to_string(kind));
+            break;
     }
-    else if (command == "get_sensor_logs") {
-        // Parse start and end timestamps
-        uint32_t start, end;
-        iss >> start >> end;
-        
-        if (iss.fail()) {
-            client->sendMessage("Error: Invalid timestamp values. Format: get_logs <start_timestamp> <end_timestamp>");
-        } else {
-            get_sensor_in_range(start, end, client);
-            client->sendMessage("Requested logs between " + std::to_string(start) + " and " + std::to_string(end) + ". Processing...");
+}
+
+void AltairServer::get_current_time(std::shared_ptr<altair::ClientSession> client, uint8_t tag)
+{
+    std::optional<InFlightTable::Ticket> request = acquire_request_id(client, tag);
+    if (!request) {
+        return;
+    }
+
+    MessagePacket packet = m_packet_parser.create_message_packet(ResponseType::REQUEST_CURRENT_TIME, request->id);
+    packet.data_len += sizeof(uint32_t);
+
+    send_packet_to_altair(packet, request->generation, UplinkScheduler::INTERACTIVE, PACKET_HEADER_SIZE + TIME_VALUE_SIZE);
+}
+
+void AltairServer::get_event_in_range(uint32_t start, uint32_t end, std::shared_ptr<altair::ClientSession> client, uint8_t tag)
+{
+    fetch_events(EventWaiter{ client, tag, start, end, client->holdOpen() }, true);
+}
+
+void AltairServer::fetch_events(EventWaiter waiter, bool join_wider)
+{
+    uint32_t start = waiter.start;
+    uint32_t end = waiter.end;
+    auto fetch = std::make_shared<EventFetch>();
+    {
+        std::lock_guard<std::mutex> lock(m_log_mutex);
+
+        // A fetch in flight covering the range serves it too; one of the same range starts with what it already received
+        for (const auto& active : m_event_fetches) {
+            bool same = active->start == start && active->end == end;
+            if (same || (join_wider && active->start <= start && end <= active->end)) {
+                if (same) {
+                    for (const EventData& event_data : active->records) {
+                        send_event_record(waiter, event_data);
+                    }
+                }
+                active->waiters.push_back(std::move(waiter));
+                return;
+            }
         }
+
+        fetch->waiters.push_back(std::move(waiter));
+        fetch->start = start;
+        fetch->end = end;
+        m_event_fetches.push_back(fetch);
     }
-    else if (command == "get_events_logs") {
-        // Parse start and end timestamps
-        uint32_t start, end;
-        iss >> start >> end;
-        
-        if (iss.fail()) {
-            client->sendMessage("Error: Invalid timestamp values. Format: get_events_logs <start_timestamp> <end_timestamp>");
+
+    std::optional<InFlightTable::Ticket> request = m_in_flight.acquire(nullptr, 0, fetch);
+    if (!request) {
+        complete_event_fetch(fetch, "Error: Too many requests waiting for the satellite. Please try again.");
+        return;
+    }
+
+    MessagePacket packet = m_packet_parser.create_message_packet(ResponseType::REQUEST_EVENT_LOG, request->id);
+    packet.data_len += TIME_RANGE_SIZE;
+
+    PacketCodec::encode_time_range(start, end, packet.buffer);
+
+    send_packet_to_altair(packet, request->generation, UplinkScheduler::INTERACTIVE, log_reply_bytes(EVENT_RECORD_SIZE));
+}
+
+void AltairServer::complete_event_fetch(const std::shared_ptr<EventFetch>& fetch, const char* failure)
+{
+    std::vector<EventWaiter> waiters;
+    std::vector<EventData> records;
+    {
+        std::lock_guard<std::mutex> lock(m_log_mutex);
+        m_event_fetches.erase(std::remove(m_event_fetches.begin(), m_event_fetches.end(), fetch), m_event_fetches.end());
+        waiters.swap(fetch->waiters);
+        records.swap(fetch->records);
+    }
+
+    for (EventWaiter& waiter : waiters) {
+        if (failure) {
+            reply_error(waiter.client, waiter.tag, failure);
+            continue;
+        }
+
+        if (waiter.start != fetch->start || waiter.end != fetch->end) {
+            // A full answer stops at the satellite's limit and may miss events of the narrower range
+            if (records.size() >= SATELLITE_MAX_LOGS) {
+                fetch_events(std::move(waiter), false);
+                continue;
+            }
+            for (const EventData& event_data : records) {
+                send_event_record(waiter, event_data);
+            }
+        }
+
+        if (waiter.client->isBinary()) {
+            waiter.client->sendFrame(binary::REPLY_END, waiter.tag, nullptr, 0);
         } else {
-            get_event_in_range(start, end, client);
-            client->sendMessage("Requested logs between " + std::to_string(start) + " and " + std::to_string(end) + ". Processing...");
+            waiter.client->sendMessage("\nCompleted retrieval of events logs.\n");
         }
     }
-    else if (command == "get_current_time") {
-        get_current_time(client);
+}
+
+void AltairServer::send_event_record(const EventWaiter& waiter, const EventData& event_data)
+{
+    if (event_data.timestamp < waiter.start || event_data.timestamp > waiter.end) {
+        return;
+    }
 
+    if (waiter.client->isBinary()) {
+        uint8_t record[EVENT_RECORD_SIZE];
+        PacketCodec::encode(event_data, record);
+        waiter.client->sendFrame(binary::REPLY_EVENT_RECORDS, waiter.tag, record, sizeof(record));
+    } else {
+        std::string data_str = m_packet_parser.event_data_to_string(event_data);
+        waiter.client->sendMessage("\nEvent log data:\n" + data_str);
     }
-        else if (command == "set_time") {
-        // Parse the new time value
-        uint32_t new_time;
-        iss >> new_time;
-        
-        if (iss.fail()) {
-            client->sendMessage("Error: Invalid time value. Format: set_time <unix_timestamp>");
-        } else {
-            // Simple validation - don't allow setting time before the latest data timestamp
-            if (m_latest_data.timestamp > 0 && new_time < m_latest_data.timestamp) {
-                client->sendMessage("Error: Cannot set time before the latest sensor data timestamp (" 
-                                  + std::to_string(m_latest_data.timestamp) + ")");
-            } else {
-                // Store the new time to be sent when satellite requests time
-                send_custom_time(new_time);
-                //set new_time string
-                std::string new_time_str = m_packet_parser.format_timestamp(new_time);
+}
 
-                client->sendMessage("\nSet custom time to:" + new_time_str + "\n");
-            }
+void AltairServer::get_sensor_in_range(uint32_t start, uint32_t end, std::shared_ptr<altair::ClientSession> client, uint8_t tag)
+{
+    if (start > end) {
+        reply_error(client, tag, "Error: The start timestamp is after the end timestamp.\n");
+        return;
+    }
+
+    std::vector<CoverageMap::Interval> missing = m_sensor_data_manager.getMissingIntervals(start, end);
+    if (missing.empty()) {
+        // Every record is already on the ground, the link is not used
+        reply_sensor_logs(client, tag, start, end, end);
+        return;
+    }
+
+    auto query = std::make_shared<LogQuery>();
+    query->client = client;
+    query->tag = tag;
+    query->start = start;
+    query->end = end;
+    query->priority = UplinkScheduler::INTERACTIVE;
+    query->window = m_fetch_window;
+    query->hold = client->holdOpen();
+    start_log_query(query, missing);
+}
+
+void AltairServer::start_log_query(const std::shared_ptr<LogQuery>& query, const std::vector<CoverageMap::Interval>& missing)
+{
+    query->backlog.assign(missing.begin(), missing.end());
+
+    // Spread the missing seconds over the window, so that many chains of requests page through them side by side;
+    // with at most one record per second, a piece of SATELLITE_MAX_LOGS seconds is answered by one reply
+    uint64_t missing_seconds = 0;
+    for (const auto& [from, to] : missing) {
+        missing_seconds += uint64_t(to) - from + 1;
+    }
+    query->piece_span = static_cast<uint32_t>(std::clamp<uint64_t>((missing_seconds + query->window - 1) / query->window,
+                                                                   SATELLITE_MAX_LOGS, MAX_FETCH_SPAN));
+    query->complete_until = query->end;
+
+    std::vector<std::shared_ptr<LogFetch>> requests;
+    {
+        std::lock_guard<std::mutex> lock(m_log_mutex);
+        m_log_queries.push_back(query);
+
+        // One extra count keeps the query from being answered while its first requests are still being sent
+        query->pending = 1;
+        plan_log_fetches(query, requests);
+    }
+
+    send_log_fetches(requests);
+
+    {
+        std::lock_guard<std::mutex> lock(m_log_mutex);
+        if (!release_log_query(query)) {
+            return;
         }
     }
-    else if (command == "help") {
-        // Send the available commands in a more organized and attractive format
-        std::string help_message =
-            "🛰️ === ALTAIR SATELLITE COMMAND CENTER === 🛰️\n\n"
-            "📊 SENSOR DATA COMMANDS:\n"
-            "  • get_sensor_data         - Get the latest sensor readings\n"
-            "  • get_recent_sensor_data  - Get sensor data from the last minute\n\n"
-            
-            "⏰ TIME MANAGEMENT:\n"
-            "  • get_current_time        - Get the current time from the satellite\n"
-            "  • set_time <timestamp>    - Set custom time for the satellite\n\n"
-            
-            "🔧 SATELLITE CONFIGURATION:\n"
-            "  • update_light <value>    - Set light level (0-100)\n"
-            "  • update_min_temp <value> - Set minimum temperature\n"
-            "  • update_max_temp <value> - Set maximum temperature\n"
-            "  • update_humidity <value> - Set humidity level (0-100)\n"
-            "  • update_voltage <value>  - Set voltage level (0.1-3.3V)\n\n"
-            
-            "📝 LOG RETRIEVAL:\n"
-            "  • get_sensor_logs <start> <end> - Request sensor logs between timestamps (MAX 10)\n"
-            "  • get_events_logs <start> <end> - Request events logs between timestamps (MAX 10)\n\n"
-            
-            "ℹ️ HELP:\n"
-            "  • help                    - Show this help message\n\n";
-            
+    finish_log_query(query);
+}
 
-        
-        client->sendMessage(help_message);
+void AltairServer::finish_log_query(const std::shared_ptr<LogQuery>& query)
+{
+    if (query->cancelled) {
+        return;
     }
-        
-    else {
-        // Unknown command
-        client->sendMessage("Unknown command: " + command + ". Type 'help' for available commands.");
+    if (query->client) {
+        reply_sensor_logs(query->client, query->tag, query->start, query->end, query->complete_until);
+        return;
+    }
+
+    // A backfill job; what the satellite failed to answer is not tried again, it may not hold it at all.
+    // A request that never reached the link, for want of a free ID, is tried again by the next job.
+    std::lock_guard<std::mutex> lock(m_log_mutex);
+    m_backfill_active = false;
+    if (query->unanswered && query->complete_until < static_cast<int64_t>(query->end)) {
+        m_backfill_failed.add(static_cast<uint32_t>(std::max<int64_t>(query->complete_until + 1, query->start)), query->end);
     }
 }
 
+void AltairServer::cancel_log_queries(const std::shared_ptr<altair::ClientSession>& client)
+{
+    std::vector<std::pair<uint8_t, uint32_t>> dropped;
+    {
+        std::lock_guard<std::mutex> lock(m_log_mutex);
+        bool cancelled = false;
+        for (const auto& query : m_log_queries) {
+            if (query->client == client) {
+                query->cancelled = true;
+                query->backlog.clear();
+                cancelled = true;
+            }
+        }
+        if (!cancelled) {
+            return;
+        }
 
+        // Queued requests of cancelled queries alone are taken off the uplink before they are written
+        m_uplink.cancel([&](const std::vector<uint8_t>& packet, uint32_t generation) {
+            // A stale packet whose ID now serves another request must not extend that request's deadline
+            auto fetch = std::dynamic_pointer_cast<LogFetch>(m_in_flight.peek(packet[2], generation));
+            if (!fetch || std::any_of(fetch->queries.begin(), fetch->queries.end(),
+                    [](const std::shared_ptr<LogQuery>& query) { return !query->cancelled; })) {
+                return false;
+            }
+            dropped.emplace_back(packet[2], generation);
+            return true;
+        });
+    }
+
+    // Never sent, so the requests end like failed ones, which also releases their queries
+    for (const auto& [request_id, generation] : dropped) {
+        std::shared_ptr<RequestContext> context;
+        if (m_in_flight.generation(request_id) != generation) {
+            continue;
+        }
+        m_in_flight.release(request_id, nullptr, &context);
+        if (auto fetch = std::dynamic_pointer_cast<LogFetch>(context)) {
+            complete_log_fetch(fetch, false, false);
+        }
+    }
+}
 
-void AltairServer::get_current_time(std::shared_ptr<altair::ClientSession> client)
+void AltairServer::schedule_backfill()
 {
-    MessagePacket packet = m_packet_parser.create_message_packet(ResponseType::REQUEST_CURRENT_TIME, m_id_generator.generateID());
-    packet.data_len += sizeof(uint32_t);
+    m_backfill_timer.expires_after(BACKFILL_PERIOD);
+    m_backfill_timer.async_wait([this](const boost::system::error_code& error) {
+        if (error || !m_backfill_running) {
+            return;
+        }
+        backfill();
+        schedule_backfill();
+    });
+}
 
-    m_request_clients[packet.m_respnse_id] = client;
-    
-    // std::cout << "Storing request ID " << static_cast<int>(packet.m_respnse_id) 
-    //           << " for client " << client->getClientId() << std::endl;
+void AltairServer::backfill()
+{
+    // Only while nothing else waits for the link
+    if (m_uplink.queued() != 0) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_log_mutex);
+        if (m_backfill_active || !m_log_queries.empty() || !m_event_fetches.empty()) {
+            return;
+        }
+    }
 
-    send_packet_to_altair(packet);
+    // Within the horizon, up to what the satellite has surely logged
+    uint32_t latest_timestamp = latest_data().timestamp;
+    if (latest_timestamp <= COVERAGE_SETTLE_SECONDS) {
+        return;
+    }
+    uint32_t until = latest_timestamp - COVERAGE_SETTLE_SECONDS;
+    uint32_t from = until > BACKFILL_HORIZON ? until - BACKFILL_HORIZON : 0;
+
+    std::vector<CoverageMap::Interval> gaps =
+        m_sensor_data_manager.findGaps(from, until, m_sample_interval, BACKFILL_GAP_LOOKAHEAD);
+
+    auto query = std::make_shared<LogQuery>();
+    {
+        std::lock_guard<std::mutex> lock(m_log_mutex);
+        auto gap = std::find_if(gaps.begin(), gaps.end(), [&](const CoverageMap::Interval& interval) {
+            return !m_backfill_failed.covers(interval.first, interval.second);
+        });
+        if (gap == gaps.end()) {
+            return;
+        }
+        query->start = m_backfill_failed.missing(gap->first, gap->second).front().first;
+        query->end = static_cast<uint32_t>(std::min<uint64_t>(gap->second, uint64_t(query->start) + BACKFILL_MAX_SPAN - 1));
+        m_backfill_active = true;
+    }
+
+    // One request at a time at the lowest priority, so a client request waits for at most one reply
+    query->priority = UplinkScheduler::BACKGROUND;
+    query->window = 1;
+    start_log_query(query, { { query->start, query->end } });
 }
 
-void AltairServer::get_event_in_range(uint32_t start, uint32_t end, std::shared_ptr<altair::ClientSession> client)
+void AltairServer::plan_log_fetches(const std::shared_ptr<LogQuery>& query, std::vector<std::shared_ptr<LogFetch>>& requests)
 {
+    uint32_t latest_timestamp = latest_data().timestamp;
+    uint32_t settled_until = latest_timestamp > COVERAGE_SETTLE_SECONDS ? latest_timestamp - COVERAGE_SETTLE_SECONDS : 0;
 
-    MessagePacket packet = m_packet_parser.create_message_packet(ResponseType::REQUEST_EVENT_LOG, m_id_generator.generateID());
-    packet.data_len += (sizeof(uint32_t) * 2);
+    while (!query->backlog.empty() && query->own_fetches < query->window) {
+        auto& [from, to] = query->backlog.front();
 
-    // Store the request ID and client in the hashmap
-    m_request_clients[packet.m_respnse_id] = client;
-    
-    // std::cout << "Storing request ID " << static_cast<int>(packet.m_respnse_id) 
-    //           << " for client " << client->getClientId() << std::endl;
+        // Another fetch may have stored the start of the interval since it was planned
+        std::vector<CoverageMap::Interval> missing = m_sensor_data_manager.getMissingIntervals(from, to);
+        if (missing.empty()) {
+            query->backlog.pop_front();
+            continue;
+        }
+        from = missing.front().first;
+
+        uint64_t next;
+        auto active = std::lower_bound(m_log_fetches.begin(), m_log_fetches.end(), from,
+            [](const std::shared_ptr<LogFetch>& fetch, uint32_t time) { return fetch->end < time; });
+        if (active != m_log_fetches.end() && (*active)->start <= from) {
+            // Already requested for another query, wait for the same answer; its follow-ups get the more urgent priority
+            (*active)->queries.push_back(query);
+            (*active)->priority = std::min((*active)->priority, query->priority);
+            ++query->pending;
+            next = uint64_t((*active)->end) + 1;
+        } else {
+            // A request of one piece, ending before the next fetch in flight
+            uint64_t last = std::min<uint64_t>(uint64_t(from) + query->piece_span - 1, to);
+            if (active != m_log_fetches.end()) {
+                last = std::min<uint64_t>(last, (*active)->start - 1);
+            }
 
-    uint8_t* uint32_buffer = (uint8_t*)&start;
+            auto fetch = std::make_shared<LogFetch>();
+            fetch->queries.push_back(query);
+            fetch->owner = query;
+            fetch->priority = query->priority;
+            fetch->start = from;
+            fetch->end = static_cast<uint32_t>(last);
+            fetch->settled_until = settled_until;
+            m_log_fetches.insert(active, fetch);
+            ++query->pending;
+            ++query->own_fetches;
+            requests.push_back(fetch);
+            next = last + 1;
+        }
 
-    for (int i = 0; i < 4; ++i) {
-        packet.buffer[i] = *uint32_buffer++;
+        if (next > to) {
+            query->backlog.pop_front();
+        } else {
+            from = static_cast<uint32_t>(next);
+        }
     }
+}
 
-    uint32_buffer = (uint8_t*)&end;
+void AltairServer::send_log_fetches(const std::vector<std::shared_ptr<LogFetch>>& requests)
+{
+    for (const auto& fetch : requests) {
+        std::optional<InFlightTable::Ticket> request = m_in_flight.acquire(nullptr, 0, fetch);
+        if (!request) {
+            complete_log_fetch(fetch, false, false);
+            continue;
+        }
+
+        MessagePacket packet = m_packet_parser.create_message_packet(ResponseType::REQUEST_SENSOR_LOGS, request->id);
+        packet.data_len += TIME_RANGE_SIZE;
+
+        PacketCodec::encode_time_range(fetch->start, fetch->end, packet.buffer);
 
-    for (int i = 0; i < 4; ++i) {
-        packet.buffer[i + 4] = *uint32_buffer++;
+        send_packet_to_altair(packet, request->generation, fetch->priority, log_reply_bytes(SENSOR_RECORD_SIZE));
     }
+}
 
-    send_packet_to_altair(packet);
+bool AltairServer::release_log_query(const std::shared_ptr<LogQuery>& query)
+{
+    if (--query->pending != 0) {
+        return false;
+    }
+    m_log_queries.erase(std::remove(m_log_queries.begin(), m_log_queries.end(), query), m_log_queries.end());
+    return true;
 }
 
-void AltairServer::get_sensor_in_range(uint32_t start, uint32_t end, std::shared_ptr<altair::ClientSession> client)
+void AltairServer::complete_log_fetch(const std::shared_ptr<LogFetch>& fetch, bool answered, bool sent)
 {
+    std::vector<std::shared_ptr<LogFetch>> requests;
+    std::vector<std::shared_ptr<LogQuery>> answered_queries;
+    {
+        std::lock_guard<std::mutex> lock(m_log_mutex);
+        auto position = std::find(m_log_fetches.begin(), m_log_fetches.end(), fetch);
+
+        for (const auto& query : fetch->queries) {
+            query->replies += answered ? 1 : 0;
+            query->received += fetch->received;
+        }
 
-    MessagePacket packet = m_packet_parser.create_message_packet(ResponseType::REQUEST_SENSOR_LOGS, m_id_generator.generateID());
-    packet.data_len += (sizeof(uint32_t) * 2);
+        bool wanted = std::any_of(fetch->queries.begin(), fetch->queries.end(),
+            [](const std::shared_ptr<LogQuery>& query) { return !query->cancelled; });
+        if (answered && wanted && fetch->received >= SATELLITE_MAX_LOGS &&
+            fetch->last_timestamp >= fetch->start && fetch->last_timestamp < fetch->end) {
+            // The reply was cut short after its last record, a follow-up request takes over the rest
+            m_sensor_data_manager.markCovered(fetch->start, fetch->last_timestamp);
+
+            uint32_t latest_timestamp = latest_data().timestamp;
+            auto follow_up = std::make_shared<LogFetch>();
+            follow_up->queries = std::move(fetch->queries);
+            follow_up->owner = std::move(fetch->owner);
+            follow_up->priority = fetch->priority;
+            follow_up->start = fetch->last_timestamp + 1;
+            follow_up->end = fetch->end;
+            follow_up->settled_until = latest_timestamp > COVERAGE_SETTLE_SECONDS ? latest_timestamp - COVERAGE_SETTLE_SECONDS : 0;
+            if (position != m_log_fetches.end()) {
+                *position = follow_up;
+            }
+            requests.push_back(follow_up);
+        } else {
+            if (position != m_log_fetches.end()) {
+                m_log_fetches.erase(position);
+            }
 
-    // Store the request ID and client in the hashmap
-    m_request_clients[packet.m_respnse_id] = client;
-    
-    uint8_t* uint32_buffer = (uint8_t*)&start;
+            if (!answered) {
+                // Nothing is known from the start of the failed request on, stop fetching for its queries
+                for (const auto& query : fetch->queries) {
+                    query->complete_until = std::min<int64_t>(query->complete_until, static_cast<int64_t>(fetch->start) - 1);
+                    query->backlog.clear();
+                    query->unanswered = query->unanswered || sent;
+                }
+            } else {
+                // Every record the satellite holds, but records younger than the settle margin may not be logged yet
+                uint32_t covered_until = std::min(fetch->end, std::max(fetch->settled_until, fetch->last_timestamp));
+                if (fetch->received >= SATELLITE_MAX_LOGS) {
+                    covered_until = std::min(fetch->end, fetch->last_timestamp);
+                }
+                if (covered_until >= fetch->start) {
+                    m_sensor_data_manager.markCovered(fetch->start, covered_until);
+                }
+            }
+
+            // The owner's window has room for its next request
+            if (fetch->owner) {
+                --fetch->owner->own_fetches;
+                plan_log_fetches(fetch->owner, requests);
+            }
 
-    for (int i = 0; i < 4; ++i) {
-        packet.buffer[i] = *uint32_buffer++;
+            for (const auto& query : fetch->queries) {
+                if (release_log_query(query)) {
+                    answered_queries.push_back(query);
+                }
+            }
+            fetch->queries.clear();
+            fetch->owner.reset();
+        }
     }
 
-    uint32_buffer = (uint8_t*)&end;
+    send_log_fetches(requests);
+
+    for (const auto& query : answered_queries) {
+        finish_log_query(query);
+    }
+}
+
+void AltairServer::reply_sensor_logs(const std::shared_ptr<altair::ClientSession>& client, uint8_t tag,
+                                     uint32_t start, uint32_t end, int64_t complete_until)
+{
+    if (complete_until < static_cast<int64_t>(start)) {
+        reply_error(client, tag, "Error: Could not retrieve sensor logs from the satellite. Please try again.\n");
+        return;
+    }
+
+    uint32_t until = static_cast<uint32_t>(std::min<int64_t>(complete_until, end));
+    auto records = std::make_shared<const std::vector<SensorData>>(
+        m_sensor_data_manager.getSensorDataInRange(start, until).value_or(std::vector<SensorData>()));
+    send_sensor_log_page(client, tag, records, 0, until, end);
+}
+
+void AltairServer::send_sensor_log_page(const std::shared_ptr<altair::ClientSession>& client, uint8_t tag,
+                                        const std::shared_ptr<const std::vector<SensorData>>& records, size_t first,
+                                        uint32_t until, uint32_t end)
+{
+    size_t last = std::min(records->size(), first + REPLY_PAGE_RECORDS);
+
+    if (client->isBinary()) {
+        constexpr size_t RECORDS_PER_FRAME = binary::MAX_BODY_SIZE / SENSOR_RECORD_SIZE;
+        std::vector<uint8_t> body;
+        for (size_t frame = first; frame < last; frame += RECORDS_PER_FRAME) {
+            size_t count = std::min(RECORDS_PER_FRAME, last - frame);
+            body.resize(count * SENSOR_RECORD_SIZE);
+            for (size_t i = 0; i < count; ++i) {
+                PacketCodec::encode((*records)[frame + i], body.data() + i * SENSOR_RECORD_SIZE);
+            }
+            client->sendFrame(binary::REPLY_SENSOR_RECORDS, tag, body.data(), body.size());
+        }
+        if (last == records->size()) {
+            client->sendFrame(binary::REPLY_END, tag, nullptr, 0);
+        }
+    } else {
+        std::string message;
+        for (size_t i = first; i < last; ++i) {
+            message += "\nSensor log data:\n";
+            message += m_packet_parser.sensor_data_to_string((*records)[i]);
+        }
+        if (last == records->size()) {
+            if (until < end) {
+                message += "Retrieved sensor logs up to " + std::to_string(until) + ", request the rest from " +
+                           std::to_string(until + 1) + ".\n";
+            } else {
+                message += "Completed retrieval of sensor logs.\n";
+            }
+        }
+        client->sendMessage(message);
+    }
 
-    for (int i = 0; i < 4; ++i) {
-        packet.buffer[i + 4] = *uint32_buffer++;
+    if (last == records->size()) {
+        return;
     }
 
-    send_packet_to_altair(packet);
+    // The next page is only built once the client has read most of this one, so the queue stays bounded
+    // and a client that half-closed is not disconnected before the last page
+    std::weak_ptr<altair::ClientSession> weak_client = client;
+    std::shared_ptr<void> hold = client->holdOpen();
+    client->whenDrained(REPLY_PAGE_QUEUED_BYTES, [this, weak_client, tag, records, last, until, end, hold]() {
+        if (auto client = weak_client.lock()) {
+            send_sensor_log_page(client, tag, records, last, until, end);
+        }
+    });
 }
 
 void AltairServer::send_custom_time(uint32_t custom_time)
@@ -523,7 +1325,7 @@ void AltairServer::send_current_time()
     
     send_value<uint32_t>(ResponseType::TIME_SEND, epoch_time);
     
-    std::cout << "Sending time " << epoch_time << std::endl;
+    Logger::getInstance().log(LogLevel::INFO, "Sending time ", epoch_time);
 }
 
 void AltairServer::update_max_temp(uint8_t max_temp)
@@ -551,34 +1353,63 @@ void AltairServer::update_voltage(float voltage)
     send_value<float>(ResponseType::UPDATE_VOLTAGE, voltage);
 }
 
+std::optional<InFlightTable::Ticket> AltairServer::acquire_request_id(std::shared_ptr<altair::ClientSession> client, uint8_t tag)
+{
+    std::shared_ptr<ClientRequest> context;
+    if (client) {
+        context = std::make_shared<ClientRequest>();
+        context->hold = client->holdOpen();
+    }
+
+    std::optional<InFlightTable::Ticket> request = m_in_flight.acquire(client, tag, context);
+    if (!request) {
+        if (client) {
+            reply_error(client, tag, "Error: Too many requests waiting for the satellite. Please try again.");
+        } else {
+            static LogRateLimiter limiter(5, std::chrono::seconds(1));
+            Logger::getInstance().log(LogLevel::WARN, limiter, "No free request ID, dropping uplink packet");
+        }
+    }
+    return request;
+}
+
+void AltairServer::reply_error(const std::shared_ptr<altair::ClientSession>& client, uint8_t tag, const std::string& message)
+{
+    if (client->isBinary()) {
+        client->sendFrame(binary::REPLY_ERROR, tag, message.data(), std::min(message.size(), binary::MAX_BODY_SIZE));
+    } else {
+        client->sendMessage(message);
+    }
+}
+
 template<typename T>
 void AltairServer::send_value(ResponseType type, const T& value) 
 {
-    
-    MessagePacket packet =  m_packet_parser.create_message_packet(type, m_id_generator.generateID());
-    packet.data_len += sizeof(T);
-    
-    const uint8_t* data_ptr = reinterpret_cast<const uint8_t*>(&value);
-    
-    for (size_t i = 0; i < sizeof(T); ++i) {
-        packet.buffer[i] = data_ptr[i];
+    // Nobody waits for the ACK, but the ID stays reserved until it arrives or times out
+    std::optional<InFlightTable::Ticket> request = acquire_request_id(nullptr);
+    if (!request) {
+        return;
     }
+
+    MessagePacket packet =  m_packet_parser.create_message_packet(type, request->id);
+    packet.data_len += schema::Value<T>::size;
+    
+    PacketCodec::encode_value<T>(value, packet.buffer);
     
-    send_packet_to_altair(packet);
+    // Configuration and time sync go ahead of every queued request
+    send_packet_to_altair(packet, request->generation, UplinkScheduler::CONTROL, PACKET_HEADER_SIZE);
 }
 
-void AltairServer::send_packet_to_altair(MessagePacket& message_packet)
+void AltairServer::send_packet_to_altair(MessagePacket& message_packet, uint32_t generation,
+                                         UplinkScheduler::Priority priority,
+                                         size_t reply_bytes)
 {
     std::vector<uint8_t> message_buffer;
 
     message_buffer.push_back(message_packet.data_len);
     message_buffer.push_back(message_packet.packetType);
 
-    // id 0xFF are reserved for satellite callbacks (Beacon, Event)
-    // if the id is 0xFF, generate a new one
-    if(message_packet.m_respnse_id == 0xFF){
-        message_packet.m_respnse_id = m_id_generator.generateID();
-    }
+    // id 0xFF is reserved for satellite callbacks (Beacon, Event), the in-flight table never hands it out
     message_buffer.push_back(message_packet.m_respnse_id);
     message_buffer.push_back(message_packet.checksum);
 
@@ -588,7 +1419,20 @@ void AltairServer::send_packet_to_altair(MessagePacket& message_packet)
 
     message_buffer.push_back(message_packet.end_mark);
     
-    m_connection->send(message_buffer);
+    // Requests come from every io thread, the scheduler's thread is the only one writing to the link
+    size_t cost = message_buffer.size() + reply_bytes;
+    m_uplink.submit(priority, std::move(message_buffer), cost, generation);
+}
+
+void AltairServer::write_to_altair(const std::vector<uint8_t>& packet, uint32_t generation)
+{
+    // The reply deadline runs from the moment the request is on the line, not from when it was queued;
+    // a request that ended while queued is not sent, its ID may already belong to another request
+    uint8_t request_id = packet[2];
+    if (request_id != InFlightTable::RESERVED_ID && !m_in_flight.mark_sent(request_id, generation)) {
+        return;
+    }
+    m_connection->send(packet);
 }
 
 } // namespace altair
@@ -0,0 +1,197 @@
+#include "asio_serial_connection.hpp"
+#include "logger.hpp"
+
+namespace altair {
+
+AsioSerialConnection::AsioSerialConnection(const std::string& port, const SerialSettings& settings):
+m_port_name(port),
+m_settings(settings),
+m_io_context(nullptr),
+m_port(),
+m_reopen_timer(),
+m_read_buffer(settings.read_chunk_size > 0 ? settings.read_chunk_size : 1),
+m_handler()
+{
+}
+
+AsioSerialConnection::~AsioSerialConnection()
+{
+    stop_async_receive();
+}
+
+size_t AsioSerialConnection::bytes_per_second() const
+{
+    // A start bit, the data bits, the parity bit if any and the stop bits; one and a half rounds up
+    unsigned int frame_bits = 1 + m_settings.character_size +
+                              (m_settings.parity == SerialSettings::port_base::parity::none ? 0 : 1) +
+                              (m_settings.stop_bits == SerialSettings::port_base::stop_bits::one ? 1 : 2);
+    return m_settings.baud_rate / frame_bits;
+}
+
+bool AsioSerialConnection::is_valid() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_port && m_port->is_open();
+}
+
+bool AsioSerialConnection::start_async_receive(boost::asio::io_context& io_context, ReceiveHandler handler)
+{
+    stop_async_receive();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_io_context = &io_context;
+    m_reopen_timer = std::make_unique<boost::asio::steady_timer>(io_context);
+    m_handler = std::move(handler);
+
+    // A port missing at startup is waited for like one lost later, instead of falling back to polling it
+    if (!open_port()) {
+        schedule_reopen();
+    }
+    return true;
+}
+
+void AsioSerialConnection::stop_async_receive()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_io_context = nullptr;
+
+    boost::system::error_code ignored;
+    if (m_reopen_timer) {
+        m_reopen_timer->cancel();
+        m_reopen_timer.reset();
+    }
+    if (m_port) {
+        m_port->cancel(ignored);
+        m_port->close(ignored);
+        m_port.reset();
+    }
+}
+
+bool AsioSerialConnection::open_port()
+{
+    using port_base = boost::asio::serial_port_base;
+
+    auto port = std::make_unique<boost::asio::serial_port>(*m_io_context);
+    boost::system::error_code error;
+
+    static LogRateLimiter limiter(1, std::chrono::seconds(60));
+    port->open(m_port_name, error);
+    if (error) {
+        Logger::getInstance().log(LogLevel::ERROR, limiter, "Error opening serial port: ", error.message());
+        return false;
+    }
+
+    port->set_option(port_base::baud_rate(m_settings.baud_rate), error);
+    if (!error) port->set_option(port_base::character_size(m_settings.character_size), error);
+    if (!error) port->set_option(port_base::parity(m_settings.parity), error);
+    if (!error) port->set_option(port_base::stop_bits(m_settings.stop_bits), error);
+    if (!error) port->set_option(port_base::flow_control(m_settings.flow_control), error);
+
+    if (error) {
+        Logger::getInstance().log(LogLevel::ERROR, limiter, "Error setting serial port options: ", error.message());
+        return false;
+    }
+
+    m_port = std::move(port);
+    start_read();
+    return true;
+}
+
+void AsioSerialConnection::schedule_reopen()
+{
+    m_reopen_timer->expires_after(REOPEN_DELAY);
+    m_reopen_timer->async_wait([this](const boost::system::error_code& error) {
+        if (error) {
+            return;  // Stopped
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_io_context || m_port) {
+            return;
+        }
+        if (open_port()) {
+            Logger::getInstance().log(LogLevel::INFO, "Serial port ", m_port_name, " opened");
+        } else {
+            schedule_reopen();
+        }
+    });
+}
+
+ssize_t AsioSerialConnection::send(const std::vector<uint8_t>& message)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_port || !m_port->is_open()) {
+        return -1;
+    }
+
+    boost::system::error_code error;
+    size_t bytes_written = boost::asio::write(*m_port, boost::asio::buffer(message), error);
+    if (error) {
+        return -1;
+    }
+    return static_cast<ssize_t>(bytes_written);
+}
+
+ssize_t AsioSerialConnection::receive(std::vector<uint8_t>& message, size_t size)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_port || !m_port->is_open()) {
+        return -1;
+    }
+
+    message.resize(size);
+
+    boost::system::error_code error;
+    size_t bytes_read = m_port->read_some(boost::asio::buffer(message), error);
+    if (error) {
+        message.clear();
+        return -1;
+    }
+
+    message.resize(bytes_read);
+    return static_cast<ssize_t>(bytes_read);
+}
+
+void AsioSerialConnection::start_read()
+{
+    m_port->async_read_some(
+        boost::asio::buffer(m_read_buffer),
+        [this](const boost::system::error_code& error, size_t bytes_transferred) {
+            handle_read(error, bytes_transferred);
+        }
+    );
+}
+
+void AsioSerialConnection::handle_read(const boost::system::error_code& error, size_t bytes_transferred)
+{
+    if (error == boost::asio::error::operation_aborted) {
+        return;  // The port was closed
+    }
+
+    if (error) {
+        static LogRateLimiter limiter(5, std::chrono::seconds(1));
+        Logger::getInstance().log(LogLevel::ERROR, limiter, "Serial read error: ", error.message(),
+                                  ", reopening the port");
+
+        // A device that went away comes back under the same name, input resumes once it does
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_port && m_io_context) {
+            boost::system::error_code ignored;
+            m_port->close(ignored);
+            m_port.reset();
+            schedule_reopen();
+        }
+        return;
+    }
+
+    if (bytes_transferred > 0 && m_handler) {
+        m_handler(m_read_buffer.data(), bytes_transferred);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_port && m_port->is_open()) {
+        start_read();
+    }
+}
+
+} // namespace altair
@@ -0,0 +1,90 @@
+#include "beacon_file.hpp"
+#include "packet_codec.hpp"
+#include "write_ahead_log.hpp"
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace altair {
+
+namespace {
+
+// [crc32 4][sequence 4][record]
+constexpr size_t SLOT_SIZE = 8 + SENSOR_RECORD_SIZE;
+constexpr size_t SLOT_COUNT = 2;
+
+} // namespace
+
+std::unique_ptr<BeaconFile> BeaconFile::open(const std::string& path, std::optional<SensorData>& latest)
+{
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    // The newest intact slot wins; a short or missing file simply holds no beacon
+    uint8_t slots[SLOT_SIZE * SLOT_COUNT] = {};
+    ssize_t read_size = pread(fd, slots, sizeof(slots), 0);
+    uint32_t sequence = 0;
+    for (size_t slot = 0; slot < SLOT_COUNT; ++slot) {
+        const uint8_t* in = slots + slot * SLOT_SIZE;
+        if (read_size < static_cast<ssize_t>((slot + 1) * SLOT_SIZE)) {
+            break;
+        }
+
+        uint32_t crc;
+        uint32_t slot_sequence;
+        std::memcpy(&crc, in, sizeof(crc));
+        std::memcpy(&slot_sequence, in + 4, sizeof(slot_sequence));
+        if (slot_sequence == 0 || slot_sequence <= sequence || WriteAheadLog::checksum(in + 4, SLOT_SIZE - 4) != crc) {
+            continue;
+        }
+
+        SensorData data;
+        PacketCodec::decode(in + 8, data);
+        latest = data;
+        sequence = slot_sequence;
+    }
+
+    return std::unique_ptr<BeaconFile>(new BeaconFile(fd, sequence));
+}
+
+BeaconFile::BeaconFile(int fd, uint32_t sequence):
+m_fd(fd),
+m_sequence(sequence)
+{
+}
+
+BeaconFile::~BeaconFile()
+{
+    close(m_fd);
+}
+
+bool BeaconFile::write(const SensorData& data)
+{
+    // The slot not holding the latest beacon is overwritten
+    uint32_t sequence = m_sequence + 1;
+    uint8_t slot[SLOT_SIZE];
+    std::memcpy(slot + 4, &sequence, sizeof(sequence));
+    PacketCodec::encode(data, slot + 8);
+    uint32_t crc = WriteAheadLog::checksum(slot + 4, SLOT_SIZE - 4);
+    std::memcpy(slot, &crc, sizeof(crc));
+
+    off_t offset = static_cast<off_t>((sequence % SLOT_COUNT) * SLOT_SIZE);
+    if (pwrite(m_fd, slot, sizeof(slot), offset) != static_cast<ssize_t>(sizeof(slot))) {
+        return false;
+    }
+    m_sequence = sequence;
+    return true;
+}
+
+bool BeaconFile::clear()
+{
+    if (ftruncate(m_fd, 0) != 0) {
+        return false;
+    }
+    m_sequence = 0;
+    return true;
+}
+
+} // namespace altair
@@ -0,0 +1,81 @@
+#include "coverage_map.hpp"
+#include <algorithm>
+
+namespace altair {
+
+void CoverageMap::add(uint32_t start, uint32_t end)
+{
+    if (end < start) {
+        return;
+    }
+
+    // Start from the last range beginning at or before start, it may overlap or touch the new one
+    auto it = m_ranges.upper_bound(start);
+    if (it != m_ranges.begin()) {
+        auto previous = std::prev(it);
+        if (uint64_t(previous->second) + 1 >= start) {
+            it = previous;
+        }
+    }
+
+    // Swallow every range overlapping or touching [start, end]
+    uint32_t merged_start = start;
+    uint32_t merged_end = end;
+    while (it != m_ranges.end() && uint64_t(it->first) <= uint64_t(end) + 1) {
+        merged_start = std::min(merged_start, it->first);
+        merged_end = std::max(merged_end, it->second);
+        it = m_ranges.erase(it);
+    }
+    m_ranges.emplace(merged_start, merged_end);
+}
+
+bool CoverageMap::covers(uint32_t start, uint32_t end) const
+{
+    if (end < start) {
+        return true;
+    }
+    auto it = m_ranges.upper_bound(start);
+    if (it == m_ranges.begin()) {
+        return false;
+    }
+    --it;
+    return it->second >= end;
+}
+
+std::vector<CoverageMap::Interval> CoverageMap::missing(uint32_t start, uint32_t end) const
+{
+    std::vector<Interval> gaps;
+    if (end < start) {
+        return gaps;
+    }
+
+    auto it = m_ranges.upper_bound(start);
+    if (it != m_ranges.begin() && std::prev(it)->second >= start) {
+        --it;
+    }
+
+    uint64_t cursor = start;
+    for (; it != m_ranges.end() && it->first <= end; ++it) {
+        if (it->first > cursor) {
+            gaps.emplace_back(static_cast<uint32_t>(cursor), it->first - 1);
+        }
+        cursor = std::max<uint64_t>(cursor, uint64_t(it->second) + 1);
+        if (cursor > end) {
+            return gaps;
+        }
+    }
+    gaps.emplace_back(static_cast<uint32_t>(cursor), end);
+    return gaps;
+}
+
+std::vector<CoverageMap::Interval> CoverageMap::intervals() const
+{
+    return std::vector<Interval>(m_ranges.begin(), m_ranges.end());
+}
+
+void CoverageMap::clear()
+{
+    m_ranges.clear();
+}
+
+} // namespace altair
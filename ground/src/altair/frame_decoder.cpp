@@ -0,0 +1,122 @@
+#include "frame_decoder.hpp"
+#include <cctype>
+#include <cstring>
+
+namespace altair {
+
+FrameDecoder::FrameDecoder(FrameHandler on_frame, TextHandler on_text):
+m_on_frame(std::move(on_frame)),
+m_on_text(std::move(on_text)),
+m_state(State::IDLE),
+m_expected(0),
+m_scanned(0),
+m_dropped(0)
+{
+    m_pending.reserve(MAX_TEXT_LINE);
+}
+
+void FrameDecoder::feed(const uint8_t* data, size_t len)
+{
+    if (m_pending.empty()) {
+        // Fast path: decode straight from the caller's buffer and only keep the tail
+        size_t consumed = decode(data, len);
+        m_pending.assign(data + consumed, data + len);
+        return;
+    }
+
+    m_pending.insert(m_pending.end(), data, data + len);
+    size_t consumed = decode(m_pending.data(), m_pending.size());
+    m_pending.erase(m_pending.begin(), m_pending.begin() + consumed);
+}
+
+void FrameDecoder::reset()
+{
+    m_pending.clear();
+    m_state = State::IDLE;
+    m_expected = 0;
+    m_scanned = 0;
+    m_dropped = 0;
+}
+
+size_t FrameDecoder::dropped_bytes() const
+{
+    return m_dropped;
+}
+
+size_t FrameDecoder::decode(const uint8_t* data, size_t len)
+{
+    size_t pos = 0;
+
+    while (pos < len) {
+        const uint8_t* unit = data + pos;
+        size_t avail = len - pos;
+
+        switch (m_state) {
+        case State::IDLE: {
+            uint8_t first = unit[0];
+
+            if (first == 0) {
+                // Line idle filler between packets
+                ++pos;
+            } else if (first == END_MARK) {
+                // END_MARK is also 'U'; a stray one is the tail of a broken packet, not text
+                ++m_dropped;
+                ++pos;
+            } else if (std::isalpha(first)) {
+                m_state = State::TEXT;
+                m_scanned = 0;
+            } else if (first < PACKET_HEADER_SIZE || first > MAX_FRAME_SIZE) {
+                ++m_dropped;
+                ++pos;
+            } else {
+                m_state = State::FRAME;
+                m_expected = first;
+            }
+            break;
+        }
+
+        case State::FRAME: {
+            // A zero packet type is never sent, reject it before waiting for the whole packet
+            bool bad_type = avail > 1 && unit[1] == 0;
+
+            if (!bad_type && avail < m_expected) {
+                return pos;
+            }
+
+            if (bad_type || unit[m_expected - 1] != END_MARK) {
+                // Not a packet boundary, drop the length byte and rescan from the next one
+                ++m_dropped;
+                ++pos;
+            } else {
+                m_on_frame(unit, m_expected);
+                pos += m_expected;
+            }
+            m_state = State::IDLE;
+            break;
+        }
+
+        case State::TEXT: {
+            const void* newline = std::memchr(unit + m_scanned, '\n', avail - m_scanned);
+            size_t line_len;
+
+            if (newline != nullptr) {
+                line_len = static_cast<const uint8_t*>(newline) - unit + 1;
+            } else if (avail >= MAX_TEXT_LINE) {
+                line_len = MAX_TEXT_LINE;
+            } else {
+                m_scanned = avail;
+                return pos;
+            }
+
+            m_on_text(reinterpret_cast<const char*>(unit), line_len);
+            pos += line_len;
+            m_state = State::IDLE;
+            break;
+        }
+        }
+    }
+
+    return pos;
+}
+
+} // namespace altair
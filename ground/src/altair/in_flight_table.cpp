@@ -0,0 +1,211 @@
+#include "in_flight_table.hpp"
+
+namespace altair {
+
+InFlightTable::InFlightTable(boost::asio::io_context& io_context,
+                             std::chrono::milliseconds timeout,
+                             std::chrono::milliseconds tick):
+m_id_generator(IDGenerator::getInstance()),
+m_timeout(timeout),
+m_tick(tick),
+m_timer(io_context),
+m_running(false),
+m_on_timeout(),
+m_slots()
+{
+}
+
+void InFlightTable::set_timeout_handler(TimeoutHandler handler)
+{
+    m_on_timeout = std::move(handler);
+}
+
+void InFlightTable::start()
+{
+    if (m_running.exchange(true)) {
+        return;
+    }
+    schedule_tick();
+}
+
+void InFlightTable::stop()
+{
+    m_running = false;
+    m_timer.cancel();
+}
+
+std::optional<InFlightTable::Ticket> InFlightTable::acquire(std::shared_ptr<ClientSession> client, uint8_t tag,
+                                                            std::shared_ptr<RequestContext> context)
+{
+    for (size_t attempt = 0; attempt < SLOT_COUNT; ++attempt) {
+        uint8_t id = m_id_generator.generateID();
+        if (id == RESERVED_ID) {
+            continue;
+        }
+
+        Slot& slot = m_slots[id];
+        std::unique_lock<std::mutex> lock(slot.mutex, std::try_to_lock);
+        if (!lock.owns_lock() || slot.busy.load(std::memory_order_acquire)) {
+            // Still waiting for a reply (or being handled right now), try the next ID
+            continue;
+        }
+
+        slot.client = std::move(client);
+        slot.tag = tag;
+        slot.context = std::move(context);
+        slot.deadline.store(NOT_SENT, std::memory_order_relaxed);
+        slot.busy.store(true, std::memory_order_release);
+        return Ticket{ id, slot.generation.load(std::memory_order_relaxed) };
+    }
+
+    return std::nullopt;
+}
+
+uint32_t InFlightTable::generation(uint8_t id) const
+{
+    return m_slots[id].generation.load(std::memory_order_relaxed);
+}
+
+bool InFlightTable::mark_sent(uint8_t id, uint32_t generation)
+{
+    Slot& slot = m_slots[id];
+    std::lock_guard<std::mutex> lock(slot.mutex);
+
+    if (!slot.busy.load(std::memory_order_relaxed) ||
+        slot.generation.load(std::memory_order_relaxed) != generation) {
+        return false;
+    }
+    slot.deadline.store(next_deadline(), std::memory_order_relaxed);
+    return true;
+}
+
+bool InFlightTable::is_in_flight(uint8_t id) const
+{
+    return m_slots[id].busy.load(std::memory_order_acquire);
+}
+
+std::shared_ptr<ClientSession> InFlightTable::find(uint8_t id, uint8_t* tag, std::shared_ptr<RequestContext>* context)
+{
+    Slot& slot = m_slots[id];
+    std::lock_guard<std::mutex> lock(slot.mutex);
+
+    if (!slot.busy.load(std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    if (tag) {
+        *tag = slot.tag;
+    }
+    if (context) {
+        *context = slot.context;
+    }
+
+    if (slot.deadline.load(std::memory_order_relaxed) != NOT_SENT) {
+        slot.deadline.store(next_deadline(), std::memory_order_relaxed);
+    }
+    return slot.client;
+}
+
+std::shared_ptr<RequestContext> InFlightTable::peek(uint8_t id, uint32_t generation) const
+{
+    const Slot& slot = m_slots[id];
+    std::lock_guard<std::mutex> lock(slot.mutex);
+
+    if (!slot.busy.load(std::memory_order_relaxed) ||
+        slot.generation.load(std::memory_order_relaxed) != generation) {
+        return nullptr;
+    }
+    return slot.context;
+}
+
+std::shared_ptr<ClientSession> InFlightTable::release(uint8_t id, uint8_t* tag, std::shared_ptr<RequestContext>* context)
+{
+    Slot& slot = m_slots[id];
+    std::lock_guard<std::mutex> lock(slot.mutex);
+
+    if (!slot.busy.load(std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    if (tag) {
+        *tag = slot.tag;
+    }
+    if (context) {
+        *context = slot.context;
+    }
+
+    std::shared_ptr<ClientSession> client = std::move(slot.client);
+    slot.client.reset();
+    slot.context.reset();
+    slot.generation.fetch_add(1, std::memory_order_relaxed);
+    slot.busy.store(false, std::memory_order_release);
+    return client;
+}
+
+size_t InFlightTable::in_flight_count() const
+{
+    size_t count = 0;
+    for (const auto& slot : m_slots) {
+        count += slot.busy.load(std::memory_order_relaxed) ? 1 : 0;
+    }
+    return count;
+}
+
+void InFlightTable::schedule_tick()
+{
+    m_timer.expires_after(m_tick);
+    m_timer.async_wait([this](const boost::system::error_code& error) {
+        if (error || !m_running) {
+            return;
+        }
+        sweep();
+        schedule_tick();
+    });
+}
+
+void InFlightTable::sweep()
+{
+    int64_t now = Clock::now().time_since_epoch().count();
+
+    for (size_t id = 0; id < SLOT_COUNT; ++id) {
+        Slot& slot = m_slots[id];
+
+        // Lock-free pre-check, most slots are idle or far from their deadline
+        if (!slot.busy.load(std::memory_order_acquire) ||
+            slot.deadline.load(std::memory_order_relaxed) > now) {
+            continue;
+        }
+        uint32_t generation = slot.generation.load(std::memory_order_relaxed);
+
+        std::shared_ptr<ClientSession> client;
+        std::shared_ptr<RequestContext> context;
+        uint8_t tag = 0;
+        {
+            std::lock_guard<std::mutex> lock(slot.mutex);
+
+            // The reply may have arrived, or the ID been reused, since the pre-check
+            if (!slot.busy.load(std::memory_order_relaxed) ||
+                slot.generation.load(std::memory_order_relaxed) != generation ||
+                slot.deadline.load(std::memory_order_relaxed) > now) {
+                continue;
+            }
+
+            client = std::move(slot.client);
+            context = std::move(slot.context);
+            tag = slot.tag;
+            slot.client.reset();
+            slot.context.reset();
+            slot.generation.fetch_add(1, std::memory_order_relaxed);
+            slot.busy.store(false, std::memory_order_release);
+        }
+
+        if (m_on_timeout) {
+            m_on_timeout(static_cast<uint8_t>(id), tag, std::move(client), std::move(context));
+        }
+    }
+}
+
+int64_t InFlightTable::next_deadline() const
+{
+    return (Clock::now() + m_timeout).time_since_epoch().count();
+}
+
+} // namespace altair
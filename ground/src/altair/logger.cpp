@@ -0,0 +1,214 @@
+#include "logger.hpp"
+#include "timestamp_formatter.hpp"
+
+namespace altair {
+
+namespace {
+
+// Idle writer wakes up at least this often, which also bounds the delay of a lost wake-up
+constexpr auto WRITER_IDLE_TIMEOUT = std::chrono::milliseconds(50);
+
+// Length of "YYYY-MM-DD HH:MM:SS", the milliseconds go after it
+constexpr size_t SECONDS_END = 19;
+
+constexpr std::string_view LEVEL_NAMES[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+
+} // namespace
+
+LogRateLimiter::LogRateLimiter(uint32_t burst, std::chrono::steady_clock::duration period):
+m_burst(burst),
+m_period(period.count()),
+m_window_start(std::chrono::steady_clock::now().time_since_epoch().count()),
+m_count(0),
+m_suppressed(0)
+{
+}
+
+bool LogRateLimiter::allow(uint32_t& suppressed)
+{
+    int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+    int64_t window_start = m_window_start.load(std::memory_order_relaxed);
+
+    // The thread that moves the window on resets the count; a racing thread may still count against the old window
+    if (now - window_start >= m_period &&
+        m_window_start.compare_exchange_strong(window_start, now, std::memory_order_relaxed)) {
+        m_count.store(0, std::memory_order_relaxed);
+    }
+
+    if (m_count.fetch_add(1, std::memory_order_relaxed) >= m_burst) {
+        m_suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    suppressed = m_suppressed.exchange(0, std::memory_order_relaxed);
+    return true;
+}
+
+Logger& Logger::getInstance()
+{
+    static Logger instance;
+    return instance;
+}
+
+Logger::Logger():
+m_ring(),
+m_level(LogLevel::INFO),
+m_pushed(0),
+m_dropped(0),
+m_writer_idle(false),
+m_stop(false),
+m_wakeup_mutex(),
+m_wakeup(),
+m_written_cv(),
+m_written(0),
+m_output_mutex(),
+m_output(stdout),
+m_writer()
+{
+    m_writer = std::thread([this]() { run(); });
+}
+
+Logger::~Logger()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_wakeup_mutex);
+        m_stop.store(true);
+    }
+    m_wakeup.notify_one();
+    if (m_writer.joinable()) {
+        m_writer.join();
+    }
+
+    std::lock_guard<std::mutex> lock(m_output_mutex);
+    if (m_output != stdout) {
+        std::fclose(m_output);
+    }
+}
+
+void Logger::set_level(LogLevel level)
+{
+    m_level.store(level, std::memory_order_relaxed);
+}
+
+bool Logger::set_output_file(const std::string& path)
+{
+    FILE* file = std::fopen(path.c_str(), "a");
+    if (!file) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_output_mutex);
+    if (m_output != stdout) {
+        std::fclose(m_output);
+    }
+    m_output = file;
+    return true;
+}
+
+void Logger::set_output_stdout()
+{
+    std::lock_guard<std::mutex> lock(m_output_mutex);
+    if (m_output != stdout) {
+        std::fclose(m_output);
+    }
+    m_output = stdout;
+}
+
+void Logger::flush()
+{
+    uint64_t target = m_pushed.load(std::memory_order_acquire);
+
+    std::unique_lock<std::mutex> lock(m_wakeup_mutex);
+    m_writer_idle.store(false);
+    m_wakeup.notify_one();
+    m_written_cv.wait(lock, [&]() { return m_written >= target || m_stop.load(); });
+}
+
+uint64_t Logger::dropped() const
+{
+    return m_dropped.load(std::memory_order_relaxed);
+}
+
+void Logger::run()
+{
+    std::string batch;
+    uint64_t reported_dropped = 0;
+
+    while (true) {
+        uint64_t count = 0;
+        while (m_ring.try_pop([&](const Record& record) { format(record, batch); })) {
+            ++count;
+        }
+
+        uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+        if (dropped != reported_dropped) {
+            batch += "[WARN] Log ring full, dropped ";
+            batch += std::to_string(dropped - reported_dropped);
+            batch += " records\n";
+            reported_dropped = dropped;
+        }
+
+        if (!batch.empty()) {
+            write(batch);
+            batch.clear();
+        }
+
+        std::unique_lock<std::mutex> lock(m_wakeup_mutex);
+        m_written += count;
+        m_written_cv.notify_all();
+
+        if (m_stop.load() && !m_ring.ready()) {
+            return;
+        }
+
+        m_writer_idle.store(true);
+        m_wakeup.wait_for(lock, WRITER_IDLE_TIMEOUT, [&]() { return m_stop.load() || m_ring.ready(); });
+        m_writer_idle.store(false);
+    }
+}
+
+void Logger::format(const Record& record, std::string& out)
+{
+    auto seconds = static_cast<time_t>(record.time / 1000000000);
+    auto millis = static_cast<int>((record.time / 1000000) % 1000);
+
+    // "YYYY-MM-DD HH:MM:SS.mmm ZONE"
+    char time[TimestampFormatter::BUFFER_SIZE];
+    size_t length = TimestampFormatter::format(seconds, time, sizeof(time));
+    size_t seconds_end = std::min(length, SECONDS_END);
+    out.append(time, seconds_end);
+
+    char millis_text[8];
+    std::snprintf(millis_text, sizeof(millis_text), ".%03d", millis);
+    out += millis_text;
+    out.append(time + seconds_end, length - seconds_end);
+
+    out += " [";
+    out += LEVEL_NAMES[static_cast<size_t>(record.level)];
+    out += "] ";
+
+    if (record.suppressed != 0) {
+        out += "(";
+        out += std::to_string(record.suppressed);
+        out += " similar messages suppressed) ";
+    }
+
+    if (record.formatter) {
+        record.formatter(out, record.payload);
+    } else {
+        out.append(record.payload, record.size);
+    }
+
+    if (out.back() != '\n') {
+        out += '\n';
+    }
+}
+
+void Logger::write(const std::string& batch)
+{
+    std::lock_guard<std::mutex> lock(m_output_mutex);
+    std::fwrite(batch.data(), 1, batch.size(), m_output);
+    std::fflush(m_output);
+}
+
+} // namespace altair
@@ -1,4 +1,6 @@
 #include "packet_parser.hpp"
+#include "packet_codec.hpp"
+#include "timestamp_formatter.hpp"
 #include <iostream>
 #include <sstream>
 #include <ctime>
@@ -8,12 +10,12 @@
 namespace altair 
 {
 
-ResponseType PacketParser::parse_response_type(const std::vector<uint8_t>& response) const 
+ResponseType PacketParser::parse_response_type(const PacketView& response) const 
 {
     if (response.size() < 2) {
         return ResponseType::UNKNOWN;
     }
-    return static_cast<ResponseType>(response[1]);
+    return static_cast<ResponseType>(response.type());
 }
 
 std::string PacketParser::sensor_data_to_string(const SensorData& data) const
@@ -25,7 +27,10 @@ std::string PacketParser::sensor_data_to_string(const SensorData& data) const
        << "Mode: " << get_mode_string(static_cast<AltairModes>(data.mode)) << "\n"
        << "Voltage: " << std::fixed << std::setprecision(2) << data.voltage << "V\n"
        << "Timestamp: " << data.timestamp << "\n"
-       << "Local Time: "  << format_timestamp(data.timestamp)  << std::endl;
+       << "Local Time: ";
+    char local_time[TimestampFormatter::BUFFER_SIZE];
+    ss.write(local_time, format_timestamp(data.timestamp, local_time, sizeof(local_time)));
+    ss << std::endl;
     return ss.str();
 }
 
@@ -37,56 +42,22 @@ std::string PacketParser::event_data_to_string(const EventData& data) const
     return ss.str();
 }
 
-void PacketParser::parse_sensor_data(const std::vector<uint8_t>& response, SensorData& data) const 
+void PacketParser::parse_sensor_data(const PacketView& response, SensorData& data) const 
 {
-    size_t len = response.size();
-    size_t idx = 4;
-
-    if (len == 0) {
+    if (!response.has_payload(0, SENSOR_RECORD_SIZE)) {
         return;
     }
 
-    data.temp = response[idx++];
-    data.humid = response[idx++];
-    data.light = response[idx++];
-    data.mode = static_cast<AltairModes>(response[idx++]);
-    
-    
-    // Read float voltage (4 bytes)
-    
-    uint8_t* float_buffer = (uint8_t*)&data.voltage;
-    for (int i = 0; i < 4; ++i) {
-        *float_buffer++ = response[idx + i];
-    }
-
-
-    idx += 4;
-    
-    // Read uint32_t timestamp (4 bytes)
-    if (len > idx + 3) {
-        uint8_t* uint32_t_buffer = (uint8_t*)&data.timestamp;
-        for (int i = 0; i < 4; ++i) {
-            *uint32_t_buffer++ = response[idx + i];
-        }
-    }  
+    PacketCodec::decode(response.payload(), data);
 }
 
-void PacketParser::parse_event_data(const std::vector<uint8_t>& response, EventData& event_data) const 
+void PacketParser::parse_event_data(const PacketView& response, EventData& event_data) const 
 {
-    size_t len = response.size();
-    size_t idx = 4;
-
-    event_data.event = static_cast<AltairEvent>(response[idx++]);
-    
-
-    // Read uint32_t timestamp (4 bytes)
-    if (idx + 3 < len) {
-        uint8_t* uint32_buffer = (uint8_t*)&event_data.timestamp;
-        for (int i = 0; i < 4; ++i) {
-            *uint32_buffer++ = response[idx + i];
-        }
+    if (!response.has_payload(0, EVENT_RECORD_SIZE)) {
+        return;
     }
 
+    PacketCodec::decode(response.payload(), event_data);
 }
 
 void PacketParser::print_beacon_data(const SensorData& data) const
@@ -96,7 +67,9 @@ void PacketParser::print_beacon_data(const SensorData& data) const
 
     std::cout << "Mode: " << get_mode_string(data.mode) << std::endl;
     std::cout << "Timestamp: " << data.timestamp << std::endl;
-      std::cout << "Local Time: "  << format_timestamp(data.timestamp)  << std::endl;
+    char local_time[TimestampFormatter::BUFFER_SIZE];
+    format_timestamp(data.timestamp, local_time, sizeof(local_time));
+    std::cout << "Local Time: "  << local_time  << std::endl;
     std::cout << "-----------------" << std::endl;
 }
 
@@ -110,7 +83,9 @@ void PacketParser::print_sensor_data(const SensorData& data) const
     std::cout << "Mode: " << get_mode_string(data.mode) << std::endl;
     std::cout << "Voltage: " << data.voltage << "V" << std::endl;
     std::cout << "Timestamp: " << data.timestamp << std::endl;
-    std::cout << "Local Time: "  << format_timestamp(data.timestamp)  << std::endl;
+    char local_time[TimestampFormatter::BUFFER_SIZE];
+    format_timestamp(data.timestamp, local_time, sizeof(local_time));
+    std::cout << "Local Time: "  << local_time  << std::endl;
     std::cout << "-----------------" << std::endl;
 }
 
@@ -118,16 +93,21 @@ void PacketParser::print_event(const EventData& data) const
 {
     std::cout << "Event: " << get_event_string(data.event) << std::endl;
     std::cout << "Timestamp: " << data.timestamp << std::endl;
-    std::cout << "Local Time: "  << format_timestamp(data.timestamp)  << std::endl;
+    char local_time[TimestampFormatter::BUFFER_SIZE];
+    format_timestamp(data.timestamp, local_time, sizeof(local_time));
+    std::cout << "Local Time: "  << local_time  << std::endl;
     std::cout << "-----------------" << std::endl;
 }
 
 std::string PacketParser::format_timestamp(time_t timestamp) const
 {
-    struct tm* timeinfo = localtime(&timestamp);
-    char buffer[80];
-    strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S %Z", timeinfo);
-    return std::string(buffer);
+    char buffer[TimestampFormatter::BUFFER_SIZE];
+    return std::string(buffer, format_timestamp(timestamp, buffer, sizeof(buffer)));
+}
+
+size_t PacketParser::format_timestamp(time_t timestamp, char* out, size_t size) const
+{
+    return TimestampFormatter::format(timestamp, out, size);
 }
 
 std::string PacketParser::get_mode_string(AltairModes mode) const 
@@ -181,10 +161,10 @@ MessagePacket PacketParser::create_message_packet(ResponseType type, uint8_t res
     return packet;
 }
 
-bool PacketParser::is_valid_response(const std::vector<uint8_t>& response) const 
+bool PacketParser::is_valid_response(const PacketView& response) const 
 {
     // Basic validation checks
-    if (response.empty()) {
+    if (response.size() == 0) {
         return false;
     }
     
@@ -194,12 +174,12 @@ bool PacketParser::is_valid_response(const std::vector<uint8_t>& response) const
     }
     
     // Check if the last byte is the end mark
-    if (response.back() != END_MARK) {
+    if (response[response.size() - 1] != END_MARK) {
         return false;
     }
     
     // Check if the data length matches
-    if (response.size() != response[0]) {
+    if (response.size() != response.length()) {
         return false;
     }
     
@@ -0,0 +1,555 @@
+#include "sensor_block_codec.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <utility>
+
+namespace altair {
+
+namespace {
+
+// Zero bytes after the last column, so unpacking may load 8 bytes anywhere in a frame
+constexpr size_t BLOCK_PADDING = 8;
+
+// Flag in the width byte of a frame written as bitmap plus non-zero values
+constexpr unsigned SPARSE_FRAME = 0x80;
+
+// Full frames of narrow values are packed into LANES interleaved 32-bit streams
+constexpr size_t LANES = 4;
+constexpr size_t ROWS = SensorBlockCodec::FRAME_SIZE / LANES;
+constexpr unsigned MAX_VERTICAL_WIDTH = 32;
+
+template<typename T>
+T load(const uint8_t* in)
+{
+    T value;
+    std::memcpy(&value, in, sizeof(value));
+    return value;
+}
+
+template<typename T>
+void store(std::vector<uint8_t>& out, T value)
+{
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(value));
+}
+
+uint64_t zigzag(int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value)
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+unsigned bit_width(uint64_t value)
+{
+    return value == 0 ? 0 : 64 - static_cast<unsigned>(__builtin_clzll(value));
+}
+
+/**
+ * @brief Packs values of a fixed bit width, least significant bit first
+ */
+void pack(const uint64_t* values, size_t count, unsigned width, std::vector<uint8_t>& out)
+{
+    uint64_t bits = 0;
+    unsigned used = 0;
+    for (size_t i = 0; i < count; ++i) {
+        // At most 7 bits are pending, and widths stay below 58 bits
+        bits |= values[i] << used;
+        used += width;
+        while (used >= 8) {
+            out.push_back(static_cast<uint8_t>(bits));
+            bits >>= 8;
+            used -= 8;
+        }
+    }
+    if (used > 0) {
+        out.push_back(static_cast<uint8_t>(bits));
+    }
+}
+
+/**
+ * @brief Unpacks values of a fixed bit width
+ * @return Position after the packed values
+ */
+const uint8_t* unpack(const uint8_t* in, size_t count, unsigned width, uint64_t* values)
+{
+    if (width == 0) {
+        std::fill(values, values + count, 0);
+        return in;
+    }
+
+    const uint64_t mask = ~uint64_t(0) >> (64 - width);
+    for (size_t i = 0; i < count; ++i) {
+        size_t bit = i * width;
+        values[i] = (load<uint64_t>(in + bit / 8) >> (bit % 8)) & mask;
+    }
+    return in + (count * width + 7) / 8;
+}
+
+/**
+ * @brief Whether a dense frame is packed vertically
+ *
+ * Only frames missing at most part of their last row are, so the padding
+ * costs a few bits; the short frame at the end of a block and values wider
+ * than a lane are packed with pack().
+ */
+bool vertical(size_t count, unsigned width)
+{
+    return width != 0 && width <= MAX_VERTICAL_WIDTH && count + LANES > SensorBlockCodec::FRAME_SIZE;
+}
+
+/**
+ * @brief Packs up to FRAME_SIZE values into LANES streams of 32-bit words
+ *
+ * Value i goes to lane i % LANES, row i / LANES, and word k of a lane is
+ * stored at k * LANES + lane. Every row then sits at the same bit offset in
+ * all lanes, so unpack_vertical() shifts the lanes together. A frame takes
+ * width * LANES words.
+ */
+void pack_vertical(const uint64_t* values, size_t count, unsigned width, std::vector<uint8_t>& out)
+{
+    uint32_t words[ROWS * LANES] = {};
+    for (size_t i = 0; i < count; ++i) {
+        size_t bit = (i / LANES) * width;
+        size_t word = bit / 32 * LANES + i % LANES;
+        unsigned offset = bit % 32;
+        uint32_t value = static_cast<uint32_t>(values[i]);
+
+        words[word] |= value << offset;
+        if (offset + width > 32) {
+            words[word + LANES] |= value >> (32 - offset);
+        }
+    }
+    for (size_t i = 0; i < width * LANES; ++i) {
+        store<uint32_t>(out, words[i]);
+    }
+}
+
+/**
+ * @brief Unpacks a frame written by pack_vertical(), for one bit width
+ *
+ * The row loop is unrolled, which turns every offset into a constant, and
+ * the LANES lanes of a row take the same shifts, so the compiler turns each
+ * row into a few 128-bit operations, without needing more than SSE2.
+ */
+template<unsigned Width>
+void unpack_vertical(const uint8_t* in, unsigned shift, uint64_t* values)
+{
+    constexpr uint32_t mask = ~uint32_t(0) >> (32 - Width);
+
+    uint32_t current[LANES];
+    for (size_t lane = 0; lane < LANES; ++lane) {
+        current[lane] = load<uint32_t>(in + lane * 4);
+    }
+    in += LANES * 4;
+
+    unsigned used = 0;
+#pragma GCC unroll 32
+    for (size_t row = 0; row < ROWS; ++row) {
+        if (used + Width <= 32) {
+            for (size_t lane = 0; lane < LANES; ++lane) {
+                values[row * LANES + lane] = static_cast<uint64_t>((current[lane] >> used) & mask) << shift;
+            }
+            used += Width;
+            if (used == 32 && row + 1 < ROWS) {
+                for (size_t lane = 0; lane < LANES; ++lane) {
+                    current[lane] = load<uint32_t>(in + lane * 4);
+                }
+                in += LANES * 4;
+                used = 0;
+            }
+        } else {
+            // The value continues in the next word of its lane
+            uint32_t next[LANES];
+            for (size_t lane = 0; lane < LANES; ++lane) {
+                next[lane] = load<uint32_t>(in + lane * 4);
+            }
+            for (size_t lane = 0; lane < LANES; ++lane) {
+                uint32_t value = ((current[lane] >> used) | (next[lane] << (32 - used))) & mask;
+                values[row * LANES + lane] = static_cast<uint64_t>(value) << shift;
+            }
+            std::memcpy(current, next, sizeof(current));
+            in += LANES * 4;
+            used += Width - 32;
+        }
+    }
+}
+
+using VerticalKernel = void (*)(const uint8_t*, unsigned, uint64_t*);
+
+template<size_t... Widths>
+constexpr std::array<VerticalKernel, sizeof...(Widths)> make_vertical_kernels(std::index_sequence<Widths...>)
+{
+    return { unpack_vertical<static_cast<unsigned>(Widths + 1)>... };
+}
+
+// Kernel for width w at index w - 1
+constexpr auto VERTICAL_KERNELS = make_vertical_kernels(std::make_index_sequence<MAX_VERTICAL_WIDTH>());
+
+/**
+ * @brief Writes up to FRAME_SIZE values as [shift u8][width u8][packed values >> shift]
+ *
+ * Bits below the lowest bit set in any value of the frame are dropped,
+ * which matters for XORed floats: consecutive values mostly share sign,
+ * exponent and low mantissa bits. A frame mostly of zeros is written
+ * sparse instead, flagged in the width byte: a bitmap of the non-zero
+ * values followed by just those values, packed.
+ */
+void put_frame(const uint64_t* values, size_t count, std::vector<uint8_t>& out)
+{
+    uint64_t any = 0;
+    size_t nonzero = 0;
+    for (size_t i = 0; i < count; ++i) {
+        any |= values[i];
+        nonzero += values[i] != 0;
+    }
+    unsigned shift = any == 0 ? 0 : static_cast<unsigned>(__builtin_ctzll(any));
+    unsigned width = bit_width(any >> shift);
+    bool sparse = count + nonzero * width < count * width;
+
+    out.push_back(static_cast<uint8_t>(shift));
+    out.push_back(static_cast<uint8_t>(width | (sparse ? SPARSE_FRAME : 0)));
+
+    uint64_t packed[SensorBlockCodec::FRAME_SIZE];
+    size_t packed_count = 0;
+    if (sparse) {
+        size_t bitmap = out.size();
+        out.insert(out.end(), (count + 7) / 8, 0);
+        for (size_t i = 0; i < count; ++i) {
+            if (values[i] != 0) {
+                out[bitmap + i / 8] |= static_cast<uint8_t>(1u << (i % 8));
+                packed[packed_count++] = values[i] >> shift;
+            }
+        }
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            packed[packed_count++] = values[i] >> shift;
+        }
+        if (vertical(count, width)) {
+            pack_vertical(packed, packed_count, width, out);
+            return;
+        }
+    }
+    pack(packed, packed_count, width, out);
+}
+
+/**
+ * @brief Reads a frame written by put_frame()
+ * @param values Receives the values; must have room for FRAME_SIZE, as vertical frames are unpacked whole
+ * @return Position after the frame
+ */
+const uint8_t* get_frame(const uint8_t* in, size_t count, uint64_t* values)
+{
+    unsigned shift = in[0];
+    unsigned width = in[1] & ~SPARSE_FRAME;
+    bool sparse = (in[1] & SPARSE_FRAME) != 0;
+    in += 2;
+
+    if (!sparse && vertical(count, width)) {
+        VERTICAL_KERNELS[width - 1](in, shift, values);
+        return in + width * LANES * 4;
+    }
+    if (!sparse) {
+        in = unpack(in, count, width, values);
+        if (shift != 0) {
+            for (size_t i = 0; i < count; ++i) {
+                values[i] <<= shift;
+            }
+        }
+        return in;
+    }
+
+    const uint8_t* bitmap = in;
+    size_t bitmap_size = (count + 7) / 8;
+    size_t nonzero = 0;
+    for (size_t i = 0; i < bitmap_size; ++i) {
+        nonzero += static_cast<size_t>(__builtin_popcount(bitmap[i]));
+    }
+    uint64_t packed[SensorBlockCodec::FRAME_SIZE];
+    in = unpack(in + bitmap_size, nonzero, width, packed);
+
+    // Zero the frame, then visit only the set bits
+    std::memset(values, 0, count * sizeof(uint64_t));
+    size_t next = 0;
+    for (size_t i = 0; i < bitmap_size; ++i) {
+        for (unsigned bits = bitmap[i]; bits != 0; bits &= bits - 1) {
+            values[i * 8 + static_cast<size_t>(__builtin_ctz(bits))] = packed[next++] << shift;
+        }
+    }
+    return in;
+}
+
+/**
+ * @brief Steps over a frame written by put_frame()
+ * @return Position after the frame
+ */
+const uint8_t* skip_frame(const uint8_t* in, size_t count)
+{
+    size_t width = in[1] & ~SPARSE_FRAME;
+    bool sparse = (in[1] & SPARSE_FRAME) != 0;
+    in += 2;
+
+    if (sparse) {
+        size_t bitmap_size = (count + 7) / 8;
+        size_t nonzero = 0;
+        for (size_t i = 0; i < bitmap_size; ++i) {
+            nonzero += static_cast<size_t>(__builtin_popcount(in[i]));
+        }
+        return in + bitmap_size + (nonzero * width + 7) / 8;
+    }
+    if (vertical(count, static_cast<unsigned>(width))) {
+        return in + width * LANES * 4;
+    }
+    return in + (count * width + 7) / 8;
+}
+
+/**
+ * @brief Writes a field in chunks of FRAME_SIZE records: [first value][frame of differences to the previous record]
+ *
+ * The first value of every chunk lets a range be decoded from the chunk
+ * holding its first record instead of from the start of the block.
+ */
+template<typename T, typename Field, typename Difference>
+void put_column(const SensorData* records, size_t count, Field field, Difference difference,
+                std::vector<uint8_t>& out)
+{
+    uint64_t values[SensorBlockCodec::FRAME_SIZE];
+    for (size_t first = 0; first < count; first += SensorBlockCodec::FRAME_SIZE) {
+        size_t last = std::min(first + SensorBlockCodec::FRAME_SIZE, count);
+        store<T>(out, field(records[first]));
+        for (size_t i = first + 1; i < last; ++i) {
+            values[i - first - 1] = difference(field(records[i]), field(records[i - 1]));
+        }
+        put_frame(values, last - first - 1, out);
+    }
+}
+
+/**
+ * @brief Reads the records from begin to end of a column written by put_column()
+ * @return Position after the column
+ */
+template<typename T, typename Restore>
+const uint8_t* get_column(const uint8_t* in, size_t count, size_t begin, size_t end, Restore restore, T* column)
+{
+    uint64_t values[SensorBlockCodec::FRAME_SIZE];
+    for (size_t first = 0; first < count; first += SensorBlockCodec::FRAME_SIZE) {
+        size_t last = std::min(first + SensorBlockCodec::FRAME_SIZE, count);
+        T value = load<T>(in);
+        in += sizeof(T);
+        if (last <= begin || first >= end) {
+            in = skip_frame(in, last - first - 1);
+            continue;
+        }
+
+        in = get_frame(in, last - first - 1, values);
+        column[first] = value;
+        for (size_t i = first + 1; i < last; ++i) {
+            column[i] = restore(column[i - 1], values[i - first - 1]);
+        }
+    }
+    return in;
+}
+
+uint64_t byte_difference(uint8_t value, uint8_t previous)
+{
+    return zigzag(static_cast<int64_t>(value) - previous);
+}
+
+uint8_t byte_restore(uint8_t previous, uint64_t difference)
+{
+    return static_cast<uint8_t>(previous + unzigzag(difference));
+}
+
+uint64_t bits_difference(uint32_t value, uint32_t previous)
+{
+    return value ^ previous;
+}
+
+uint32_t bits_restore(uint32_t previous, uint64_t difference)
+{
+    return previous ^ static_cast<uint32_t>(difference);
+}
+
+uint32_t voltage_bits(const SensorData& data)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &data.voltage, sizeof(bits));
+    return bits;
+}
+
+/**
+ * @brief Decoded columns of one block
+ */
+struct Columns
+{
+    std::vector<uint64_t> scratch;
+    std::vector<uint32_t> timestamp;
+    std::vector<uint8_t> mode;
+    std::vector<uint8_t> temp;
+    std::vector<uint8_t> humid;
+    std::vector<uint8_t> light;
+    std::vector<uint32_t> voltage;
+};
+
+/**
+ * @brief Decodes the timestamp column of a block
+ * @return Position after the column
+ */
+const uint8_t* decode_timestamps(const uint8_t* in, size_t count, Columns& columns)
+{
+    // Slack for the last frame, which may be unpacked whole
+    columns.scratch.resize(count + SensorBlockCodec::FRAME_SIZE);
+    columns.timestamp.resize(count);
+
+    uint32_t* timestamp = columns.timestamp.data();
+    timestamp[0] = load<uint32_t>(in);
+    uint32_t delta = load<uint32_t>(in + 4);
+    in += 8;
+    if (count < 2) {
+        return in;
+    }
+
+    timestamp[1] = timestamp[0] + delta;
+    for (size_t first = 0; first < count - 2; first += SensorBlockCodec::FRAME_SIZE) {
+        in = get_frame(in, std::min(SensorBlockCodec::FRAME_SIZE, count - 2 - first), columns.scratch.data() + first);
+    }
+    for (size_t i = 2; i < count; ++i) {
+        delta = static_cast<uint32_t>(delta + unzigzag(columns.scratch[i - 2]));
+        timestamp[i] = timestamp[i - 1] + delta;
+    }
+    return in;
+}
+
+/**
+ * @brief Decodes the columns following the timestamps, for the records from begin to end
+ */
+void decode_values(const uint8_t* in, size_t count, size_t begin, size_t end, Columns& columns)
+{
+    columns.mode.resize(count);
+    columns.temp.resize(count);
+    columns.humid.resize(count);
+    columns.light.resize(count);
+    columns.voltage.resize(count);
+
+    uint16_t runs = load<uint16_t>(in);
+    in += 2;
+    size_t first = 0;
+    for (uint16_t run = 0; run < runs; ++run) {
+        uint8_t mode = in[0];
+        size_t last = first + load<uint16_t>(in + 1);
+        in += 3;
+        if (last > begin && first < end) {
+            std::fill(columns.mode.begin() + std::max(first, begin), columns.mode.begin() + std::min(last, end), mode);
+        }
+        first = last;
+    }
+
+    in = get_column(in, count, begin, end, byte_restore, columns.temp.data());
+    in = get_column(in, count, begin, end, byte_restore, columns.humid.data());
+    in = get_column(in, count, begin, end, byte_restore, columns.light.data());
+    get_column(in, count, begin, end, bits_restore, columns.voltage.data());
+}
+
+} // namespace
+
+void SensorBlockCodec::encode(const SensorData* records, size_t count, std::vector<uint8_t>& out)
+{
+    out.clear();
+    store<uint16_t>(out, static_cast<uint16_t>(count));
+    if (count == 0) {
+        out.insert(out.end(), BLOCK_PADDING, 0);
+        return;
+    }
+
+    thread_local std::vector<uint64_t> values;
+    values.clear();
+
+    // Timestamps: first value, first delta, then the change of the delta
+    uint32_t delta = count > 1 ? records[1].timestamp - records[0].timestamp : 0;
+    store<uint32_t>(out, records[0].timestamp);
+    store<uint32_t>(out, delta);
+    for (size_t i = 2; i < count; ++i) {
+        uint32_t next = records[i].timestamp - records[i - 1].timestamp;
+        values.push_back(zigzag(static_cast<int64_t>(next) - static_cast<int64_t>(delta)));
+        delta = next;
+    }
+    for (size_t first = 0; first < values.size(); first += FRAME_SIZE) {
+        put_frame(values.data() + first, std::min(FRAME_SIZE, values.size() - first), out);
+    }
+
+    // Mode: runs of one value
+    size_t runs_offset = out.size();
+    store<uint16_t>(out, 0);
+    uint16_t runs = 0;
+    for (size_t first = 0; first < count;) {
+        size_t last = first + 1;
+        while (last < count && records[last].mode == records[first].mode) {
+            ++last;
+        }
+        out.push_back(static_cast<uint8_t>(records[first].mode));
+        store<uint16_t>(out, static_cast<uint16_t>(last - first));
+        ++runs;
+        first = last;
+    }
+    std::memcpy(out.data() + runs_offset, &runs, sizeof(runs));
+
+    // Readings: zigzag deltas, voltage as the XOR of the float bits with the previous value
+    put_column<uint8_t>(records, count, [](const SensorData& data) { return data.temp; }, byte_difference, out);
+    put_column<uint8_t>(records, count, [](const SensorData& data) { return data.humid; }, byte_difference, out);
+    put_column<uint8_t>(records, count, [](const SensorData& data) { return data.light; }, byte_difference, out);
+    put_column<uint32_t>(records, count, voltage_bits, bits_difference, out);
+
+    out.insert(out.end(), BLOCK_PADDING, 0);
+}
+
+void SensorBlockCodec::decode_range(const std::vector<uint8_t>& block, uint32_t start_time, uint32_t end_time,
+                                    std::vector<SensorData>& result)
+{
+    decode_range(block.data(), start_time, end_time, result);
+}
+
+void SensorBlockCodec::decode_range(const uint8_t* block, uint32_t start_time, uint32_t end_time,
+                                    std::vector<SensorData>& result)
+{
+    const uint8_t* in = block;
+    size_t total = load<uint16_t>(in);
+    in += 2;
+    if (total == 0 || start_time > end_time) {
+        return;
+    }
+
+    thread_local Columns columns;
+    in = decode_timestamps(in, total, columns);
+
+    // Only the timestamps are needed to find the range, the other columns skip the chunks outside it
+    auto begin = columns.timestamp.begin();
+    size_t low = static_cast<size_t>(std::lower_bound(begin, begin + total, start_time) - begin);
+    size_t high = static_cast<size_t>(std::upper_bound(begin, begin + total, end_time) - begin);
+    if (low >= high) {
+        return;
+    }
+    decode_values(in, total, low, high, columns);
+
+    size_t offset = result.size();
+    result.resize(offset + (high - low));
+    SensorData* out = result.data() + offset;
+    for (size_t i = low; i < high; ++i, ++out) {
+        out->timestamp = columns.timestamp[i];
+        out->temp = columns.temp[i];
+        out->humid = columns.humid[i];
+        out->light = columns.light[i];
+        out->mode = static_cast<AltairModes>(columns.mode[i]);
+        std::memcpy(&out->voltage, &columns.voltage[i], sizeof(out->voltage));
+    }
+}
+
+void SensorBlockCodec::decode(const std::vector<uint8_t>& block, std::vector<SensorData>& result)
+{
+    decode_range(block, 0, UINT32_MAX, result);
+}
+
+} // namespace altair
@@ -0,0 +1,105 @@
+#include "sensor_rollups.hpp"
+#include <algorithm>
+#include <iterator>
+
+namespace altair {
+
+void SensorStats::add(const SensorData& data)
+{
+    bool first = count == 0;
+    temp.add(data.temp, first);
+    humid.add(data.humid, first);
+    light.add(data.light, first);
+    voltage.add(data.voltage, first);
+
+    size_t mode = static_cast<size_t>(data.mode);
+    ++modes[mode < MODE_SLOTS ? mode : 0];
+    ++count;
+}
+
+void SensorStats::merge(const SensorStats& other)
+{
+    if (other.count == 0) {
+        return;
+    }
+
+    bool first = count == 0;
+    temp.merge(other.temp, first);
+    humid.merge(other.humid, first);
+    light.merge(other.light, first);
+    voltage.merge(other.voltage, first);
+
+    for (size_t mode = 0; mode < MODE_SLOTS; ++mode) {
+        modes[mode] += other.modes[mode];
+    }
+    count += other.count;
+}
+
+void SensorRollups::add(const SensorData& data)
+{
+    for (size_t level = 0; level < LEVEL_WIDTHS.size(); ++level) {
+        Buckets& buckets = m_levels[level];
+        uint32_t width = LEVEL_WIDTHS[level];
+        uint32_t start = data.timestamp - data.timestamp % width;
+
+        // Records mostly arrive in order and land in the newest bucket, the hint makes that constant time
+        auto pos = buckets.empty() || buckets.rbegin()->first != start ? buckets.lower_bound(start)
+                                                                       : std::prev(buckets.end());
+        if (pos == buckets.end() || pos->first != start) {
+            SensorStats bucket;
+            bucket.start_time = start;
+            bucket.end_time = static_cast<uint32_t>(std::min<uint64_t>(uint64_t(start) + width - 1, UINT32_MAX));
+            pos = buckets.emplace_hint(pos, start, bucket);
+        }
+        pos->second.add(data);
+    }
+}
+
+void SensorRollups::clear()
+{
+    for (auto& buckets : m_levels) {
+        buckets.clear();
+    }
+}
+
+void SensorRollups::aggregate(uint32_t start_time, uint32_t end_time, const RecordSource& records,
+                              SensorStats& stats) const
+{
+    if (start_time > end_time) {
+        return;
+    }
+    aggregate_level(0, start_time, uint64_t(end_time) + 1, records, stats);
+}
+
+void SensorRollups::aggregate_level(size_t level, uint64_t start, uint64_t end, const RecordSource& records,
+                                    SensorStats& stats) const
+{
+    if (start >= end) {
+        return;
+    }
+
+    for (; level < LEVEL_WIDTHS.size(); ++level) {
+        uint64_t width = LEVEL_WIDTHS[level];
+        uint64_t first = (start + width - 1) / width * width;
+        uint64_t last = end / width * width;
+        if (first >= last) {
+            // No whole bucket of this width fits, try a finer one
+            continue;
+        }
+
+        // Whole buckets from this level, the edges from finer levels
+        const Buckets& buckets = m_levels[level];
+        auto pos = buckets.lower_bound(static_cast<uint32_t>(first));
+        for (; pos != buckets.end() && pos->first < last; ++pos) {
+            stats.merge(pos->second);
+        }
+
+        aggregate_level(level + 1, start, first, records, stats);
+        aggregate_level(level + 1, last, end, records, stats);
+        return;
+    }
+
+    records(static_cast<uint32_t>(start), static_cast<uint32_t>(end - 1), stats);
+}
+
+} // namespace altair
@@ -0,0 +1,341 @@
+#include "sensor_segment.hpp"
+#include "packet_codec.hpp"
+#include "sensor_block_codec.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace altair {
+
+namespace {
+
+constexpr char SEGMENT_MAGIC[8] = { 'A', 'L', 'T', 'S', 'E', 'G', '0', '1' };
+constexpr char INDEX_MAGIC[4]   = { 'S', 'I', 'D', 'X' };
+constexpr uint32_t RECORDS_VERSION = 1;
+constexpr uint32_t FORMAT_VERSION = 2;
+
+// [magic 8][version 4][block records 4, record size in version 1][record count 8][min 4][max 4]
+constexpr size_t SEGMENT_HEADER_SIZE = 32;
+// [first timestamp 4][last timestamp 4][offset 8]
+constexpr size_t BLOCK_INDEX_ENTRY_SIZE = 16;
+// [index offset 8][index count 4][magic 4]
+constexpr size_t SEGMENT_FOOTER_SIZE = 16;
+
+template<typename T>
+T load(const uint8_t* in)
+{
+    T value;
+    std::memcpy(&value, in, sizeof(value));
+    return value;
+}
+
+template<typename T>
+void store(std::vector<uint8_t>& out, T value)
+{
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(value));
+}
+
+bool write_all(int fd, const uint8_t* data, size_t size, off_t offset)
+{
+    while (size > 0) {
+        ssize_t written = pwrite(fd, data, size, offset);
+        if (written < 0) {
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+        offset += written;
+    }
+    return true;
+}
+
+bool sync_directory(const std::string& path)
+{
+    size_t slash = path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+
+    int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    bool synced = fsync(fd) == 0;
+    close(fd);
+    return synced;
+}
+
+} // namespace
+
+bool SensorSegment::write(const std::string& path, const std::vector<SensorData>& records)
+{
+    std::vector<uint8_t> file;
+    size_t index_count = (records.size() + BLOCK_RECORDS - 1) / BLOCK_RECORDS;
+
+    file.insert(file.end(), SEGMENT_MAGIC, SEGMENT_MAGIC + sizeof(SEGMENT_MAGIC));
+    store<uint32_t>(file, FORMAT_VERSION);
+    store<uint32_t>(file, BLOCK_RECORDS);
+    store<uint64_t>(file, records.size());
+    store<uint32_t>(file, records.empty() ? 0 : records.front().timestamp);
+    store<uint32_t>(file, records.empty() ? 0 : records.back().timestamp);
+
+    std::vector<uint8_t> index;
+    index.reserve(index_count * BLOCK_INDEX_ENTRY_SIZE);
+    std::vector<uint8_t> block;
+    for (size_t first = 0; first < records.size(); first += BLOCK_RECORDS) {
+        size_t count = std::min(BLOCK_RECORDS, records.size() - first);
+        store<uint32_t>(index, records[first].timestamp);
+        store<uint32_t>(index, records[first + count - 1].timestamp);
+        store<uint64_t>(index, file.size());
+
+        SensorBlockCodec::encode(records.data() + first, count, block);
+        file.insert(file.end(), block.begin(), block.end());
+    }
+
+    uint64_t index_offset = file.size();
+    file.insert(file.end(), index.begin(), index.end());
+    store<uint64_t>(file, index_offset);
+    store<uint32_t>(file, static_cast<uint32_t>(index_count));
+    file.insert(file.end(), INDEX_MAGIC, INDEX_MAGIC + sizeof(INDEX_MAGIC));
+
+    // Write aside and rename, so a crash never leaves a half written segment under the real name
+    std::string temp_path = path + ".tmp";
+    int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool written = write_all(fd, file.data(), file.size(), 0) && fsync(fd) == 0;
+    close(fd);
+
+    if (!written || rename(temp_path.c_str(), path.c_str()) != 0) {
+        unlink(temp_path.c_str());
+        return false;
+    }
+
+    // The rename only survives a power loss once the directory is synced; the caller's log may be reset after this
+    if (!sync_directory(path)) {
+        unlink(path.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<SensorSegment> SensorSegment::open(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < SEGMENT_HEADER_SIZE + SEGMENT_FOOTER_SIZE) {
+        close(fd);
+        return nullptr;
+    }
+
+    size_t map_size = static_cast<size_t>(info.st_size);
+    void* map = mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+    if (map == MAP_FAILED) {
+        return nullptr;
+    }
+
+    std::unique_ptr<SensorSegment> segment(new SensorSegment(path, static_cast<const uint8_t*>(map), map_size));
+    if (!segment->validate()) {
+        return nullptr;
+    }
+    return segment;
+}
+
+bool SensorSegment::validate()
+{
+    const uint8_t* header = m_map;
+    const uint8_t* footer = m_map + m_map_size - SEGMENT_FOOTER_SIZE;
+    uint32_t version = load<uint32_t>(header + 8);
+    uint64_t count = load<uint64_t>(header + 16);
+    uint64_t index_offset = load<uint64_t>(footer);
+    uint32_t index_count = load<uint32_t>(footer + 8);
+
+    if (std::memcmp(header, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) != 0 ||
+        std::memcmp(footer + 12, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0) {
+        return false;
+    }
+
+    if (version == RECORDS_VERSION) {
+        if (load<uint32_t>(header + 12) != SENSOR_RECORD_SIZE ||
+            index_offset != SEGMENT_HEADER_SIZE + count * SENSOR_RECORD_SIZE ||
+            index_count != (count + INDEX_STRIDE - 1) / INDEX_STRIDE ||
+            index_offset + index_count * 4 + SEGMENT_FOOTER_SIZE != m_map_size) {
+            return false;
+        }
+        m_records = m_map + SEGMENT_HEADER_SIZE;
+    } else if (version == FORMAT_VERSION) {
+        if (load<uint32_t>(header + 12) != BLOCK_RECORDS ||
+            index_count != (count + BLOCK_RECORDS - 1) / BLOCK_RECORDS ||
+            index_offset + index_count * BLOCK_INDEX_ENTRY_SIZE + SEGMENT_FOOTER_SIZE != m_map_size) {
+            return false;
+        }
+        // Blocks are decoded straight from the mapping, so each must lie before the index
+        const uint8_t* index = m_map + index_offset;
+        uint64_t previous = SEGMENT_HEADER_SIZE;
+        for (uint32_t block = 0; block < index_count; ++block) {
+            uint64_t offset = load<uint64_t>(index + block * BLOCK_INDEX_ENTRY_SIZE + 8);
+            if (offset < previous || offset >= index_offset) {
+                return false;
+            }
+            previous = offset + 1;
+        }
+    } else {
+        return false;
+    }
+
+    m_version = version;
+    m_count = static_cast<size_t>(count);
+    m_index = m_map + index_offset;
+    m_index_count = index_count;
+    m_min_timestamp = load<uint32_t>(header + 24);
+    m_max_timestamp = load<uint32_t>(header + 28);
+    return true;
+}
+
+SensorSegment::SensorSegment(std::string path, const uint8_t* map, size_t map_size):
+m_path(std::move(path)),
+m_map(map),
+m_map_size(map_size),
+m_version(0),
+m_records(nullptr),
+m_count(0),
+m_index(nullptr),
+m_index_count(0),
+m_min_timestamp(0),
+m_max_timestamp(0)
+{
+}
+
+SensorSegment::~SensorSegment()
+{
+    munmap(const_cast<uint8_t*>(m_map), m_map_size);
+}
+
+bool SensorSegment::find(uint32_t timestamp, SensorData& data) const
+{
+    if (m_count == 0 || timestamp < m_min_timestamp || timestamp > m_max_timestamp) {
+        return false;
+    }
+
+    if (m_version == FORMAT_VERSION) {
+        size_t block = block_for(timestamp);
+        if (block == m_index_count || block_first(block) > timestamp) {
+            return false;
+        }
+
+        thread_local std::vector<SensorData> decoded;
+        decoded.clear();
+        SensorBlockCodec::decode_range(m_map + block_offset(block), timestamp, timestamp, decoded);
+        if (decoded.empty()) {
+            return false;
+        }
+        data = decoded.front();
+        return true;
+    }
+
+    size_t index = lower_bound(timestamp);
+    if (index == m_count || timestamp_at(index) != timestamp) {
+        return false;
+    }
+    PacketCodec::decode(m_records + index * SENSOR_RECORD_SIZE, data);
+    return true;
+}
+
+void SensorSegment::append_range(uint32_t start_time, uint32_t end_time, std::vector<SensorData>& result) const
+{
+    if (m_count == 0 || start_time > m_max_timestamp || end_time < m_min_timestamp) {
+        return;
+    }
+
+    if (m_version == FORMAT_VERSION) {
+        // Only the blocks overlapping the range are decoded, each only for the records in it
+        for (size_t block = block_for(start_time); block < m_index_count && block_first(block) <= end_time; ++block) {
+            SensorBlockCodec::decode_range(m_map + block_offset(block), start_time, end_time, result);
+        }
+        return;
+    }
+
+    for (size_t index = lower_bound(start_time); index < m_count; ++index) {
+        const uint8_t* record = m_records + index * SENSOR_RECORD_SIZE;
+        if (schema::SensorRecord::timestamp::get(record) > end_time) {
+            break;
+        }
+        SensorData data;
+        PacketCodec::decode(record, data);
+        result.push_back(data);
+    }
+}
+
+size_t SensorSegment::block_for(uint32_t timestamp) const
+{
+    size_t low = 0;
+    size_t high = m_index_count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (block_last(middle) < timestamp) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+uint32_t SensorSegment::block_first(size_t block) const
+{
+    return load<uint32_t>(m_index + block * BLOCK_INDEX_ENTRY_SIZE);
+}
+
+uint32_t SensorSegment::block_last(size_t block) const
+{
+    return load<uint32_t>(m_index + block * BLOCK_INDEX_ENTRY_SIZE + 4);
+}
+
+uint64_t SensorSegment::block_offset(size_t block) const
+{
+    return load<uint64_t>(m_index + block * BLOCK_INDEX_ENTRY_SIZE + 8);
+}
+
+size_t SensorSegment::lower_bound(uint32_t timestamp) const
+{
+    // Narrow the search to one stride with the footer index
+    size_t low = 0;
+    size_t high = m_index_count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (load<uint32_t>(m_index + middle * 4) < timestamp) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    // Entry low - 1 is the last one older than the timestamp, the answer lies in its stride
+    size_t first = low == 0 ? 0 : (low - 1) * INDEX_STRIDE;
+    size_t last = std::min(m_count, low * INDEX_STRIDE);
+    while (first < last) {
+        size_t middle = first + (last - first) / 2;
+        if (timestamp_at(middle) < timestamp) {
+            first = middle + 1;
+        } else {
+            last = middle;
+        }
+    }
+    return first;
+}
+
+uint32_t SensorSegment::timestamp_at(size_t index) const
+{
+    return schema::SensorRecord::timestamp::get(m_records + index * SENSOR_RECORD_SIZE);
+}
+
+} // namespace altair
@@ -1,4 +1,5 @@
 #include "serial_connection.hpp"
+#include "logger.hpp"
 
 namespace altair {
 
@@ -7,13 +8,13 @@ m_serial_port{-1}
 {
     m_serial_port = open(port.c_str(), O_RDWR | O_NOCTTY);
     if (m_serial_port == -1) {
-        std::cout << "Error opening serial port: " << strerror(errno) << std::endl;
+        Logger::getInstance().log(LogLevel::ERROR, "Error opening serial port: ", strerror(errno));
     } else {
         //std::cout << "Sucess: " << m_serial_port << std::endl;
         // Configure serial settings
         struct termios tty;
         if (tcgetattr(m_serial_port, &tty) != 0) {
-            std::cout << "Error getting terminal attributes: " << strerror(errno) << std::endl;
+            Logger::getInstance().log(LogLevel::ERROR, "Error getting terminal attributes: ", strerror(errno));
             close(m_serial_port);
             m_serial_port = -1;
         }
@@ -33,6 +34,7 @@ m_serial_port{-1}
             tty.c_iflag &= ~(IXON | IXOFF | IXANY);  // No software flow control
             tty.c_oflag &= ~OPOST;  // Raw output
             tty.c_cc[VTIME] = 0;  // No timeout
+            tty.c_cc[VMIN] = 1;   // Return as soon as any byte is available
 
             int flags = fcntl(m_serial_port, F_GETFL, 0);
             if (flags & O_NONBLOCK) {
@@ -40,7 +42,7 @@ m_serial_port{-1}
             }
 
             if (tcsetattr(m_serial_port, TCSANOW, &tty) != 0) {
-                std::cout << "Error setting terminal attributes: " << strerror(errno) << std::endl;
+                Logger::getInstance().log(LogLevel::ERROR, "Error setting terminal attributes: ", strerror(errno));
                 close(m_serial_port);
                 m_serial_port = -1;
             }
@@ -81,33 +83,21 @@ bool SerialConnection::is_valid()
     return m_serial_port != -1;
 }
 
-ssize_t SerialConnection:: receive(std::vector<uint8_t>& message, uint8_t size)
+ssize_t SerialConnection:: receive(std::vector<uint8_t>& message, size_t size)
 {
     if (m_serial_port == -1) {
-        return -1;  // Return 0 if the serial port is not valid
+        return -1;  // Return -1 if the serial port is not valid
     }
 
-    message.clear();  
-    char value;
+    // Resizing within the existing capacity keeps repeated reads allocation free
     message.resize(size);
 
     ssize_t bytes_read = 0;
     do {
-        bytes_read  = ::read(m_serial_port, &value, size);
+        bytes_read  = ::read(m_serial_port, message.data(), size);
     }while (bytes_read == -1 && errno == EINTR); 
 
-    if (bytes_read > 0) {
-        message.resize(bytes_read);  
-        message[0] = value;  // Store the read byte in the first position of the vector
-        if(message[0] == 0){
-            //std::cout << "Received 0x00 ;-;" << std::endl;
-        }
-    }
-    else
-    {
-        //print errno
-        //std::cout << "Error reading from serial port: " << strerror(errno) << std::endl;
-    }
+    message.resize(bytes_read > 0 ? bytes_read : 0);
     return bytes_read;  
 }
 ssize_t SerialConnection:: send(const std::vector<uint8_t>& message)
@@ -124,6 +114,12 @@ ssize_t SerialConnection:: send(const std::vector<uint8_t>& message)
     return bytes_written ;
 }
 
+size_t SerialConnection::bytes_per_second() const
+{
+    // 8N1: a start bit, 8 data bits and a stop bit per byte
+    return 115200 / 10;
+}
+
 
 
 
@@ -1,116 +1,720 @@
 #include "server_data_manager.hpp"
+#include "beacon_file.hpp"
+#include "logger.hpp"
+#include "packet_codec.hpp"
+#include "sensor_block_codec.hpp"
 #include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <filesystem>
+#include <limits>
 
 namespace altair {
 
-ServerDataManager::ServerDataManager() 
+namespace {
+
+constexpr std::string_view SEGMENT_PREFIX = "sensor-";
+constexpr std::string_view SEGMENT_SUFFIX = ".seg";
+constexpr const char* LOG_NAME = "sensor.wal";
+constexpr const char* BEACON_NAME = "beacon.dat";
+
+// Record types of the history log
+constexpr uint8_t LOG_SENSOR_RECORD = 1;
+constexpr uint8_t LOG_BEACON = 2;       // Only replayed, beacons now go to the beacon file
+constexpr uint8_t LOG_COVERAGE = 3;
+
+bool earlier(const SensorData& a, const SensorData& b)
 {
-    // Initialize an empty container
-    m_sensor_data.reserve(100); // Pre-allocate space for 100 entries as a starting point
+    return a.timestamp < b.timestamp;
 }
 
-bool ServerDataManager::insertSensorData(const SensorData& data) 
+} // namespace
+
+ServerDataManager::ServerDataManager():
+m_blocks(),
+m_size(0),
+m_directory(),
+m_segments(),
+m_log(),
+m_beacon_file(),
+m_latest_beacon(),
+m_coverage(),
+m_rollups(),
+m_unrolled_segments(0),
+m_sealed_size(0),
+m_sealed_max(0),
+m_next_segment(0)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    
-    // Find the position to insert using binary search
-    auto pos = std::lower_bound(m_sensor_data.begin(), m_sensor_data.end(), data,
-        [](const SensorData& a, const SensorData& b) {
-            return a.timestamp < b.timestamp;
+}
+
+ServerDataManager::ServerDataManager(const std::string& directory, const WriteAheadLogOptions& log_options):
+ServerDataManager()
+{
+    if (directory.empty()) {
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        Logger::getInstance().log(LogLevel::ERROR, "Cannot create history directory ", directory, ": ",
+                                  error.message(), ", keeping history in memory only");
+        return;
+    }
+
+    // Map the sealed segments, named by sequence number
+    std::vector<std::pair<uint64_t, std::string>> sealed;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        std::string name = entry.path().filename().string();
+        if (entry.path().extension() == ".tmp") {
+            // Left over from a seal interrupted before its rename
+            std::filesystem::remove(entry.path(), error);
+            continue;
+        }
+
+        uint64_t sequence = 0;
+        if (name.size() > SEGMENT_PREFIX.size() + SEGMENT_SUFFIX.size() &&
+            name.compare(0, SEGMENT_PREFIX.size(), SEGMENT_PREFIX) == 0 &&
+            name.compare(name.size() - SEGMENT_SUFFIX.size(), SEGMENT_SUFFIX.size(), SEGMENT_SUFFIX) == 0) {
+            const char* first = name.data() + SEGMENT_PREFIX.size();
+            const char* last = name.data() + name.size() - SEGMENT_SUFFIX.size();
+            auto result = std::from_chars(first, last, sequence);
+            if (result.ec == std::errc() && result.ptr == last) {
+                sealed.emplace_back(sequence, entry.path().string());
+            }
+        }
+    }
+    std::sort(sealed.begin(), sealed.end());
+
+    for (const auto& [sequence, path] : sealed) {
+        auto segment = SensorSegment::open(path);
+        if (!segment) {
+            Logger::getInstance().log(LogLevel::WARN, "Skipping unreadable history segment ", path);
+            continue;
+        }
+        m_sealed_size += segment->size();
+        if (segment->size() != 0) {
+            m_sealed_max = std::max(m_sealed_max, segment->max_timestamp());
+        }
+        m_segments.push_back(std::move(segment));
+        m_next_segment = sequence + 1;
+    }
+    // Their rollups are not persisted, they are built on the first statistics query
+    m_unrolled_segments = m_segments.size();
+
+    // Recover what was received after the last seal
+    m_log = WriteAheadLog::open(directory + "/" + LOG_NAME, log_options,
+        [this](uint8_t type, const uint8_t* payload, size_t size) {
+            if (type == LOG_COVERAGE && size == TIME_RANGE_SIZE) {
+                m_coverage.add(schema::TimeRange::start::get(payload), schema::TimeRange::end::get(payload));
+                return;
+            }
+            if (size != SENSOR_RECORD_SIZE) {
+                return;
+            }
+            SensorData data;
+            PacketCodec::decode(payload, data);
+            if (type == LOG_SENSOR_RECORD) {
+                insertLocked(data);
+            } else if (type == LOG_BEACON) {
+                m_latest_beacon = data;
+            }
         });
-    
-    // Check if this is a duplicate (same timestamp)
-    if (pos != m_sensor_data.end() && pos->timestamp == data.timestamp) {
+    if (!m_log) {
+        Logger::getInstance().log(LogLevel::ERROR, "Cannot open the history log in ", directory,
+                                  ", keeping new history in memory only");
+        return;
+    }
+    m_directory = directory;
+    if (m_size >= SEGMENT_CAPACITY) {
+        sealLocked();
+    }
+
+    // The latest beacon is kept apart from the log, which would otherwise grow with every beacon between seals
+    std::optional<SensorData> stored_beacon;
+    m_beacon_file = BeaconFile::open(directory + "/" + BEACON_NAME, stored_beacon);
+    if (!m_beacon_file) {
+        Logger::getInstance().log(LogLevel::ERROR, "Cannot open the beacon file in ", directory,
+                                  ", the latest beacon will not survive a restart");
+    } else if (stored_beacon) {
+        m_latest_beacon = stored_beacon;
+    } else if (m_latest_beacon) {
+        // Recovered from a log written before the beacon file existed
+        m_beacon_file->write(*m_latest_beacon);
+    }
+
+    Logger::getInstance().log(LogLevel::INFO, "Loaded ", m_sealed_size + m_size, " sensor records from ",
+                              m_segments.size(), " sealed segment(s) and the log");
+}
+
+bool ServerDataManager::insertSensorData(const SensorData& data)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!insertLocked(data)) {
         return true;
     }
-    
-    // Insert at the correct position
-    m_sensor_data.insert(pos, data);
+
+    if (logRecord(LOG_SENSOR_RECORD, data) && m_size >= SEGMENT_CAPACITY) {
+        sealLocked();
+    }
     return true;
 }
 
-std::optional<SensorData> ServerDataManager::getSensorDataByTimestamp(uint32_t timestamp) const 
+void ServerDataManager::setLatestBeacon(const SensorData& data)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_latest_beacon = data;
+    if (m_beacon_file && !m_beacon_file->write(data)) {
+        Logger::getInstance().log(LogLevel::ERROR, "Cannot write the beacon file, the latest beacon will not survive a restart");
+        m_beacon_file.reset();
+    }
+}
+
+std::optional<SensorData> ServerDataManager::getLatestBeacon() const
 {
     std::lock_guard<std::mutex> lock(m_mutex);
-    
+    return m_latest_beacon;
+}
 
-    auto pos = std::lower_bound(m_sensor_data.begin(), m_sensor_data.end(), timestamp,
-        [](const SensorData& a, uint32_t timestamp) {
-            return a.timestamp < timestamp;
-        });
-    
-    if (pos != m_sensor_data.end() && pos->timestamp == timestamp) {
-        return *pos;
+void ServerDataManager::markCovered(uint32_t start_time, uint32_t end_time)
+{
+    if (end_time < start_time) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_coverage.covers(start_time, end_time)) {
+        return;
+    }
+    m_coverage.add(start_time, end_time);
+    logCoverage(start_time, end_time);
+}
+
+std::vector<CoverageMap::Interval> ServerDataManager::getMissingIntervals(uint32_t start_time, uint32_t end_time) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_coverage.missing(start_time, end_time);
+}
+
+std::vector<CoverageMap::Interval> ServerDataManager::findGaps(uint32_t start_time, uint32_t end_time,
+                                                              uint32_t sample_interval, size_t max_gaps)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::vector<CoverageMap::Interval> gaps;
+    std::vector<CoverageMap::Interval> complete;
+    std::vector<SensorData> records;
+    for (const auto& [from, to] : m_coverage.missing(start_time, end_time)) {
+        records.clear();
+        collectRangeLocked(from, to, records);
+
+        // The edge of the interval counts as a record in normal mode, so a gap there is found the same way
+        uint64_t previous = from;
+        uint64_t complete_from = from;
+        uint64_t allowed = uint64_t(sample_interval) + 1;
+        bool previous_is_record = false;
+        auto add_gap = [&](uint64_t next) {
+            uint64_t first = previous_is_record ? previous + 1 : previous;
+            if (next - previous > allowed && first < next) {
+                if (first > complete_from) {
+                    complete.emplace_back(static_cast<uint32_t>(complete_from), static_cast<uint32_t>(first - 1));
+                }
+                gaps.emplace_back(static_cast<uint32_t>(first), static_cast<uint32_t>(next - 1));
+                complete_from = next;
+            }
+        };
+
+        bool searched = true;
+        for (const SensorData& record : records) {
+            add_gap(record.timestamp);
+            if (gaps.size() >= max_gaps) {
+                searched = false;
+                break;
+            }
+            previous = record.timestamp;
+            previous_is_record = true;
+            allowed = uint64_t(sample_interval) * (record.mode == SAFE_MODE ? 2 : 1) + 1;
+        }
+        if (searched) {
+            add_gap(uint64_t(to) + 1);
+            if (complete_from <= to) {
+                complete.emplace_back(static_cast<uint32_t>(complete_from), to);
+            }
+        }
+        if (gaps.size() >= max_gaps) {
+            break;
+        }
     }
-    
+
+    // Stretches searched without a gap hold every record, they need not be searched again
+    for (const auto& [from, to] : complete) {
+        m_coverage.add(from, to);
+        logCoverage(from, to);
+    }
+    return gaps;
+}
+
+std::optional<SensorData> ServerDataManager::getSensorDataByTimestamp(uint32_t timestamp) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    SensorData data;
+    if (!m_blocks.empty() && findInBlock(*m_blocks[findBlock(timestamp)], timestamp, &data)) {
+        return data;
+    }
+
+    for (const auto& segment : m_segments) {
+        if (segment->find(timestamp, data)) {
+            return data;
+        }
+    }
+
     return std::nullopt;
 }
 
-std::optional<std::vector<SensorData>> ServerDataManager::getSensorDataInRange(uint32_t start_time, uint32_t end_time) const 
+std::optional<std::vector<SensorData>> ServerDataManager::getSensorDataInRange(uint32_t start_time, uint32_t end_time) const
 {
     std::lock_guard<std::mutex> lock(m_mutex);
-    
+
     // Check if the data is empty
-    if (m_sensor_data.empty()) {
+    std::optional<uint32_t> newest = newestTimestamp();
+    if (!newest) {
         return std::nullopt;
     }
-    
+
     // Check if start_time is beyond the latest data timestamp
-    if (start_time > m_sensor_data.back().timestamp) {
+    if (start_time > *newest) {
         return std::nullopt;
     }
-    
+
     std::vector<SensorData> result;
-    
-    // Find the lower bound of the range
-    auto lower = std::lower_bound(m_sensor_data.begin(), m_sensor_data.end(), start_time,
-        [](const SensorData& a, uint32_t timestamp) {
-            return a.timestamp < timestamp;
-        });
-    
-    // Find the upper bound of the range
-    auto upper = std::upper_bound(m_sensor_data.begin(), m_sensor_data.end(), end_time,
-        [](uint32_t timestamp, const SensorData& a) {
-            return timestamp < a.timestamp;
-        });
-    
-    // Copy data in range to result vector
-    result.reserve(std::distance(lower, upper));
-    for (auto it = lower; it != upper; ++it) {
-        result.push_back(*it);
-    }
-    
-    
+    collectRangeLocked(start_time, end_time, result);
     return result;
 }
 
-std::optional<SensorData> ServerDataManager::getMostRecentData() const 
+std::optional<std::vector<SensorStats>> ServerDataManager::getSensorStats(uint32_t start_time, uint32_t end_time,
+                                                                         uint32_t resolution) const
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    
-    if (m_sensor_data.empty()) {
+    if (resolution == 0 || start_time > end_time) {
         return std::nullopt;
     }
-    
-    return m_sensor_data.back();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    loadRollupsLocked();
+
+    // Edges shorter than a minute are aggregated from the records themselves
+    std::vector<SensorData> records;
+    auto from_records = [&](uint32_t start, uint32_t end, SensorStats& stats) {
+        records.clear();
+        collectRangeLocked(start, end, records);
+        for (const auto& record : records) {
+            stats.add(record);
+        }
+    };
+
+    std::vector<SensorStats> result;
+    uint64_t start = start_time;
+    while (start <= end_time) {
+        uint64_t end = std::min<uint64_t>((start / resolution + 1) * resolution - 1, end_time);
+
+        SensorStats stats;
+        stats.start_time = static_cast<uint32_t>(start);
+        stats.end_time = static_cast<uint32_t>(end);
+        m_rollups.aggregate(stats.start_time, stats.end_time, from_records, stats);
+        result.push_back(stats);
+
+        start = end + 1;
+    }
+    return result;
 }
 
-std::vector<SensorData> ServerDataManager::getAllSensorData() const 
+std::optional<SensorData> ServerDataManager::getMostRecentData() const
 {
     std::lock_guard<std::mutex> lock(m_mutex);
-    return m_sensor_data;
+
+    std::optional<uint32_t> newest = newestTimestamp();
+    if (!newest) {
+        return std::nullopt;
+    }
+
+    SensorData data;
+    if (!m_blocks.empty() && m_blocks.back()->max_timestamp == *newest &&
+        findInBlock(*m_blocks.back(), *newest, &data)) {
+        return data;
+    }
+
+    for (const auto& segment : m_segments) {
+        if (segment->max_timestamp() == *newest && segment->find(*newest, data)) {
+            return data;
+        }
+    }
+    return std::nullopt;
 }
 
-size_t ServerDataManager::size() const 
+std::vector<SensorData> ServerDataManager::getAllSensorData() const
+{
+    auto all = getSensorDataInRange(0, std::numeric_limits<uint32_t>::max());
+    return all ? std::move(*all) : std::vector<SensorData>();
+}
+
+size_t ServerDataManager::size() const
 {
     std::lock_guard<std::mutex> lock(m_mutex);
-    return m_sensor_data.size();
+    return m_size + m_sealed_size;
 }
 
-void ServerDataManager::clear() 
+void ServerDataManager::clear()
 {
     std::lock_guard<std::mutex> lock(m_mutex);
-    m_sensor_data.clear();
+    m_blocks.clear();
+    m_size = 0;
+    m_rollups.clear();
+    m_unrolled_segments = 0;
+
+    for (const auto& segment : m_segments) {
+        std::error_code error;
+        std::filesystem::remove(segment->path(), error);
+    }
+    m_segments.clear();
+    m_sealed_size = 0;
+    m_sealed_max = 0;
+
+    m_latest_beacon.reset();
+    if (m_beacon_file && !m_beacon_file->clear()) {
+        Logger::getInstance().log(LogLevel::ERROR, "Cannot clear the beacon file, the latest beacon will not survive a restart");
+        m_beacon_file.reset();
+    }
+    m_coverage.clear();
+    if (m_log && !m_log->reset()) {
+        Logger::getInstance().log(LogLevel::ERROR, "Cannot reset the history log, keeping new history in memory only");
+        m_log.reset();
+    }
+}
+
+void ServerDataManager::loadRollupsLocked() const
+{
+    std::vector<SensorData> records;
+    for (size_t index = 0; index < m_unrolled_segments; ++index) {
+        records.clear();
+        m_segments[index]->append_range(0, std::numeric_limits<uint32_t>::max(), records);
+        for (const auto& record : records) {
+            m_rollups.add(record);
+        }
+    }
+    m_unrolled_segments = 0;
+}
+
+bool ServerDataManager::insertLocked(const SensorData& data)
+{
+    // Records newer than everything stored need no duplicate check
+    std::optional<uint32_t> newest = newestTimestamp();
+    bool in_order = !newest || data.timestamp > *newest;
+
+    if (!in_order) {
+        SensorData existing;
+        for (const auto& segment : m_segments) {
+            if (segment->find(data.timestamp, existing)) {
+                return false;
+            }
+        }
+    }
+
+    // Fast path: the record is newer than everything in memory, append it to the last block
+    if (m_blocks.empty() || data.timestamp > m_blocks.back()->max_timestamp) {
+        if (m_blocks.empty() ||
+            m_blocks.back()->records.size() + m_blocks.back()->late.size() >= BLOCK_CAPACITY) {
+            auto block = std::make_unique<Block>();
+            block->records.reserve(BLOCK_CAPACITY);
+            block->min_timestamp = data.timestamp;
+            m_blocks.push_back(std::move(block));
+            if (m_blocks.size() > 1) {
+                closeBlock(m_blocks.size() - 2);
+            }
+        }
+
+        Block& last = *m_blocks.back();
+        last.records.push_back(data);
+        last.max_timestamp = data.timestamp;
+        ++m_size;
+        m_rollups.add(data);
+        return true;
+    }
+
+    // Late arrival: buffer it in the block covering its timestamp
+    size_t index = findBlock(data.timestamp);
+    Block& block = *m_blocks[index];
+
+    // Check if this is a duplicate (same timestamp)
+    if (findInBlock(block, data.timestamp)) {
+        return false;
+    }
+
+    block.late.push_back(data);
+    block.min_timestamp = std::min(block.min_timestamp, data.timestamp);
+    block.max_timestamp = std::max(block.max_timestamp, data.timestamp);
+    ++m_size;
+    m_rollups.add(data);
+
+    if (block.late.size() >= LATE_BUFFER_CAPACITY) {
+        mergeLateRecords(index);
+    }
+    return true;
+}
+
+void ServerDataManager::collectRangeLocked(uint32_t start_time, uint32_t end_time,
+                                           std::vector<SensorData>& result) const
+{
+    // Sealed records are decoded straight from the mapped segment files
+    size_t first_record = result.size();
+    size_t sources = 0;
+    for (const auto& segment : m_segments) {
+        size_t before = result.size();
+        segment->append_range(start_time, end_time, result);
+        sources += result.size() != before;
+    }
+
+    // Block ranges do not overlap, so their upper bounds are sorted too
+    auto first = std::lower_bound(m_blocks.begin(), m_blocks.end(), start_time,
+        [](const std::unique_ptr<Block>& block, uint32_t timestamp) {
+            return block->max_timestamp < timestamp;
+        });
+
+    size_t before = result.size();
+    for (auto it = first; it != m_blocks.end() && (*it)->min_timestamp <= end_time; ++it) {
+        appendRange(**it, start_time, end_time, result);
+    }
+    sources += result.size() != before;
+
+    // Late records can make sources overlap; each source is sorted and no timestamp is stored twice
+    auto begin = result.begin() + static_cast<std::ptrdiff_t>(first_record);
+    if (sources > 1 && !std::is_sorted(begin, result.end(), earlier)) {
+        std::sort(begin, result.end(), earlier);
+    }
+}
+
+void ServerDataManager::sealLocked()
+{
+    std::vector<SensorData> records;
+    records.reserve(m_size);
+    for (const auto& block : m_blocks) {
+        appendRange(*block, 0, std::numeric_limits<uint32_t>::max(), records);
+    }
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%s%08llu%s", SEGMENT_PREFIX.data(),
+                  static_cast<unsigned long long>(m_next_segment), SEGMENT_SUFFIX.data());
+    std::string path = m_directory + "/" + name;
+
+    std::unique_ptr<SensorSegment> segment;
+    if (SensorSegment::write(path, records)) {
+        segment = SensorSegment::open(path);
+    }
+    if (!segment) {
+        Logger::getInstance().log(LogLevel::ERROR, "Cannot seal history segment ", path,
+                                  ", keeping new history in memory only");
+        m_log.reset();
+        return;
+    }
+
+    // The sealed file now holds the records, the log can start over with just the coverage
+    if (!m_log->reset()) {
+        Logger::getInstance().log(LogLevel::ERROR, "Cannot reset the history log, keeping new history in memory only");
+        m_log.reset();
+    } else {
+        for (const auto& [start, end] : m_coverage.intervals()) {
+            logCoverage(start, end);
+        }
+    }
+
+    ++m_next_segment;
+    m_sealed_size += segment->size();
+    m_sealed_max = std::max(m_sealed_max, segment->max_timestamp());
+    m_segments.push_back(std::move(segment));
+    m_blocks.clear();
+    m_size = 0;
+}
+
+bool ServerDataManager::logRecord(uint8_t type, const SensorData& data)
+{
+    if (!m_log) {
+        return false;
+    }
+
+    uint8_t record[SENSOR_RECORD_SIZE];
+    PacketCodec::encode(data, record);
+    if (m_log->append(type, record, sizeof(record)) == 0) {
+        Logger::getInstance().log(LogLevel::ERROR, "Cannot write the history log, keeping new history in memory only");
+        m_log.reset();
+        return false;
+    }
+    return true;
+}
+
+void ServerDataManager::logCoverage(uint32_t start_time, uint32_t end_time)
+{
+    if (!m_log) {
+        return;
+    }
+
+    uint8_t range[TIME_RANGE_SIZE];
+    PacketCodec::encode_time_range(start_time, end_time, range);
+    if (m_log->append(LOG_COVERAGE, range, sizeof(range)) == 0) {
+        Logger::getInstance().log(LogLevel::ERROR, "Cannot write the history log, keeping new history in memory only");
+        m_log.reset();
+    }
+}
+
+std::optional<uint32_t> ServerDataManager::newestTimestamp() const
+{
+    std::optional<uint32_t> newest;
+    if (!m_blocks.empty()) {
+        newest = m_blocks.back()->max_timestamp;
+    }
+    if (m_sealed_size != 0 && (!newest || m_sealed_max > *newest)) {
+        newest = m_sealed_max;
+    }
+    return newest;
+}
+
+size_t ServerDataManager::findBlock(uint32_t timestamp) const
+{
+    auto after = std::upper_bound(m_blocks.begin(), m_blocks.end(), timestamp,
+        [](uint32_t timestamp, const std::unique_ptr<Block>& block) {
+            return timestamp < block->min_timestamp;
+        });
+
+    if (after == m_blocks.begin()) {
+        return 0;
+    }
+    return static_cast<size_t>(after - m_blocks.begin()) - 1;
+}
+
+bool ServerDataManager::findInBlock(const Block& block, uint32_t timestamp, SensorData* found)
+{
+    if (timestamp < block.min_timestamp || timestamp > block.max_timestamp) {
+        return false;
+    }
+
+    if (!block.packed.empty()) {
+        thread_local std::vector<SensorData> decoded;
+        decoded.clear();
+        SensorBlockCodec::decode_range(block.packed, timestamp, timestamp, decoded);
+        if (!decoded.empty()) {
+            if (found) {
+                *found = decoded.front();
+            }
+            return true;
+        }
+    } else {
+        auto pos = std::lower_bound(block.records.begin(), block.records.end(), timestamp,
+            [](const SensorData& a, uint32_t timestamp) {
+                return a.timestamp < timestamp;
+            });
+        if (pos != block.records.end() && pos->timestamp == timestamp) {
+            if (found) {
+                *found = *pos;
+            }
+            return true;
+        }
+    }
+
+    for (const auto& record : block.late) {
+        if (record.timestamp == timestamp) {
+            if (found) {
+                *found = record;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void ServerDataManager::mergeLateRecords(size_t index)
+{
+    Block& block = *m_blocks[index];
+
+    if (!block.packed.empty()) {
+        SensorBlockCodec::decode(block.packed, block.records);
+        std::vector<uint8_t>().swap(block.packed);
+    }
+
+    std::sort(block.late.begin(), block.late.end(), earlier);
+    size_t middle = block.records.size();
+    block.records.insert(block.records.end(), block.late.begin(), block.late.end());
+    std::inplace_merge(block.records.begin(), block.records.begin() + middle, block.records.end(), earlier);
+    block.late.clear();
+
+    size_t last = index;
+    if (block.records.size() > BLOCK_CAPACITY) {
+        // Move the newer half into a block of its own
+        auto upper = std::make_unique<Block>();
+        upper->records.reserve(BLOCK_CAPACITY);
+        auto half = block.records.begin() + block.records.size() / 2;
+        upper->records.assign(half, block.records.end());
+        block.records.erase(half, block.records.end());
+
+        upper->min_timestamp = upper->records.front().timestamp;
+        upper->max_timestamp = upper->records.back().timestamp;
+        block.max_timestamp = block.records.back().timestamp;
+
+        m_blocks.insert(m_blocks.begin() + index + 1, std::move(upper));
+        last = index + 1;
+    }
+
+    // Only the last block stays open for in-order appends
+    for (size_t i = index; i <= last && i + 1 < m_blocks.size(); ++i) {
+        packBlock(*m_blocks[i]);
+    }
+}
+
+void ServerDataManager::closeBlock(size_t index)
+{
+    if (!m_blocks[index]->late.empty()) {
+        mergeLateRecords(index);
+    } else {
+        packBlock(*m_blocks[index]);
+    }
+}
+
+void ServerDataManager::packBlock(Block& block)
+{
+    SensorBlockCodec::encode(block.records.data(), block.records.size(), block.packed);
+    block.packed.shrink_to_fit();
+    std::vector<SensorData>().swap(block.records);
+}
+
+void ServerDataManager::appendRange(const Block& block, uint32_t start_time, uint32_t end_time,
+                                    std::vector<SensorData>& result)
+{
+    size_t middle = result.size();
+    if (!block.packed.empty()) {
+        SensorBlockCodec::decode_range(block.packed, start_time, end_time, result);
+    } else {
+        auto lower = std::lower_bound(block.records.begin(), block.records.end(), start_time,
+            [](const SensorData& a, uint32_t timestamp) {
+                return a.timestamp < timestamp;
+            });
+        auto upper = std::upper_bound(lower, block.records.end(), end_time,
+            [](uint32_t timestamp, const SensorData& a) {
+                return timestamp < a.timestamp;
+            });
+        result.insert(result.end(), lower, upper);
+    }
+
+    if (block.late.empty()) {
+        return;
+    }
+
+    // Merge the late records in range on the fly, the block itself is left untouched
+    size_t records_end = result.size();
+    for (const auto& record : block.late) {
+        if (record.timestamp >= start_time && record.timestamp <= end_time) {
+            result.push_back(record);
+        }
+    }
+    std::sort(result.begin() + records_end, result.end(), earlier);
+    std::inplace_merge(result.begin() + middle, result.begin() + records_end, result.end(), earlier);
 }
 
 } // namespace altair
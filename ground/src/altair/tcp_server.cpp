@@ -1,21 +1,26 @@
 #include "tcp_server.hpp"
-#include <iostream>
+#include "binary_protocol.hpp"
+#include <algorithm>
+#include <cstring>
+#include "logger.hpp"
 
 namespace altair {
 
 // TcpServer implementation
-TcpServer::TcpServer(unsigned short port, size_t maxConnections):
+TcpServer::TcpServer(unsigned short port, size_t maxConnections, size_t ioThreadCount):
+acceptor_(io_context_, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), port)),
 port_(port),
 maxConnections_(maxConnections),
 running_(false),
+clientCount_(0),
 nextClientId_(1),
-acceptor_(io_context_, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), port))
+ioThreadCount_(ioThreadCount > 0 ? ioThreadCount : 1),
+runningIoThreads_(0)
 {
     messageHandler_ = [](const std::string& message, std::shared_ptr<ClientSession> client) {
         // Default message handler just echoes the message back
-        std::cout << "Message from client " << client->getClientId() 
-                  << " (" << client->getRemoteAddress() << "): " 
-                  << message << std::endl;
+        Logger::getInstance().log(LogLevel::DEBUG, "Message from client ", client->getClientId(),
+                                  " (", client->getRemoteAddress(), "): ", message);
         client->sendMessage("Echo: " + message);
     };
 }
@@ -28,27 +33,42 @@ TcpServer::~TcpServer()
 bool TcpServer::start() 
 {
     if (running_) {
-        std::cerr << "Server is already running" << std::endl;
+        Logger::getInstance().log(LogLevel::WARN, "Server is already running");
         return false;
     }
 
     try {
         running_ = true;
         startAccept();
+
+        {
+            std::lock_guard<std::mutex> lock(ioStateMutex_);
+            runningIoThreads_ = ioThreadCount_;
+        }
         
-        ioThread_ = std::make_unique<std::thread>([this]() {
-            try {
-                io_context_.run();
-            } catch (const std::exception& e) {
-                std::cerr << "IO thread exception: " << e.what() << std::endl;
-                running_ = false;
-            }
-        });
+        ioThreads_.reserve(ioThreadCount_);
+        for (size_t i = 0; i < ioThreadCount_; ++i) {
+            ioThreads_.emplace_back([this]() {
+                try {
+                    io_context_.run();
+                } catch (const std::exception& e) {
+                    Logger::getInstance().log(LogLevel::ERROR, "IO thread exception: ", e.what());
+                    running_ = false;
+                    io_context_.stop();
+                }
+
+                std::lock_guard<std::mutex> lock(ioStateMutex_);
+                if (--runningIoThreads_ == 0) {
+                    ioStoppedCv_.notify_all();
+                }
+            });
+        }
         
-        std::cout << "Server started on port " << port_ << std::endl;
+        Logger::getInstance().log(LogLevel::INFO, "Server started on port ", port_, " with ",
+                                  ioThreadCount_, " io thread(s)");
         return true;
     } catch (const std::exception& e) {
-        std::cerr << "Failed to start server: " << e.what() << std::endl;
+        Logger::getInstance().log(LogLevel::ERROR, "Failed to start server: ", e.what());
         running_ = false;
         return false;
     }
@@ -63,26 +83,37 @@ void TcpServer::stop()
     running_ = false;
     
     // Stop accepting new connections
-    acceptor_.close();
-    
-    // Close all client connections
-    {
-        std::lock_guard<std::mutex> lock(clientsMutex_);
-        for (auto& pair : clients_) {
-            pair.second->stop();
-        }
-        clients_.clear();
-    }
+    boost::system::error_code ignored;
+    acceptor_.close(ignored);
     
     // Stop the io_context
     io_context_.stop();
     
-    // Wait for the io_thread to finish
-    if (ioThread_ && ioThread_->joinable()) {
-        ioThread_->join();
+    // Wait for the io threads to finish
+    for (auto& thread : ioThreads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
     }
+    ioThreads_.clear();
     
-    std::cout << "Server stopped" << std::endl;
+    // Close all client connections. No handler can run any more, and the
+    // sessions are taken out of the shards first because stopping a session
+    // removes it from its shard.
+    std::vector<std::shared_ptr<ClientSession>> clients;
+    for (auto& shard : clientShards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (auto& pair : shard.clients) {
+            clients.push_back(std::move(pair.second));
+        }
+        shard.clients.clear();
+    }
+    clientCount_ = 0;
+    for (auto& client : clients) {
+        client->stop();
+    }
+    
+    Logger::getInstance().log(LogLevel::INFO, "Server stopped");
 }
 
 void TcpServer::setMessageHandler(std::function<void(const std::string&, std::shared_ptr<ClientSession>)> handler) 
@@ -90,18 +121,64 @@ void TcpServer::setMessageHandler(std::function<void(const std::string&, std::sh
     messageHandler_ = std::move(handler);
 }
 
+void TcpServer::setFrameHandler(std::function<void(const uint8_t*, size_t, std::shared_ptr<ClientSession>)> handler) 
+{
+    frameHandler_ = std::move(handler);
+}
+
+void TcpServer::setCloseHandler(std::function<void(std::shared_ptr<ClientSession>)> handler) 
+{
+    closeHandler_ = std::move(handler);
+}
+
 void TcpServer::broadcastMessage(const std::string& message) 
 {
-    std::lock_guard<std::mutex> lock(clientsMutex_);
-    for (auto& pair : clients_) {
-        pair.second->sendMessage(message);
+    broadcastMessage(std::make_shared<const std::string>(message));
+}
+
+void TcpServer::broadcastMessage(SharedBuffer message) 
+{
+    if (!message || message->empty()) {
+        return;
+    }
+    
+    // Reused per thread so a broadcast allocates nothing once warmed up
+    thread_local std::vector<std::shared_ptr<ClientSession>> targets;
+    
+    for (auto& shard : clientShards_) {
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (auto& pair : shard.clients) {
+                targets.push_back(pair.second);
+            }
+        }
+        
+        for (auto& client : targets) {
+            client->sendMessage(message);
+        }
+        targets.clear();
     }
 }
 
 size_t TcpServer::getClientCount() const 
 {
-    std::lock_guard<std::mutex> lock(clientsMutex_);
-    return clients_.size();
+    return clientCount_.load();
+}
+
+size_t TcpServer::getIoThreadCount() const
+{
+    return ioThreadCount_;
+}
+
+boost::asio::io_context& TcpServer::getIoContext()
+{
+    return io_context_;
+}
+
+void TcpServer::wait()
+{
+    std::unique_lock<std::mutex> lock(ioStateMutex_);
+    ioStoppedCv_.wait(lock, [this]() { return runningIoThreads_ == 0; });
 }
 
 void TcpServer::startAccept() 
@@ -129,44 +206,64 @@ void TcpServer::handleAccept(std::shared_ptr<ClientSession> client, const boost:
     if (!error) {
         // Check if we're at the maximum number of connections
         if (getClientCount() >= maxConnections_) {
-            std::cerr << "Connection rejected: maximum connections reached" << std::endl;
+            static LogRateLimiter limiter(5, std::chrono::seconds(1));
+            Logger::getInstance().log(LogLevel::WARN, limiter, "Connection rejected: maximum connections reached");
             client->socket().close();
         } else {
             // Add the client and start the session
             size_t clientId = addClient(client);
             client->start(clientId);
             
-            std::cout << "New client connected: " << client->getRemoteAddress() 
-                      << " (ID: " << clientId << ")" << std::endl;
+            Logger::getInstance().log(LogLevel::INFO, "New client connected: ", client->getRemoteAddress(),
+                                      " (ID: ", clientId, ")");
         }
     } else {
-        std::cerr << "Error accepting connection: " << error.message() << std::endl;
+        static LogRateLimiter limiter(5, std::chrono::seconds(1));
+        Logger::getInstance().log(LogLevel::WARN, limiter, "Error accepting connection: ", error.message());
     }
     
     // Continue accepting connections
     startAccept();
 }
 
+TcpServer::ClientShard& TcpServer::shardFor(size_t clientId)
+{
+    return clientShards_[clientId % CLIENT_SHARD_COUNT];
+}
+
 size_t TcpServer::addClient(std::shared_ptr<ClientSession> client) 
 {
-    std::lock_guard<std::mutex> lock(clientsMutex_);
     size_t clientId = nextClientId_++;
-    clients_[clientId] = client;
+    ClientShard& shard = shardFor(clientId);
+    
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.clients[clientId] = std::move(client);
+    ++clientCount_;
     return clientId;
 }
 
 void TcpServer::removeClient(size_t clientId) 
 {
-    std::lock_guard<std::mutex> lock(clientsMutex_);
-    clients_.erase(clientId);
+    ClientShard& shard = shardFor(clientId);
+    
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.clients.erase(clientId) > 0) {
+        --clientCount_;
+    }
 }
 
 // ClientSession implementation
 ClientSession::ClientSession(boost::asio::io_context& io_context, TcpServer* server):
-socket_(io_context),
+socket_(boost::asio::make_strand(io_context)),
 server_(server),
 clientId_(0),
-active_(false)
+discardingLine_(false),
+active_(false),
+binary_(false),
+inputClosed_(false),
+holds_(0),
+queuedBytes_(0),
+writeInProgress_(false)
 {
 }
 
@@ -193,7 +290,7 @@ void ClientSession::start(size_t clientId)
         // Start reading from the socket
         startRead();
     } catch (const std::exception& e) {
-        std::cerr << "Error starting client session: " << e.what() << std::endl;
+        Logger::getInstance().log(LogLevel::WARN, "Error starting client session: ", e.what());
         stop();
     }
 }
@@ -211,33 +308,129 @@ void ClientSession::stop()
         
         // If we have a valid client ID, remove it from the server
         if (clientId_ > 0 && server_) {
-            std::cout << "Client disconnected: " << getRemoteAddress() 
-                      << " (ID: " << clientId_ << ")" << std::endl;
+            Logger::getInstance().log(LogLevel::INFO, "Client disconnected: ", getRemoteAddress(),
+                                      " (ID: ", clientId_, ")");
             server_->removeClient(clientId_);
+            
+            // Not when called from the destructor, nobody can hold the session any more then
+            auto self = weak_from_this().lock();
+            if (self && server_->closeHandler_) {
+                server_->closeHandler_(self);
+            }
         }
     } catch (const std::exception& e) {
-        std::cerr << "Error stopping client session: " << e.what() << std::endl;
+        Logger::getInstance().log(LogLevel::WARN, "Error stopping client session: ", e.what());
     }
 }
 
-void ClientSession::sendMessage(const std::string& message)
+void ClientSession::sendMessage(std::string message, uint8_t tag)
 {
     if (!active_ || !socket_.is_open()) {
         return;
     }
     
-    // Make a copy of the message to ensure it stays valid during the async operation
-    auto messageCopy = std::make_shared<std::string>(message);
+    if (binary_) {
+        std::string frames;
+        frames.reserve(message.size() + binary::FRAME_HEADER_SIZE);
+        binary::append_text_frames(frames, message, tag);
+        message.swap(frames);
+    }
     
-    boost::asio::async_write(
-        socket_,
-        boost::asio::buffer(*messageCopy),
-        [this, messageCopy](const boost::system::error_code& error, size_t bytesTransferred) {
-            handleWrite(error, bytesTransferred);
+    // Callers may be on any io thread (or the serial thread), so the message is
+    // queued on the session's strand where all other socket operations run
+    boost::asio::post(
+        socket_.get_executor(),
+        [this, self = shared_from_this(), message = std::move(message)]() mutable {
+            queueWrite(std::move(message));
         }
     );
 }
 
+void ClientSession::sendMessage(SharedBuffer message)
+{
+    if (!active_ || !socket_.is_open() || !message) {
+        return;
+    }
+    
+    if (binary_) {
+        // Shared text has to be framed for this session alone
+        sendMessage(*message);
+        return;
+    }
+    
+    sendRaw(std::move(message));
+}
+
+void ClientSession::sendFrame(uint8_t kind, uint8_t tag, const void* body, size_t size)
+{
+    if (!active_ || !socket_.is_open()) {
+        return;
+    }
+    
+    std::string frame;
+    frame.reserve(binary::FRAME_HEADER_SIZE + size);
+    binary::append_frame(frame, kind, tag, body, size);
+    
+    boost::asio::post(
+        socket_.get_executor(),
+        [this, self = shared_from_this(), frame = std::move(frame)]() mutable {
+            queueWrite(std::move(frame));
+        }
+    );
+}
+
+void ClientSession::sendRaw(SharedBuffer data)
+{
+    if (!active_ || !socket_.is_open() || !data) {
+        return;
+    }
+    
+    boost::asio::post(
+        socket_.get_executor(),
+        [this, self = shared_from_this(), data = std::move(data)]() mutable {
+            queueWrite(std::move(data));
+        }
+    );
+}
+
+void ClientSession::whenDrained(size_t maxQueued, std::function<void()> handler)
+{
+    if (!active_ || !socket_.is_open()) {
+        return;
+    }
+    
+    boost::asio::post(
+        socket_.get_executor(),
+        [this, self = shared_from_this(), maxQueued, handler = std::move(handler)]() mutable {
+            drainHandlers_.emplace_back(maxQueued, std::move(handler));
+            runDrainHandlers();
+        }
+    );
+}
+
+std::shared_ptr<void> ClientSession::holdOpen()
+{
+    ++holds_;
+    
+    // The token only keeps a weak reference, a pending reply does not keep a closed session alive
+    return std::shared_ptr<void>(nullptr, [weak = weak_from_this()](void*) {
+        auto self = weak.lock();
+        if (self && --self->holds_ == 0 && self->inputClosed_) {
+            boost::asio::post(self->socket_.get_executor(), [self]() { self->closeIfIdle(); });
+        }
+    });
+}
+
+void ClientSession::setBinaryFraming()
+{
+    binary_ = true;
+}
+
+bool ClientSession::isBinary() const
+{
+    return binary_;
+}
+
 size_t ClientSession::getClientId() const
 {
     return clientId_;
@@ -265,36 +458,295 @@ void ClientSession::startRead()
 void ClientSession::handleRead(const boost::system::error_code& error, size_t bytesTransferred)
 {
     if (error) {
-        if (error == boost::asio::error::eof) {
-            // Client closed the connection normally
-            std::cout << "Client " << getClientId() << " closed connection" << std::endl;
-        } else {
-            std::cerr << "Read error for client " << getClientId() 
-                      << ": " << error.message() << std::endl;
+        if (error != boost::asio::error::eof) {
+            static LogRateLimiter limiter(10, std::chrono::seconds(1));
+            Logger::getInstance().log(LogLevel::WARN, limiter, "Read error for client ", getClientId(),
+                                      ": ", error.message());
+            stop();
+            return;
         }
-        stop();
+        
+        // Client closed its side, a last command may lack its newline
+        if (!binary_ && !partialInput_.empty() && !discardingLine_) {
+            command_.swap(partialInput_);
+            partialInput_.clear();
+            dispatchLine(command_.data(), command_.size());
+        }
+        Logger::getInstance().log(LogLevel::INFO, "Client ", getClientId(), " closed connection");
+        
+        // Reading stops but the replies still go out; the check is posted behind the ones just queued
+        inputClosed_ = true;
+        boost::asio::post(socket_.get_executor(), [this, self = shared_from_this()]() { closeIfIdle(); });
         return;
     }
     
     if (bytesTransferred > 0 && server_) {
-        // Convert the received data to a string
-        std::string message(dataBuffer_, bytesTransferred);
-        
-        // Call the message handler
-        server_->messageHandler_(message, shared_from_this());
+        consumeInput(dataBuffer_, bytesTransferred);
     }
     
     // Continue reading
     startRead();
 }
 
+void ClientSession::consumeInput(const char* data, size_t size)
+{
+    const char* end = data + size;
+    
+    while (data < end && active_) {
+        if (binary_) {
+            // The previous line switched the session to binary frames
+            consumeFrames(data, end);
+            return;
+        }
+        
+        const char* newline = static_cast<const char*>(std::memchr(data, '\n', end - data));
+        
+        if (!newline) {
+            // Keep the unfinished line for the next read
+            if (!discardingLine_ && partialInput_.size() + (end - data) > MAX_LINE_LENGTH) {
+                rejectLongLine();
+                discardingLine_ = true;
+            }
+            if (!discardingLine_) {
+                partialInput_.append(data, end - data);
+            }
+            return;
+        }
+        
+        if (discardingLine_) {
+            // The rest of an overlong line, resume framing after it
+            discardingLine_ = false;
+        } else if (partialInput_.size() + (newline - data) > MAX_LINE_LENGTH) {
+            // A complete line is held to the same limit as one split across reads
+            rejectLongLine();
+        } else if (partialInput_.empty()) {
+            // Whole line inside this read, the common case
+            dispatchLine(data, newline - data);
+        } else {
+            partialInput_.append(data, newline - data);
+            command_.swap(partialInput_);
+            partialInput_.clear();
+            dispatchLine(command_.data(), command_.size());
+        }
+        
+        data = newline + 1;
+    }
+}
+
+void ClientSession::rejectLongLine()
+{
+    static LogRateLimiter limiter(10, std::chrono::seconds(1));
+    Logger::getInstance().log(LogLevel::WARN, limiter, "Command too long from client ", getClientId(),
+                              ", discarding it");
+    sendMessage("Error: Command too long.\n");
+    partialInput_.clear();
+}
+
+void ClientSession::consumeFrames(const char* data, const char* end)
+{
+    if (!partialInput_.empty()) {
+        // Complete the frame started in an earlier read
+        if (partialInput_.size() < binary::LENGTH_SIZE) {
+            size_t take = std::min<size_t>(binary::LENGTH_SIZE - partialInput_.size(), end - data);
+            partialInput_.append(data, take);
+            data += take;
+            if (partialInput_.size() < binary::LENGTH_SIZE) {
+                return;
+            }
+        }
+        
+        const uint8_t* header = reinterpret_cast<const uint8_t*>(partialInput_.data());
+        size_t frameSize = binary::LENGTH_SIZE + (header[0] | (header[1] << 8));
+        size_t take = std::min<size_t>(frameSize - partialInput_.size(), end - data);
+        partialInput_.append(data, take);
+        data += take;
+        if (partialInput_.size() < frameSize) {
+            return;
+        }
+        
+        command_.swap(partialInput_);
+        partialInput_.clear();
+        dispatchFrame(command_.data(), command_.size());
+    }
+    
+    // Frames lying entirely inside this read are dispatched in place
+    while (active_ && end - data >= static_cast<ptrdiff_t>(binary::LENGTH_SIZE)) {
+        const uint8_t* header = reinterpret_cast<const uint8_t*>(data);
+        size_t frameSize = binary::LENGTH_SIZE + (header[0] | (header[1] << 8));
+        if (end - data < static_cast<ptrdiff_t>(frameSize)) {
+            break;
+        }
+        
+        dispatchFrame(data, frameSize);
+        data += frameSize;
+    }
+    
+    if (active_ && data < end) {
+        partialInput_.append(data, end - data);
+    }
+}
+
+void ClientSession::dispatchFrame(const char* frame, size_t size)
+{
+    if (size < binary::FRAME_HEADER_SIZE) {
+        static LogRateLimiter limiter(10, std::chrono::seconds(1));
+        Logger::getInstance().log(LogLevel::WARN, limiter, "Malformed frame from client ", getClientId(),
+                                  ", disconnecting");
+        stop();
+        return;
+    }
+    
+    if (server_->frameHandler_) {
+        server_->frameHandler_(reinterpret_cast<const uint8_t*>(frame) + binary::LENGTH_SIZE,
+                               size - binary::LENGTH_SIZE, shared_from_this());
+    }
+}
+
+void ClientSession::dispatchLine(const char* line, size_t size)
+{
+    // Accept CRLF terminated lines (telnet and most line based tools)
+    if (size > 0 && line[size - 1] == '\r') {
+        --size;
+    }
+    if (size == 0) {
+        return;
+    }
+    
+    if (line != command_.data()) {
+        command_.assign(line, size);
+    } else {
+        command_.resize(size);
+    }
+    
+    server_->messageHandler_(command_, shared_from_this());
+}
+
+bool ClientSession::reserveQueue(size_t size)
+{
+    if (!active_ || !socket_.is_open() || size == 0) {
+        return false;
+    }
+    
+    if (queuedBytes_ + size > MAX_QUEUED_BYTES) {
+        static LogRateLimiter limiter(10, std::chrono::seconds(1));
+        Logger::getInstance().log(LogLevel::WARN, limiter, "Outbound queue full for client ", getClientId(),
+                                  ", disconnecting");
+        stop();
+        return false;
+    }
+    
+    queuedBytes_ += size;
+    return true;
+}
+
+void ClientSession::queueWrite(std::string&& message)
+{
+    if (!reserveQueue(message.size())) {
+        return;
+    }
+    
+    if (!pendingWrites_.empty() && !pendingWrites_.back().shared &&
+        pendingWrites_.back().owned.size() + message.size() <= WRITE_CHUNK_SIZE) {
+        pendingWrites_.back().owned.append(message);
+    } else {
+        pendingWrites_.push_back(OutboundChunk{std::move(message), nullptr});
+    }
+    
+    // Only one write is ever outstanding, the rest goes out when it completes
+    if (!writeInProgress_) {
+        startWrite();
+    }
+}
+
+void ClientSession::queueWrite(SharedBuffer&& message)
+{
+    if (!reserveQueue(message->size())) {
+        return;
+    }
+    
+    pendingWrites_.push_back(OutboundChunk{std::string(), std::move(message)});
+    
+    // Only one write is ever outstanding, the rest goes out when it completes
+    if (!writeInProgress_) {
+        startWrite();
+    }
+}
+
+void ClientSession::runDrainHandlers()
+{
+    if (!active_) {
+        drainHandlers_.clear();
+        return;
+    }
+    
+    // Handlers are taken out first, they may queue more bytes or register again
+    std::vector<std::function<void()>> ready;
+    for (auto it = drainHandlers_.begin(); it != drainHandlers_.end();) {
+        if (queuedBytes_ <= it->first) {
+            ready.push_back(std::move(it->second));
+            it = drainHandlers_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    
+    for (auto& handler : ready) {
+        handler();
+    }
+}
+
+void ClientSession::startWrite()
+{
+    activeWrites_.swap(pendingWrites_);
+    
+    writeBuffers_.clear();
+    for (const auto& chunk : activeWrites_) {
+        writeBuffers_.push_back(boost::asio::buffer(chunk.data()));
+    }
+    
+    writeInProgress_ = true;
+    boost::asio::async_write(
+        socket_,
+        writeBuffers_,
+        [this, self = shared_from_this()](const boost::system::error_code& error, size_t bytesTransferred) {
+            handleWrite(error, bytesTransferred);
+        }
+    );
+}
+
 void ClientSession::handleWrite(const boost::system::error_code& error, size_t bytesTransferred)
 {
+    writeInProgress_ = false;
+    queuedBytes_ -= bytesTransferred;
+    activeWrites_.clear();
+    
     if (error) {
-        std::cerr << "Write error for client " << getClientId() 
-                  << ": " << error.message() << std::endl;
+        if (active_) {
+            static LogRateLimiter limiter(10, std::chrono::seconds(1));
+            Logger::getInstance().log(LogLevel::WARN, limiter, "Write error for client ", getClientId(),
+                                      ": ", error.message());
+        }
         stop();
+        drainHandlers_.clear();
+        return;
     }
+    
+    if (!pendingWrites_.empty()) {
+        startWrite();
+    }
+    runDrainHandlers();
+    closeIfIdle();
+}
+
+void ClientSession::closeIfIdle()
+{
+    if (!inputClosed_ || !active_ || holds_ > 0 || writeInProgress_ || !pendingWrites_.empty()) {
+        return;
+    }
+    
+    boost::system::error_code ignored;
+    socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_send, ignored);
+    stop();
 }
 
 } // namespace altair
@@ -0,0 +1,321 @@
+#include "telemetry_subscriptions.hpp"
+#include "binary_protocol.hpp"
+#include "packet_codec.hpp"
+#include <charconv>
+
+namespace altair {
+
+namespace {
+
+struct FieldName
+{
+    std::string_view name;
+    TelemetrySubscriptions::SensorField field;
+};
+
+constexpr FieldName FIELD_NAMES[] = {
+    { "temp",    TelemetrySubscriptions::SensorField::TEMP },
+    { "humid",   TelemetrySubscriptions::SensorField::HUMID },
+    { "light",   TelemetrySubscriptions::SensorField::LIGHT },
+    { "voltage", TelemetrySubscriptions::SensorField::VOLTAGE },
+};
+
+} // namespace
+
+TelemetrySubscriptions::TelemetrySubscriptions():
+m_mutex(),
+m_predicates(),
+m_active_predicates(0),
+m_subscriptions(),
+m_last_mode(-1)
+{
+}
+
+bool TelemetrySubscriptions::parse_term(std::string_view term, Filter& filter)
+{
+    if (term == "beacon") {
+        filter.packet_types |= BEACON_TELEMETRY;
+        return true;
+    }
+    if (term == "event") {
+        filter.packet_types |= EVENT_TELEMETRY;
+        return true;
+    }
+    if (term == "mode_change") {
+        filter.mode_change = true;
+        return true;
+    }
+
+    // <field><op><value>, e.g. temp>30 or voltage<=2.9
+    size_t op_pos = term.find_first_of("<>");
+    if (op_pos == std::string_view::npos || filter.thresholds.size() >= MAX_THRESHOLDS) {
+        return false;
+    }
+
+    Threshold threshold{};
+    std::string_view name = term.substr(0, op_pos);
+    bool known_field = false;
+    for (const auto& entry : FIELD_NAMES) {
+        if (entry.name == name) {
+            threshold.field = entry.field;
+            known_field = true;
+            break;
+        }
+    }
+    if (!known_field) {
+        return false;
+    }
+
+    bool less = term[op_pos] == '<';
+    size_t value_pos = op_pos + 1;
+    bool or_equal = value_pos < term.size() && term[value_pos] == '=';
+    if (or_equal) {
+        ++value_pos;
+    }
+    threshold.op = less ? (or_equal ? Comparison::LESS_EQUAL : Comparison::LESS)
+                        : (or_equal ? Comparison::GREATER_EQUAL : Comparison::GREATER);
+
+    const char* first = term.data() + value_pos;
+    const char* last = term.data() + term.size();
+    auto result = std::from_chars(first, last, threshold.value);
+    if (first == last || result.ec != std::errc() || result.ptr != last) {
+        return false;
+    }
+
+    filter.thresholds.push_back(threshold);
+    return true;
+}
+
+bool TelemetrySubscriptions::subscribe(const std::shared_ptr<ClientSession>& client, const Filter& filter)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint64_t mask = 0;
+    if (!intern(filter.thresholds, mask)) {
+        return false;
+    }
+
+    auto it = m_subscriptions.find(client->getClientId());
+    if (it != m_subscriptions.end()) {
+        release(it->second.predicates);
+        m_subscriptions.erase(it);
+    }
+
+    Subscription subscription;
+    subscription.client = client;
+    subscription.packet_types = filter.packet_types != 0 ? filter.packet_types : static_cast<uint8_t>(ALL_TELEMETRY);
+    subscription.mode_change = filter.mode_change;
+    subscription.predicates = mask;
+    m_subscriptions.emplace(client->getClientId(), std::move(subscription));
+    return true;
+}
+
+bool TelemetrySubscriptions::unsubscribe(size_t client_id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_subscriptions.find(client_id);
+    if (it == m_subscriptions.end()) {
+        return false;
+    }
+
+    release(it->second.predicates);
+    m_subscriptions.erase(it);
+    return true;
+}
+
+template<typename TextFormat, typename FrameFormat>
+size_t TelemetrySubscriptions::deliver(std::vector<std::shared_ptr<ClientSession>>& targets,
+                                       TextFormat&& format_text, FrameFormat&& format_frame)
+{
+    SharedBuffer text;
+    SharedBuffer frame;
+    size_t count = targets.size();
+
+    for (auto& client : targets) {
+        if (client->isBinary()) {
+            if (!frame) {
+                frame = std::make_shared<const std::string>(format_frame());
+            }
+            client->sendRaw(frame);
+        } else {
+            if (!text) {
+                text = std::make_shared<const std::string>(format_text());
+            }
+            client->sendRaw(text);
+        }
+    }
+    targets.clear();
+    return count;
+}
+
+size_t TelemetrySubscriptions::publish_beacon(const SensorData& data, const PacketParser& parser)
+{
+    // Reused per thread so a frame nobody subscribed to costs no allocation
+    thread_local std::vector<std::shared_ptr<ClientSession>> targets;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        bool mode_changed = m_last_mode != static_cast<int>(data.mode);
+        m_last_mode = static_cast<int>(data.mode);
+
+        if (m_subscriptions.empty()) {
+            return 0;
+        }
+
+        // Each interned predicate is evaluated once per frame, however many clients use it
+        uint64_t predicate_mask = 0;
+        for (uint64_t active = m_active_predicates; active != 0; active &= active - 1) {
+            size_t index = static_cast<size_t>(__builtin_ctzll(active));
+            if (evaluate(m_predicates[index].threshold, data)) {
+                predicate_mask |= uint64_t(1) << index;
+            }
+        }
+
+        collect_targets(BEACON_TELEMETRY, predicate_mask, mode_changed, targets);
+    }
+
+    if (targets.empty()) {
+        return 0;
+    }
+    return deliver(targets,
+        [&]() { return "\nBeacon data:\n" + parser.sensor_data_to_string(data); },
+        [&]() {
+            uint8_t record[SENSOR_RECORD_SIZE];
+            PacketCodec::encode(data, record);
+            std::string frame;
+            binary::append_frame(frame, binary::REPLY_SENSOR_RECORDS, 0, record, sizeof(record));
+            return frame;
+        });
+}
+
+size_t TelemetrySubscriptions::publish_event(const EventData& data, const PacketParser& parser)
+{
+    thread_local std::vector<std::shared_ptr<ClientSession>> targets;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_subscriptions.empty()) {
+            return 0;
+        }
+        collect_targets(EVENT_TELEMETRY, 0, false, targets);
+    }
+
+    if (targets.empty()) {
+        return 0;
+    }
+    return deliver(targets,
+        [&]() { return "\nEvent data:\n" + parser.event_data_to_string(data) + "\n"; },
+        [&]() {
+            uint8_t record[EVENT_RECORD_SIZE];
+            PacketCodec::encode(data, record);
+            std::string frame;
+            binary::append_frame(frame, binary::REPLY_EVENT_RECORDS, 0, record, sizeof(record));
+            return frame;
+        });
+}
+
+size_t TelemetrySubscriptions::subscriber_count() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_subscriptions.size();
+}
+
+void TelemetrySubscriptions::collect_targets(uint8_t packet_type, uint64_t predicate_mask, bool mode_changed,
+                                             std::vector<std::shared_ptr<ClientSession>>& targets)
+{
+    for (auto it = m_subscriptions.begin(); it != m_subscriptions.end();) {
+        Subscription& subscription = it->second;
+
+        auto client = subscription.client.lock();
+        if (!client) {
+            // The session is gone, drop its subscription
+            release(subscription.predicates);
+            it = m_subscriptions.erase(it);
+            continue;
+        }
+
+        bool matches = (subscription.packet_types & packet_type) != 0;
+        if (packet_type == BEACON_TELEMETRY) {
+            matches = matches &&
+                      (subscription.predicates & ~predicate_mask) == 0 &&
+                      (!subscription.mode_change || mode_changed);
+        }
+
+        if (matches) {
+            targets.push_back(std::move(client));
+        }
+        ++it;
+    }
+}
+
+bool TelemetrySubscriptions::intern(const std::vector<Threshold>& thresholds, uint64_t& mask)
+{
+    // Find or allocate an entry for every threshold before taking any reference.
+    // reserved holds the entries in use plus the ones allocated by this call.
+    uint64_t reserved = m_active_predicates;
+    uint64_t new_mask = 0;
+
+    for (size_t i = 0; i < thresholds.size() && i < MAX_THRESHOLDS; ++i) {
+        size_t index = MAX_PREDICATES;
+        for (uint64_t candidates = reserved; candidates != 0; candidates &= candidates - 1) {
+            size_t candidate = static_cast<size_t>(__builtin_ctzll(candidates));
+            if (m_predicates[candidate].threshold == thresholds[i]) {
+                index = candidate;
+                break;
+            }
+        }
+
+        if (index == MAX_PREDICATES) {
+            if (~reserved == 0) {
+                return false;
+            }
+            index = static_cast<size_t>(__builtin_ctzll(~reserved));
+            reserved |= uint64_t(1) << index;
+            m_predicates[index].threshold = thresholds[i];
+            m_predicates[index].refs = 0;
+        }
+
+        new_mask |= uint64_t(1) << index;
+    }
+
+    // Commit: one reference per distinct predicate
+    for (uint64_t bits = new_mask; bits != 0; bits &= bits - 1) {
+        m_predicates[static_cast<size_t>(__builtin_ctzll(bits))].refs++;
+    }
+    m_active_predicates |= new_mask;
+    mask = new_mask;
+    return true;
+}
+
+void TelemetrySubscriptions::release(uint64_t mask)
+{
+    for (uint64_t bits = mask; bits != 0; bits &= bits - 1) {
+        size_t index = static_cast<size_t>(__builtin_ctzll(bits));
+        if (--m_predicates[index].refs == 0) {
+            m_active_predicates &= ~(uint64_t(1) << index);
+        }
+    }
+}
+
+bool TelemetrySubscriptions::evaluate(const Threshold& threshold, const SensorData& data)
+{
+    float value = 0.0f;
+    switch (threshold.field) {
+        case SensorField::TEMP:    value = static_cast<float>(data.temp); break;
+        case SensorField::HUMID:   value = static_cast<float>(data.humid); break;
+        case SensorField::LIGHT:   value = static_cast<float>(data.light); break;
+        case SensorField::VOLTAGE: value = data.voltage; break;
+    }
+
+    switch (threshold.op) {
+        case Comparison::LESS:          return value < threshold.value;
+        case Comparison::LESS_EQUAL:    return value <= threshold.value;
+        case Comparison::GREATER:       return value > threshold.value;
+        case Comparison::GREATER_EQUAL: return value >= threshold.value;
+    }
+    return false;
+}
+
+} // namespace altair
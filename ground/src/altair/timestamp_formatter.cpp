@@ -0,0 +1,115 @@
+#include "timestamp_formatter.hpp"
+#include <cstdio>
+#include <cstring>
+
+namespace altair {
+
+namespace {
+
+constexpr time_t SECONDS_PER_DAY = 86400;
+
+// Offsets of every real time zone, and so their DST transitions, fall on 15 minute boundaries
+constexpr time_t TRANSITION_GRANULARITY = 900;
+
+bool same_offset(time_t timestamp, const struct tm& reference)
+{
+    struct tm other;
+    return localtime_r(&timestamp, &other) &&
+           other.tm_gmtoff == reference.tm_gmtoff &&
+           other.tm_isdst == reference.tm_isdst;
+}
+
+void put_two_digits(char* out, long value)
+{
+    out[0] = static_cast<char>('0' + value / 10);
+    out[1] = static_cast<char>('0' + value % 10);
+}
+
+} // namespace
+
+size_t TimestampFormatter::format(time_t timestamp, char* out, size_t size)
+{
+    thread_local Span span;
+
+    if (size == 0) {
+        return 0;
+    }
+
+    if (timestamp < span.start || timestamp >= span.end) {
+        refresh(span, timestamp);
+        if (span.start == span.end) {
+            // localtime_r failed, the timestamp cannot be represented
+            out[0] = '\0';
+            return 0;
+        }
+    }
+
+    long second = span.start_second + static_cast<long>(timestamp - span.start);
+
+    char buffer[BUFFER_SIZE];
+    char* cursor = buffer;
+    std::memcpy(cursor, span.date, span.date_length);
+    cursor += span.date_length;
+    put_two_digits(cursor, second / 3600);
+    cursor[2] = ':';
+    put_two_digits(cursor + 3, (second / 60) % 60);
+    cursor[5] = ':';
+    put_two_digits(cursor + 6, second % 60);
+    cursor += 8;
+    std::memcpy(cursor, span.zone, span.zone_length);
+    cursor += span.zone_length;
+
+    size_t length = static_cast<size_t>(cursor - buffer);
+    if (length >= size) {
+        length = size - 1;
+    }
+    std::memcpy(out, buffer, length);
+    out[length] = '\0';
+    return length;
+}
+
+void TimestampFormatter::refresh(Span& span, time_t timestamp)
+{
+    struct tm local;
+    if (!localtime_r(&timestamp, &local)) {
+        span.start = span.end = 0;
+        return;
+    }
+
+    long second_of_day = local.tm_hour * 3600L + local.tm_min * 60L + local.tm_sec;
+
+    // Normally the offset holds for the whole local day
+    span.start = timestamp - second_of_day;
+    span.end = span.start + SECONDS_PER_DAY;
+    span.start_second = 0;
+
+    if (!same_offset(span.start, local) || !same_offset(span.end - 1, local)) {
+        // The clocks change today, only cache the window around the timestamp
+        time_t into_window = ((timestamp % TRANSITION_GRANULARITY) + TRANSITION_GRANULARITY) % TRANSITION_GRANULARITY;
+        span.start = timestamp - into_window;
+        span.end = span.start + TRANSITION_GRANULARITY;
+        span.start_second = second_of_day - static_cast<long>(into_window);
+
+        if (span.start_second < 0 || span.start_second + TRANSITION_GRANULARITY > SECONDS_PER_DAY ||
+            !same_offset(span.start, local) || !same_offset(span.end - 1, local)) {
+            span.start = timestamp;
+            span.end = timestamp + 1;
+            span.start_second = second_of_day;
+        }
+    }
+
+    int written = std::snprintf(span.date, sizeof(span.date), "%04d-%02d-%02d ",
+                                local.tm_year + 1900, local.tm_mon + 1, local.tm_mday);
+    span.date_length = written > 0 ? static_cast<size_t>(written) : 0;
+    if (span.date_length >= sizeof(span.date)) {
+        span.date_length = sizeof(span.date) - 1;
+    }
+
+    written = std::snprintf(span.zone, sizeof(span.zone), " %s", local.tm_zone ? local.tm_zone : "");
+    span.zone_length = written > 0 ? static_cast<size_t>(written) : 0;
+    if (span.zone_length >= sizeof(span.zone)) {
+        span.zone_length = sizeof(span.zone) - 1;
+    }
+}
+
+} // namespace altair
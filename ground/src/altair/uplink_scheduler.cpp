@@ -0,0 +1,103 @@
+#include "uplink_scheduler.hpp"
+#include <algorithm>
+
+namespace altair {
+
+UplinkScheduler::UplinkScheduler(Writer writer, size_t bytes_per_second, size_t burst_bytes):
+m_writer(std::move(writer)),
+m_rate(static_cast<double>(bytes_per_second)),
+m_burst(static_cast<double>(std::max<size_t>(burst_bytes, 1))),
+m_mutex(),
+m_wakeup(),
+m_queues(),
+m_tokens(m_burst),
+m_refilled(std::chrono::steady_clock::now()),
+m_stop(false),
+m_thread()
+{
+    m_thread = std::thread([this]() { run(); });
+}
+
+UplinkScheduler::~UplinkScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wakeup.notify_one();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void UplinkScheduler::submit(Priority priority, std::vector<uint8_t> packet, size_t cost, uint32_t ticket)
+{
+    cost = std::max(cost, packet.size());
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queues[std::min<size_t>(priority, PRIORITY_COUNT - 1)].push_back(Entry{ std::move(packet), cost, ticket });
+    }
+    m_wakeup.notify_one();
+}
+
+size_t UplinkScheduler::cancel(const Matcher& match)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t dropped = 0;
+    for (auto& queue : m_queues) {
+        auto kept = std::remove_if(queue.begin(), queue.end(), [&](const Entry& entry) {
+            return match(entry.packet, entry.ticket);
+        });
+        dropped += static_cast<size_t>(queue.end() - kept);
+        queue.erase(kept, queue.end());
+    }
+    return dropped;
+}
+
+size_t UplinkScheduler::queued(Priority priority) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t count = 0;
+    for (size_t level = 0; level <= priority && level < PRIORITY_COUNT; ++level) {
+        count += m_queues[level].size();
+    }
+    return count;
+}
+
+void UplinkScheduler::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true) {
+        m_wakeup.wait(lock, [&]() {
+            return m_stop || std::any_of(m_queues.begin(), m_queues.end(), [](const auto& queue) { return !queue.empty(); });
+        });
+        if (m_stop) {
+            return;
+        }
+
+        if (m_rate > 0) {
+            auto now = std::chrono::steady_clock::now();
+            m_tokens = std::min(m_burst, m_tokens + m_rate * std::chrono::duration<double>(now - m_refilled).count());
+            m_refilled = now;
+
+            if (m_tokens < 0) {
+                // Wait out the debt; a more urgent packet arriving meanwhile is picked on the next round
+                m_wakeup.wait_for(lock, std::chrono::duration<double>(-m_tokens / m_rate), [&]() { return m_stop; });
+                continue;
+            }
+        }
+
+        // The oldest packet of the most urgent class
+        auto queue = std::find_if(m_queues.begin(), m_queues.end(), [](const auto& waiting) { return !waiting.empty(); });
+        Entry entry = std::move(queue->front());
+        queue->pop_front();
+        m_tokens -= static_cast<double>(entry.cost);
+
+        lock.unlock();
+        m_writer(entry.packet, entry.ticket);
+        lock.lock();
+    }
+}
+
+} // namespace altair
@@ -0,0 +1,283 @@
+#include "write_ahead_log.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace altair {
+
+namespace {
+
+constexpr char LOG_MAGIC[8] = { 'A', 'L', 'T', 'W', 'A', 'L', '0', '1' };
+constexpr uint32_t FORMAT_VERSION = 1;
+
+// [magic 8][version 4][reserved 4]
+constexpr size_t LOG_HEADER_SIZE = 16;
+// [crc32 4][type 1][reserved 1][length 2]
+constexpr size_t RECORD_HEADER_SIZE = 8;
+
+constexpr std::array<uint32_t, 256> make_crc_table()
+{
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+constexpr std::array<uint32_t, 256> CRC_TABLE = make_crc_table();
+
+/**
+ * @brief Feeds bytes into a CRC-32 (IEEE); start with 0xFFFFFFFF and invert the result
+ */
+uint32_t crc_update(uint32_t crc, const uint8_t* data, size_t size)
+{
+    for (size_t i = 0; i < size; ++i) {
+        crc = CRC_TABLE[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+bool write_all(int fd, const uint8_t* data, size_t size, off_t offset)
+{
+    while (size > 0) {
+        ssize_t written = pwrite(fd, data, size, offset);
+        if (written < 0) {
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+        offset += written;
+    }
+    return true;
+}
+
+} // namespace
+
+std::unique_ptr<WriteAheadLog> WriteAheadLog::open(const std::string& path, const WriteAheadLogOptions& options,
+                                                   const ReplayHandler& replay)
+{
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    std::unique_ptr<WriteAheadLog> log(new WriteAheadLog(fd, options));
+
+    off_t file_size = lseek(fd, 0, SEEK_END);
+    uint8_t header[LOG_HEADER_SIZE];
+    bool valid = file_size >= static_cast<off_t>(LOG_HEADER_SIZE) &&
+                 pread(fd, header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+                 std::memcmp(header, LOG_MAGIC, sizeof(LOG_MAGIC)) == 0;
+    uint32_t version = 0;
+    if (valid) {
+        std::memcpy(&version, header + 8, sizeof(version));
+    }
+    if (!valid || version != FORMAT_VERSION) {
+        // New or unreadable file, start it over
+        if (!log->start_over()) {
+            return nullptr;
+        }
+        log->m_commit_thread = std::thread([raw = log.get()]() { raw->run_commits(); });
+        return log;
+    }
+
+    // Read the whole log once; it only holds what has not been sealed elsewhere
+    std::vector<uint8_t> content(static_cast<size_t>(file_size));
+    size_t read_size = 0;
+    while (read_size < content.size()) {
+        ssize_t bytes = pread(fd, content.data() + read_size, content.size() - read_size, static_cast<off_t>(read_size));
+        if (bytes <= 0) {
+            break;
+        }
+        read_size += static_cast<size_t>(bytes);
+    }
+
+    size_t offset = LOG_HEADER_SIZE;
+    while (offset + RECORD_HEADER_SIZE <= read_size) {
+        const uint8_t* record = content.data() + offset;
+        uint32_t crc;
+        uint16_t length;
+        std::memcpy(&crc, record, sizeof(crc));
+        std::memcpy(&length, record + 6, sizeof(length));
+
+        if (record[4] == 0 || offset + RECORD_HEADER_SIZE + length > read_size ||
+            ~crc_update(0xFFFFFFFFu, record + 4, RECORD_HEADER_SIZE - 4 + length) != crc) {
+            // Preallocated space or a record torn by a crash, the log ends here
+            break;
+        }
+
+        replay(record[4], record + RECORD_HEADER_SIZE, length);
+        offset += RECORD_HEADER_SIZE + length;
+    }
+
+    log->m_end = offset;
+    log->m_allocated = static_cast<uint64_t>(file_size);
+
+    // Clear the remains of a torn record, so they cannot be mistaken for records following a later append
+    size_t torn_end = std::min(read_size, offset + RECORD_HEADER_SIZE + MAX_PAYLOAD_SIZE);
+    if (std::any_of(content.begin() + offset, content.begin() + torn_end, [](uint8_t byte) { return byte != 0; })) {
+        std::vector<uint8_t> zeros(torn_end - offset, 0);
+        write_all(fd, zeros.data(), zeros.size(), static_cast<off_t>(offset));
+        fdatasync(fd);
+    }
+
+    log->m_commit_thread = std::thread([raw = log.get()]() { raw->run_commits(); });
+    return log;
+}
+
+WriteAheadLog::WriteAheadLog(int fd, const WriteAheadLogOptions& options):
+m_fd(fd),
+m_options(options),
+m_mutex(),
+m_commit_wakeup(),
+m_end(LOG_HEADER_SIZE),
+m_allocated(0),
+m_appended(0),
+m_durable(0),
+m_unsynced_bytes(0),
+m_sync_failed(false),
+m_stop(false),
+m_commit_thread()
+{
+}
+
+WriteAheadLog::~WriteAheadLog()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_commit_wakeup.notify_one();
+    if (m_commit_thread.joinable()) {
+        m_commit_thread.join();
+    }
+    close(m_fd);
+}
+
+uint64_t WriteAheadLog::append(uint8_t type, const void* payload, size_t size)
+{
+    if (type == 0 || size > MAX_PAYLOAD_SIZE) {
+        return 0;
+    }
+
+    // The record is assembled and checksummed outside the lock
+    thread_local std::vector<uint8_t> record;
+    record.resize(RECORD_HEADER_SIZE + size);
+    record[4] = type;
+    record[5] = 0;
+    uint16_t length = static_cast<uint16_t>(size);
+    std::memcpy(record.data() + 6, &length, sizeof(length));
+    std::memcpy(record.data() + RECORD_HEADER_SIZE, payload, size);
+    uint32_t crc = ~crc_update(0xFFFFFFFFu, record.data() + 4, record.size() - 4);
+    std::memcpy(record.data(), &crc, sizeof(crc));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // After a failed sync nothing appended is known to reach the disk, the caller has to stop relying on the log
+    uint64_t record_size = record.size();
+    if (m_sync_failed || !reserve(m_end + record_size) ||
+        !write_all(m_fd, record.data(), record.size(), static_cast<off_t>(m_end))) {
+        return 0;
+    }
+
+    m_end += record_size;
+    m_unsynced_bytes += record_size;
+    uint64_t sequence = ++m_appended;
+
+    if (m_unsynced_bytes >= m_options.sync_bytes) {
+        m_commit_wakeup.notify_one();
+    }
+    return sequence;
+}
+
+uint32_t WriteAheadLog::checksum(const void* data, size_t size)
+{
+    return ~crc_update(0xFFFFFFFFu, static_cast<const uint8_t*>(data), size);
+}
+
+bool WriteAheadLog::reset()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!start_over()) {
+        return false;
+    }
+
+    // Nothing appended before the reset needs a sync any more, and the new file was synced whole
+    m_durable = m_appended;
+    m_unsynced_bytes = 0;
+    m_sync_failed = false;
+    return true;
+}
+
+bool WriteAheadLog::reserve(uint64_t size)
+{
+    if (size <= m_allocated) {
+        return true;
+    }
+
+    uint64_t step = std::max<uint64_t>(m_options.preallocate_bytes, 1);
+    uint64_t allocated = m_allocated + (size - m_allocated + step - 1) / step * step;
+    if (posix_fallocate(m_fd, static_cast<off_t>(m_allocated), static_cast<off_t>(allocated - m_allocated)) != 0) {
+        return false;
+    }
+    m_allocated = allocated;
+    return true;
+}
+
+bool WriteAheadLog::start_over()
+{
+    uint8_t header[LOG_HEADER_SIZE] = {};
+    std::memcpy(header, LOG_MAGIC, sizeof(LOG_MAGIC));
+    std::memcpy(header + 8, &FORMAT_VERSION, sizeof(FORMAT_VERSION));
+
+    if (ftruncate(m_fd, 0) != 0) {
+        return false;
+    }
+    m_allocated = 0;
+    if (!reserve(LOG_HEADER_SIZE) || !write_all(m_fd, header, sizeof(header), 0) || fsync(m_fd) != 0) {
+        return false;
+    }
+    m_end = LOG_HEADER_SIZE;
+    return true;
+}
+
+void WriteAheadLog::run_commits()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true) {
+        m_commit_wakeup.wait_for(lock, m_options.sync_interval, [&]() {
+            return m_stop || m_unsynced_bytes >= m_options.sync_bytes;
+        });
+
+        if (m_appended != m_durable && !m_sync_failed) {
+            uint64_t target = m_appended;
+            m_unsynced_bytes = 0;
+
+            // One sync covers every record appended so far; appends continue meanwhile
+            lock.unlock();
+            bool synced = fdatasync(m_fd) == 0;
+            lock.lock();
+
+            if (synced) {
+                m_durable = std::max(m_durable, target);
+            } else {
+                m_sync_failed = true;
+            }
+        }
+
+        if (m_stop) {
+            return;
+        }
+    }
+}
+
+} // namespace altair
@@ -0,0 +1,106 @@
+/**
+ * @file packet_schema.h
+ * @brief Wire layout of the packet payloads shared by firmware and ground station
+ *
+ * Every payload carried between the Altair satellite and the ground server is
+ * described once here as a list of (record, field, type, offset) entries.
+ * The firmware uses the offsets and the PACKET_SCHEMA_PUT/GET helpers below,
+ * and the ground server builds its C++ codec (packet_codec.hpp) from the same
+ * lists, so both sides always agree on the layout.
+ *
+ * Offsets are relative to the first payload byte, which follows the
+ * 4 byte header (length, type, id, checksum). Multi-byte fields are little
+ * endian, matching both the STM32 and the ground hosts.
+ *
+ * This header must stay valid C and C++ and depend on nothing but the
+ * standard library.
+ */
+
+#ifndef INC_ALTAIR_PACKET_SCHEMA_H_
+#define INC_ALTAIR_PACKET_SCHEMA_H_
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @brief Sensor sample, sent in keep-alive (beacon) and sensor log packets
+ */
+#define SENSOR_RECORD_SCHEMA(FIELD) \
+    FIELD(SENSOR_RECORD, temp,      uint8_t,  0) \
+    FIELD(SENSOR_RECORD, humid,     uint8_t,  1) \
+    FIELD(SENSOR_RECORD, light,     uint8_t,  2) \
+    FIELD(SENSOR_RECORD, mode,      uint8_t,  3) \
+    FIELD(SENSOR_RECORD, voltage,   float,    4) \
+    FIELD(SENSOR_RECORD, timestamp, uint32_t, 8)
+#define SENSOR_RECORD_SIZE 12
+
+/**
+ * @brief System event, sent in event and event log packets
+ */
+#define EVENT_RECORD_SCHEMA(FIELD) \
+    FIELD(EVENT_RECORD, event,     uint8_t,  0) \
+    FIELD(EVENT_RECORD, timestamp, uint32_t, 1)
+#define EVENT_RECORD_SIZE 5
+
+/**
+ * @brief Time range of a sensor or event log request
+ */
+#define TIME_RANGE_SCHEMA(FIELD) \
+    FIELD(TIME_RANGE, start, uint32_t, 0) \
+    FIELD(TIME_RANGE, end,   uint32_t, 4)
+#define TIME_RANGE_SIZE 8
+
+/**
+ * @brief Unix timestamp, sent to set the clock and in current time responses
+ */
+#define TIME_VALUE_SCHEMA(FIELD) \
+    FIELD(TIME_VALUE, timestamp, uint32_t, 0)
+#define TIME_VALUE_SIZE 4
+
+/**
+ * @brief Trailer of a sensor log reply, set when more records are available
+ */
+#define SENSOR_LOG_END_SCHEMA(FIELD) \
+    FIELD(SENSOR_LOG_END, more_data, uint8_t, 0)
+#define SENSOR_LOG_END_SIZE 1
+
+/*
+ * Generated declarations: for every field, an offset constant
+ * <RECORD>_<field>_OFFSET and a type <RECORD>_<field>_t.
+ */
+#define PACKET_SCHEMA_OFFSET(record, name, type, offset) record##_##name##_OFFSET = (offset),
+#define PACKET_SCHEMA_TYPEDEF(record, name, type, offset) typedef type record##_##name##_t;
+
+enum {
+    SENSOR_RECORD_SCHEMA(PACKET_SCHEMA_OFFSET)
+    EVENT_RECORD_SCHEMA(PACKET_SCHEMA_OFFSET)
+    TIME_RANGE_SCHEMA(PACKET_SCHEMA_OFFSET)
+    TIME_VALUE_SCHEMA(PACKET_SCHEMA_OFFSET)
+    SENSOR_LOG_END_SCHEMA(PACKET_SCHEMA_OFFSET)
+};
+
+SENSOR_RECORD_SCHEMA(PACKET_SCHEMA_TYPEDEF)
+EVENT_RECORD_SCHEMA(PACKET_SCHEMA_TYPEDEF)
+TIME_RANGE_SCHEMA(PACKET_SCHEMA_TYPEDEF)
+TIME_VALUE_SCHEMA(PACKET_SCHEMA_TYPEDEF)
+SENSOR_LOG_END_SCHEMA(PACKET_SCHEMA_TYPEDEF)
+
+/**
+ * @brief Write one schema field into a payload buffer
+ *
+ * The value is converted to the field's wire type and copied to its fixed
+ * offset; no bounds or length checks are made.
+ */
+#define PACKET_SCHEMA_PUT(record, name, buffer, value) \
+    do { \
+        record##_##name##_t schema_value_ = (record##_##name##_t)(value); \
+        memcpy(&(buffer)[record##_##name##_OFFSET], &schema_value_, sizeof(schema_value_)); \
+    } while (0)
+
+/**
+ * @brief Read one schema field from a payload buffer into an lvalue of the field's type
+ */
+#define PACKET_SCHEMA_GET(record, name, buffer, out) \
+    memcpy(&(out), &(buffer)[record##_##name##_OFFSET], sizeof(record##_##name##_t))
+
+#endif /* INC_ALTAIR_PACKET_SCHEMA_H_ */
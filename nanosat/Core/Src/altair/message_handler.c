@@ -7,6 +7,7 @@
 
 #include <string.h>
 #include "altair/message_handler.h"
+#include "altair/packet_schema.h"
 #include "DateTime.h"
 #include "sync_globals.h"
 #include "utils/send_queue.h"
@@ -27,6 +28,8 @@ static void send_time(Queue* send_data, uint8_t response_id);
 static void wrap_message(uint8_t const * message, MessagePacket* packet);
 static void send_ack(Queue* send_data, uint8_t response_id);
 static void send_nack(Queue* send_data, uint8_t response_id);
+static void pack_sensor_record(uint8_t* buffer, const SensorData* sensor_data);
+static void pack_event_record(uint8_t* buffer, const EventData* event_data);
 
 /* Handlers for each packet type */
 static void handle_get_clock(Queue* send_data, MessagePacket* packet);
@@ -93,21 +96,12 @@ void send_keep_alive_packet(Queue* queue) {
     MessagePacket packet;
 
     packet.packetType = PACKET_TYPE_KEEP_ALIVE;
-    packet.data_len = 17;
+    packet.data_len = HEADER_LEN + SENSOR_RECORD_SIZE;
     packet.m_respnse_id = 0xFF;
     packet.checksum = 8;
     packet.end_mark = END_MARK;
 
-    packet.buffer[0] = g_latest_sensor_data.temp;
-    packet.buffer[1] = g_latest_sensor_data.humid;
-    packet.buffer[2] = g_latest_sensor_data.light;
-    packet.buffer[3] = g_latest_sensor_data.mode;
-
-    uint8_t* voltage = (uint8_t*)&g_latest_sensor_data.volage;
-    memcpy(&packet.buffer[4], voltage, sizeof(float));
-
-    uint8_t* timestamp = (uint8_t*)&g_latest_sensor_data.timestamp;
-    memcpy(&packet.buffer[8], timestamp, sizeof(uint32_t));
+    pack_sensor_record(packet.buffer, &g_latest_sensor_data);
 
     send_message(queue, &packet);
 }
@@ -122,15 +116,12 @@ void send_event_packet(EventData* event_data, Queue* queue) {
     MessagePacket packet;
 
     packet.packetType = PACKET_TYPE_EVENT;
-    packet.data_len = 10;
+    packet.data_len = HEADER_LEN + EVENT_RECORD_SIZE;
     packet.checksum = 8;
     packet.m_respnse_id = 0xFF;
     packet.end_mark = END_MARK;
 
-    packet.buffer[0] = event_data->event;
-
-    uint8_t* timestamp = (uint8_t*)&event_data->timestamp;
-    memcpy(&packet.buffer[1], timestamp, sizeof(uint32_t));
+    pack_event_record(packet.buffer, event_data);
 
     send_message(queue, &packet);
 }
@@ -180,9 +171,9 @@ static void send_nack(Queue* send_data, uint8_t response_id) {
 
 /* Handler implementations */
 static void handle_get_clock(Queue* send_data, MessagePacket* packet) {
-    uint32_t timestamp;
+    TIME_VALUE_timestamp_t timestamp;
     DateTime datetime;
-    memcpy(&timestamp, packet->buffer, sizeof(uint32_t));
+    PACKET_SCHEMA_GET(TIME_VALUE, timestamp, packet->buffer, timestamp);
 
     parse_timestamp(timestamp, &datetime);
     RTC_SetDateTime(&datetime);
@@ -236,8 +227,8 @@ static void handle_request_sensor_log(Queue* send_data, MessagePacket* packet) {
     uint32_t start_timestamp, end_timestamp;
     uint8_t total_logs;
 
-    memcpy(&start_timestamp, packet->buffer, sizeof(uint32_t));
-    memcpy(&end_timestamp, packet->buffer + sizeof(uint32_t), sizeof(uint32_t));
+    PACKET_SCHEMA_GET(TIME_RANGE, start, packet->buffer, start_timestamp);
+    PACKET_SCHEMA_GET(TIME_RANGE, end, packet->buffer, end_timestamp);
 
     DataExtractionStatus res = extract_data_between_timestamp(
         sensor_data, start_timestamp, end_timestamp, MAX_LOGS, &total_logs);
@@ -255,8 +246,8 @@ static void handle_request_event_log(Queue* send_data, MessagePacket* packet) {
     uint32_t event_start_timestamp, event_end_timestamp;
     uint8_t total_event_logs;
 
-    memcpy(&event_start_timestamp, packet->buffer, sizeof(uint32_t));
-    memcpy(&event_end_timestamp, packet->buffer + sizeof(uint32_t), sizeof(uint32_t));
+    PACKET_SCHEMA_GET(TIME_RANGE, start, packet->buffer, event_start_timestamp);
+    PACKET_SCHEMA_GET(TIME_RANGE, end, packet->buffer, event_end_timestamp);
 
     EventDataExtractionStatus event_res = extract_event_data_between_timestamp(
         event_data, event_start_timestamp, event_end_timestamp, MAX_LOGS, &total_event_logs);
@@ -294,14 +285,12 @@ static void send_time(Queue* send_data, uint8_t response_id) {
     MessagePacket messagePacket;
 
     messagePacket.packetType = PACKET_TYPE_RESPONSE_SENT_TIME;
-    messagePacket.data_len = 4 + HEADER_LEN + 2;
+    messagePacket.data_len = HEADER_LEN + TIME_VALUE_SIZE;
     messagePacket.checksum = 8;
     messagePacket.m_respnse_id = response_id;
     messagePacket.end_mark = END_MARK;
 
-    uint32_t current_time = get_timestamp();
-    uint8_t* timestamp = (uint8_t*)&current_time;
-    memcpy(&messagePacket.buffer[0], timestamp, sizeof(uint32_t));
+    PACKET_SCHEMA_PUT(TIME_VALUE, timestamp, messagePacket.buffer, get_timestamp());
 
     send_message(send_data, &messagePacket);
 }
@@ -322,17 +311,13 @@ static void send_event_logs(Queue* send_data, EventData* event_data, uint8_t len
     MessagePacket messagePacket;
 
     messagePacket.packetType = PACKET_TYPE_EVENT_LOG;
-    messagePacket.data_len = 11;
+    messagePacket.data_len = HEADER_LEN + EVENT_RECORD_SIZE;
     messagePacket.checksum = 8;
     messagePacket.m_respnse_id = response_id;
     messagePacket.end_mark = END_MARK;
 
     for (uint8_t i = 0; i < len; ++i) {
-        messagePacket.buffer[0] = event_data[i].event;
-
-        uint8_t* timestamp = (uint8_t*)&event_data->timestamp;
-        memcpy(&messagePacket.buffer[1], timestamp, sizeof(uint32_t));
-
+        pack_event_record(messagePacket.buffer, &event_data[i]);
         send_message(send_data, &messagePacket);
     }
 
@@ -351,35 +336,39 @@ static void send_sensor_logs(Queue* send_data, SensorData* sensor_data, uint8_t
     MessagePacket messagePacket;
 
     messagePacket.packetType = PACKET_TYPE_SENSOR_LOG;
-    messagePacket.data_len = 17;
+    messagePacket.data_len = HEADER_LEN + SENSOR_RECORD_SIZE;
     messagePacket.checksum = 8;
     messagePacket.m_respnse_id = response_id;
     messagePacket.end_mark = END_MARK;
 
     for (uint8_t i = 0; i < len; ++i) {
-        messagePacket.buffer[0] = sensor_data[i].temp;
-        messagePacket.buffer[1] = sensor_data[i].humid;
-        messagePacket.buffer[2] = sensor_data[i].light;
-        messagePacket.buffer[3] = sensor_data[i].mode;
-
-        uint8_t* voltage = (uint8_t*)&sensor_data[i].volage;
-        memcpy(&messagePacket.buffer[4], voltage, sizeof(float));
-
-        uint8_t* timestamp = (uint8_t*)&sensor_data[i].timestamp;
-        memcpy(&messagePacket.buffer[8], timestamp, sizeof(uint32_t));
-
+        pack_sensor_record(messagePacket.buffer, &sensor_data[i]);
         send_message(send_data, &messagePacket);
     }
 
     /* Send end marker packet */
     messagePacket.packetType = PACKET_TYPE_SENSOR_LOG_END;
-    messagePacket.data_len = HEADER_LEN + 1;
+    messagePacket.data_len = HEADER_LEN + SENSOR_LOG_END_SIZE;
     messagePacket.checksum = 0;
     messagePacket.m_respnse_id = response_id;
     messagePacket.end_mark = END_MARK;
-    messagePacket.buffer[0] = more_data ? 1 : 0;
+    PACKET_SCHEMA_PUT(SENSOR_LOG_END, more_data, messagePacket.buffer, more_data ? 1 : 0);
 
     send_message(send_data, &messagePacket);
 }
 
+/* Implementation of pack_sensor_record function */
+static void pack_sensor_record(uint8_t* buffer, const SensorData* sensor_data) {
+    PACKET_SCHEMA_PUT(SENSOR_RECORD, temp, buffer, sensor_data->temp);
+    PACKET_SCHEMA_PUT(SENSOR_RECORD, humid, buffer, sensor_data->humid);
+    PACKET_SCHEMA_PUT(SENSOR_RECORD, light, buffer, sensor_data->light);
+    PACKET_SCHEMA_PUT(SENSOR_RECORD, mode, buffer, sensor_data->mode);
+    PACKET_SCHEMA_PUT(SENSOR_RECORD, voltage, buffer, sensor_data->volage);
+    PACKET_SCHEMA_PUT(SENSOR_RECORD, timestamp, buffer, sensor_data->timestamp);
+}
 
+/* Implementation of pack_event_record function */
+static void pack_event_record(uint8_t* buffer, const EventData* event_data) {
+    PACKET_SCHEMA_PUT(EVENT_RECORD, event, buffer, event_data->event);
+    PACKET_SCHEMA_PUT(EVENT_RECORD, timestamp, buffer, event_data->timestamp);
+}